@@ -0,0 +1,454 @@
+#ifndef BasicCommandLine_hpp
+#define BasicCommandLine_hpp
+/**
+ * A command line processor for either character type, whichever CommandLine.c was built with.
+ *
+ * \author Tom Plunket <tom@mightysprite.com>
+ * \copyright (c) 2017 Tom Plunket, all rights reserved
+ *
+ * Licensed under the MIT/X license. Do with these files what you will.
+ *
+ * CL_USE_wchar_t fixes the character type of the C interface, so code with both narrow and wide
+ * command lines would need two builds of it. BasicCommandLine<char> and BasicCommandLine<wchar_t>
+ * work the same way as CommandLine and both work with either build, since the C code only sees
+ * copies of the arguments in its own character type. Arguments can come from argv or from any container of strings with
+ * data() and size(), such as std::basic_string or std::basic_string_view, and needn't be
+ * terminated. String values are views of the arguments rather than copies, so they last as long
+ * as the arguments do; Utf8() converts one when it's needed as UTF-8.
+ *
+ *     BasicCommandLine<wchar_t> cl;
+ *     BasicCommandLine<wchar_t>::String input;
+ *     int verbose;
+ *     cl.AddCountingOption(&verbose, L"v");
+ *     cl.AddArgument(&input);
+ *     if (!cl.Parse(argc, argv))
+ *         return 1;
+ *     puts(input.Utf8().c_str());
+ *
+ * The parse itself is CL_ParseWith(), so it follows the same rules and gives the same error
+ * messages as CL_Parse(), with the options and parameters in the messages given as UTF-8.
+ * Response files, lists, prefixes, subcommands, config
+ * files, the environment and custom types are only in the C interface and CommandLine.
+ */
+
+#include "CommandLine.h"
+
+#include "Log/Log.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#if __cplusplus >= 201703L
+ #include <string_view>
+#endif
+
+/**
+ * A view of part of an argument. It's the length that says where it ends, not a terminator.
+ */
+template <typename CharT>
+class CommandLineString
+{
+public:
+    CommandLineString() : text(nullptr), length(0) {}
+    CommandLineString(CharT const* text, size_t length) : text(text), length(length) {}
+
+    CharT const* data() const { return text; }
+    size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+    CharT const* begin() const { return text; }
+    CharT const* end() const { return text + length; }
+    CharT operator[](size_t i) const { return text[i]; }
+
+    /// Does it say the same as a terminated string?
+    bool operator==(CharT const* s) const
+        {
+            size_t i = 0;
+            while ((i < length) && (s[i] != 0) && (s[i] == text[i]))
+                ++i;
+            return (i == length) && (s[i] == 0);
+        }
+    bool operator!=(CharT const* s) const { return !(*this == s); }
+
+    std::basic_string<CharT> str() const { return std::basic_string<CharT>(text, length); }
+#if __cplusplus >= 201703L
+    operator std::basic_string_view<CharT>() const { return { text, length }; }
+#endif
+
+    /// A copy in UTF-8. Narrow text is taken to be UTF-8 already, and wide text to be UTF-16 or
+    /// UTF-32 by the size of wchar_t; anything that isn't valid becomes U+FFFD.
+    std::string Utf8() const
+        {
+            std::string utf8;
+            utf8.reserve(length);
+            for (size_t i = 0; i < length; ++i)
+                AppendUtf8(utf8, i);
+            return utf8;
+        }
+
+    /// A terminated copy in the character type CommandLine.c was built with: the same text if
+    /// that's CharT, UTF-8 as Utf8() gives it if that's narrow, and otherwise decoded from UTF-8.
+    std::basic_string<CL_CharType> Native() const
+        {
+            std::basic_string<CL_CharType> native;
+            ToNative(native);
+            return native;
+        }
+
+private:
+    void ToNative(std::basic_string<CharT>& native) const { native.assign(text, length); }
+
+    template <typename NativeT>
+    void ToNative(std::basic_string<NativeT>& native) const
+        {
+            if (sizeof(NativeT) == 1)
+            {
+                std::string const utf8 = Utf8();
+                native.assign(utf8.begin(), utf8.end());
+                return;
+            }
+
+            native.reserve(length);
+            for (size_t i = 0; i < length; )
+                AppendWide(native, i);
+        }
+
+    /// Decode one character of UTF-8, anything that isn't valid becoming U+FFFD, and append it
+    /// as UTF-16 or UTF-32 by the size of wchar_t.
+    template <typename NativeT>
+    void AppendWide(std::basic_string<NativeT>& wide, size_t& i) const
+        {
+            uint32_t c = (uint8_t)text[i++];
+            int const more = (c < 0x80) ? 0 : (c < 0xc2) ? -1 : (c < 0xe0) ? 1 : (c < 0xf0) ? 2 :
+                             (c < 0xf5) ? 3 : -1;
+            if (more > 0)
+                c &= 0x3fu >> more;
+            for (int n = 0; n < more; ++n, ++i)
+            {
+                if ((i >= length) || (((uint8_t)text[i] & 0xc0) != 0x80))
+                {
+                    c = 0xfffd;
+                    break;
+                }
+                c = (c << 6) | ((uint8_t)text[i] & 0x3f);
+            }
+            if ((more < 0) || ((c >= 0xd800) && (c < 0xe000)) || (c > 0x10ffff) ||
+                ((more == 2) && (c < 0x800)) || ((more == 3) && (c < 0x10000)))
+            {
+                c = 0xfffd;
+            }
+
+            if ((sizeof(NativeT) == 2) && (c >= 0x10000))
+            {
+                wide += (NativeT)(0xd800 + ((c - 0x10000) >> 10));
+                wide += (NativeT)(0xdc00 + (c & 0x3ff));
+            }
+            else
+            {
+                wide += (NativeT)c;
+            }
+        }
+
+    void AppendUtf8(std::string& utf8, size_t& i) const
+        {
+            uint32_t c = (uint32_t)text[i];
+            if (sizeof(CharT) == 1)
+            {
+                utf8 += (char)c;
+                return;
+            }
+            if ((sizeof(CharT) == 2) && (c >= 0xd800) && (c < 0xdc00) && (i + 1 < length) &&
+                ((uint32_t)text[i + 1] >= 0xdc00) && ((uint32_t)text[i + 1] < 0xe000))
+            {
+                c = 0x10000 + ((c - 0xd800) << 10) + ((uint32_t)text[++i] - 0xdc00);
+            }
+            else if (((c >= 0xd800) && (c < 0xe000)) || (c > 0x10ffff))
+            {
+                c = 0xfffd;
+            }
+
+            if (c < 0x80)
+            {
+                utf8 += (char)c;
+            }
+            else if (c < 0x800)
+            {
+                utf8 += (char)(0xc0 | (c >> 6));
+                utf8 += (char)(0x80 | (c & 0x3f));
+            }
+            else if (c < 0x10000)
+            {
+                utf8 += (char)(0xe0 | (c >> 12));
+                utf8 += (char)(0x80 | ((c >> 6) & 0x3f));
+                utf8 += (char)(0x80 | (c & 0x3f));
+            }
+            else
+            {
+                utf8 += (char)(0xf0 | (c >> 18));
+                utf8 += (char)(0x80 | ((c >> 12) & 0x3f));
+                utf8 += (char)(0x80 | ((c >> 6) & 0x3f));
+                utf8 += (char)(0x80 | (c & 0x3f));
+            }
+        }
+
+    CharT const* text;
+    size_t length;
+};
+
+template <typename CharT>
+class BasicCommandLine
+{
+public:
+    typedef CommandLineString<CharT> String;
+
+    void AddCountingOption(int* value, CharT const* name) { Add(k_counting, value, name); }
+    void AddIntegerOption(int* value, CharT const* name) { Add(k_integer, value, name); }
+    void AddFloatOption(float* value, CharT const* name) { Add(k_float, value, name); }
+    void AddStringOption(String* value, CharT const* name) { Add(k_string, value, name); }
+    void AddInt64Option(int64_t* value, CharT const* name) { Add(k_int64, value, name); }
+    void AddDoubleOption(double* value, CharT const* name) { Add(k_double, value, name); }
+    void AddArgument(String* value)
+        {
+            *value = String();
+            arguments.push_back(value);
+        }
+    void EnableOverflowArguments() { overflowEnabled = true; }
+    std::vector<String> const& GetOverflowArguments() const { return overflow; }
+
+    String GetApplicationName() const { return appName; }
+
+    /// Parse argv as main() gets it.
+    bool Parse(int argc, CharT const* const* argv)
+        {
+            return ParseArguments((size_t)argc, [argv](size_t i)
+            {
+                size_t length = 0;
+                while (argv[i][length] != 0)
+                    ++length;
+                return String(argv[i], length);
+            });
+        }
+
+    /// Parse a container of strings, the first of them the application name.
+    template <typename Container>
+    bool Parse(Container const& args)
+        {
+            auto const first = std::begin(args);
+            return ParseArguments((size_t)std::distance(first, std::end(args)), [first](size_t i)
+            {
+                auto const& arg = *std::next(first, (ptrdiff_t)i);
+                return String(arg.data(), arg.size());
+            });
+        }
+
+private:
+    enum Kind
+    {
+        k_counting,
+        k_integer,
+        k_float,
+        k_string,
+        k_int64,
+        k_double,
+    };
+
+    struct Option
+    {
+        String name;
+        Kind kind;
+        void* value;
+    };
+
+    template <typename T>
+    void Add(Kind kind, T* value, CharT const* name)
+        {
+            // as with the C interface, adding an option resets its variable
+            *value = T();
+            size_t length = 0;
+            while (name[length] != 0)
+                ++length;
+            options.push_back({ String(name, length), kind, value });
+            sorted.clear();
+        }
+
+    static bool Less(String const& a, String const& b)
+        {
+            return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+        }
+
+    /// The option named \c name, the newest if there are several, or nullptr.
+    Option* Find(String name)
+        {
+            if (sorted.size() != options.size())
+            {
+                sorted.resize(options.size());
+                for (size_t i = 0; i < options.size(); ++i)
+                    sorted[i] = i;
+                std::stable_sort(sorted.begin(), sorted.end(), [this](size_t a, size_t b)
+                {
+                    return Less(options[a].name, options[b].name);
+                });
+            }
+
+            auto const after = std::upper_bound(sorted.begin(), sorted.end(), name,
+                                                [this](String const& n, size_t o)
+            {
+                return Less(n, options[o].name);
+            });
+            if ((after == sorted.begin()) || Less(options[*(after - 1)].name, name))
+                return nullptr;
+            return &options[*(after - 1)];
+        }
+
+    /**
+     * What CL_ParseWith() hands what it finds to. It walks copies of the arguments in the C
+     * code's character type, which is what the numbers are parsed from and what the messages it
+     * gives itself quote, but the values are views of the arguments themselves.
+     */
+    struct Parser
+    {
+        BasicCommandLine* cl;
+        std::vector<String> args;
+        std::vector<CL_StringType> native;  ///< the copies, in order in one buffer
+        size_t nextArgument;
+
+        /// Which argument \c arg is a copy of.
+        String Original(CL_StringType arg) const
+            {
+                auto const after = std::upper_bound(native.begin(), native.end(), arg,
+                                                    std::less<CL_StringType>());
+                return args[(size_t)(after - native.begin()) - 1];
+            }
+
+        static int FindOption(CL_StringType arg, size_t* option, void* data)
+            {
+                Parser const* p = static_cast<Parser const*>(data);
+                String const original = p->Original(arg);
+                Option const* o = p->cl->Find(String(original.data() + 1, original.size() - 1));
+                if (o == nullptr)
+                {
+                    CL_ReportUtf8(CL_UNKNOWN_OPTION, original.Utf8().c_str(), nullptr);
+                    return -1;
+                }
+                *option = (size_t)(o - p->cl->options.data());
+                return (o->kind == k_counting) ? 0 : 1;
+            }
+
+        static int LoadOption(size_t option, CL_StringType const* params, void* data)
+            {
+                Parser const* p = static_cast<Parser const*>(data);
+                Option const& o = p->cl->options[option];
+                if (o.kind == k_counting)
+                {
+                    *(int*)o.value += 1;
+                    return 1;
+                }
+                return Load(o, p->Original(params[0]), params[0]);
+            }
+
+        static int TakeArgument(CL_StringType arg, void* data)
+            {
+                Parser* p = static_cast<Parser*>(data);
+                BasicCommandLine* cl = p->cl;
+                if (p->nextArgument < cl->arguments.size())
+                    *cl->arguments[p->nextArgument++] = p->Original(arg);
+                else if (cl->overflowEnabled)
+                    cl->overflow.push_back(p->Original(arg));
+                else
+                    return 0;
+                return 1;
+            }
+    };
+
+    static bool Report(int parsed, String param, String name)
+        {
+            if (parsed <= 0)
+            {
+                CL_ReportUtf8((parsed < 0) ? CL_PARAMETER_OUT_OF_RANGE : CL_INVALID_PARAMETER,
+                              param.Utf8().c_str(), name.Utf8().c_str());
+            }
+            return parsed > 0;
+        }
+
+    /// Load \c param, whose copy for the C code to parse numbers from is \c native.
+    static bool Load(Option const& o, String param, CL_StringType native)
+        {
+            // a terminator in the middle would cut the number short
+            if ((o.kind != k_string) && (std::find(param.begin(), param.end(), 0) != param.end()))
+                return Report(0, param, o.name);
+
+            int64_t i;
+            double d;
+            switch (o.kind)
+            {
+            case k_integer:
+            {
+                int parsed = CL_ParseInt64(native, &i);
+                if ((parsed > 0) && ((i < INT_MIN) || (i > INT_MAX)))
+                    parsed = -1;
+                if (parsed > 0)
+                    *(int*)o.value = (int)i;
+                return Report(parsed, param, o.name);
+            }
+            case k_int64:
+                return Report(CL_ParseInt64(native, (int64_t*)o.value), param, o.name);
+            case k_float:
+            {
+                int parsed = CL_ParseDouble(native, &d);
+                if ((parsed > 0) && std::isfinite(d) && (std::fabs(d) > FLT_MAX))
+                    parsed = -1;
+                if (parsed > 0)
+                    *(float*)o.value = (float)d;
+                return Report(parsed, param, o.name);
+            }
+            case k_double:
+                return Report(CL_ParseDouble(native, (double*)o.value), param, o.name);
+            default:
+                *(String*)o.value = param;
+                return true;
+            }
+        }
+
+    template <typename GetFn>
+    bool ParseArguments(size_t count, GetFn get)
+        {
+            static CL_Handler const k_handler =
+            {
+                Parser::FindOption, Parser::LoadOption, Parser::TakeArgument
+            };
+
+            appName = (count > 0) ? get(0) : String();
+            overflow.clear();
+
+            Parser parser = { this, {}, {}, 0 };
+            std::basic_string<CL_CharType> buffer;
+            std::vector<size_t> starts;
+            for (size_t i = 0; i < count; ++i)
+            {
+                parser.args.push_back(get(i));
+                starts.push_back(buffer.size());
+                buffer += parser.args.back().Native();
+                buffer += CL_CharType();
+            }
+            for (size_t start : starts)
+                parser.native.push_back(buffer.data() + start);
+
+            return CL_ParseWith(&k_handler, &parser, (int)count, parser.native.data()) == 0;
+        }
+
+    std::vector<Option> options;
+    std::vector<size_t> sorted;     ///< option numbers in order by name, built by the first parse
+    std::vector<String*> arguments;
+    bool overflowEnabled = false;
+    std::vector<String> overflow;
+    String appName;
+};
+
+#endif // ndef BasicCommandLine_hpp
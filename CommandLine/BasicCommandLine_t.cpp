@@ -0,0 +1,163 @@
+/**
+ * Tests for the command line processor that takes either character type.
+ *
+ * \author Tom Plunket <tom@mightysprite.com>
+ * \copyright (c) 2017 Tom Plunket, all rights reserved
+ *
+ * Licensed under the MIT/X license. Do with these files what you will.
+ */
+
+#include "BasicCommandLine.hpp"
+
+#include "Log/LogTarget.hpp"
+
+#include "Catch/Catch.hpp"
+
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Messages : public LogTarget
+    {
+        std::vector<std::string> messages;
+
+        void LogMessage(char const* m, LogType, char const*, unsigned int) override
+        {
+            messages.push_back(m);
+        }
+    };
+}
+
+TEST_CASE( "BasicCommandLine" )
+{
+    Messages log;
+
+    SECTION( "Narrow argv, whichever way CommandLine.c was built." )
+    {
+        BasicCommandLine<char> cl;
+        BasicCommandLine<char>::String input, name;
+        int verbose, count;
+        double scale;
+        cl.AddCountingOption(&verbose, "v");
+        cl.AddIntegerOption(&count, "count");
+        cl.AddDoubleOption(&scale, "scale");
+        cl.AddStringOption(&name, "name");
+        cl.AddArgument(&input);
+
+        char const* args[] = { "app", "-v", "in", "-count", "0x10", "-name", "bob", "-v",
+                               "-scale", "2.5" };
+        REQUIRE(cl.Parse(10, args));
+        REQUIRE(cl.GetApplicationName() == "app");
+        REQUIRE(verbose == 2);
+        REQUIRE(count == 16);
+        REQUIRE(scale == 2.5);
+        REQUIRE(input == "in");
+        REQUIRE(input.data() == args[2]);       // a view, not a copy
+        REQUIRE(name.str() == "bob");
+        REQUIRE(log.messages.empty());
+    }
+
+    SECTION( "Wide argv, converted to UTF-8 only when asked." )
+    {
+        BasicCommandLine<wchar_t> cl;
+        BasicCommandLine<wchar_t>::String name;
+        float scale;
+        int64_t big;
+        cl.AddStringOption(&name, L"name");
+        cl.AddFloatOption(&scale, L"scale");
+        cl.AddInt64Option(&big, L"big");
+        cl.EnableOverflowArguments();
+
+        wchar_t const* args[] = { L"app", L"-name", L"café €", L"x", L"-scale", L"1k",
+                                  L"-big", L"1G", L"y" };
+        REQUIRE(cl.Parse(9, args));
+        REQUIRE(name == L"café €");
+        REQUIRE(name.Utf8() == "caf\xc3\xa9 \xe2\x82\xac");
+        REQUIRE(scale == 1024.0f);
+        REQUIRE(big == (int64_t)1 << 30);
+        REQUIRE(cl.GetOverflowArguments().size() == 2);
+        REQUIRE(cl.GetOverflowArguments()[1] == L"y");
+    }
+
+    SECTION( "Strings in containers don't have to be terminated." )
+    {
+        // views of parts of one buffer, the way a tokenizer would hand them over
+        std::wstring const line = L"tool-count3-v";
+        std::vector<CommandLineString<wchar_t>> args =
+        {
+            { line.data(), 4 }, { line.data() + 4, 6 }, { line.data() + 10, 1 },
+            { line.data() + 11, 2 },
+        };
+
+        BasicCommandLine<wchar_t> cl;
+        int count, verbose;
+        cl.AddIntegerOption(&count, L"count");
+        cl.AddCountingOption(&verbose, L"v");
+        REQUIRE(cl.Parse(args));
+        REQUIRE(cl.GetApplicationName() == L"tool");
+        REQUIRE(count == 3);
+        REQUIRE(verbose == 1);
+
+        std::vector<std::string> strings = { "app", "-v", "-v" };
+        BasicCommandLine<char> narrow;
+        narrow.AddCountingOption(&verbose, "v");
+        REQUIRE(narrow.Parse(strings));
+        REQUIRE(verbose == 2);
+    }
+
+    SECTION( "Errors are the same as CL_Parse's, in UTF-8." )
+    {
+        BasicCommandLine<wchar_t> cl;
+        BasicCommandLine<wchar_t>::String input;
+        int count;
+        cl.AddIntegerOption(&count, L"count");
+        cl.AddArgument(&input);
+
+        wchar_t const* args[] = { L"app", L"-né", L"-count", L"½", L"-count",
+                                  L"99999999999", L"-count" };
+        REQUIRE(!cl.Parse(7, args));
+        REQUIRE(log.messages.size() == 5);
+        REQUIRE(log.messages[0] == "Unknown option '-n\xc3\xa9'.\n");
+        REQUIRE_THAT(log.messages[1], Catch::Contains("is not a valid parameter to '-count'"));
+        REQUIRE_THAT(log.messages[2], Catch::Contains("is out of range for '-count'"));
+        REQUIRE_THAT(log.messages[3], Catch::Contains("can't be handled"));
+        REQUIRE_THAT(log.messages[4], Catch::Contains("requires 1 parameters"));
+        REQUIRE(input == L"½");        // as with CL_Parse
+    }
+
+    SECTION( "The C code parses copies in its own character type." )
+    {
+        std::string const narrow = "caf\xc3\xa9 \xf0\x9f\x98\x80 \xff!";
+        std::wstring const wide = L"caf\u00e9 \U0001f600";
+        CommandLineString<char> const n(narrow.data(), narrow.size());
+        CommandLineString<wchar_t> const w(wide.data(), wide.size());
+#if CL_USE_wchar_t
+        REQUIRE(n.Native() == wide + L" \ufffd!");
+        REQUIRE(w.Native() == wide);
+#else
+        REQUIRE(n.Native() == narrow);
+        REQUIRE(w.Native() == "caf\xc3\xa9 \xf0\x9f\x98\x80");
+#endif
+
+        // a terminator in the middle isn't the end of a number
+        std::vector<std::string> const args = { "app", "-count", std::string("12\0" "3", 4) };
+        BasicCommandLine<char> cl;
+        int count;
+        cl.AddIntegerOption(&count, "count");
+        REQUIRE(!cl.Parse(args));
+        REQUIRE(count == 0);
+    }
+
+    SECTION( "The newest of several options with one name is the one that's set." )
+    {
+        BasicCommandLine<char> cl;
+        int first, second;
+        cl.AddIntegerOption(&first, "n");
+        cl.AddIntegerOption(&second, "n");
+        char const* args[] = { "app", "-n", "5" };
+        REQUIRE(cl.Parse(3, args));
+        REQUIRE(first == 0);
+        REQUIRE(second == 5);
+    }
+}
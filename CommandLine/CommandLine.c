@@ -11,14 +11,55 @@
 
 #include "Log/Log.h"
 
+#include <errno.h>
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <sys/stat.h>
+
+#if !defined(_WIN32) && !CL_USE_wchar_t
+ #define CL_USE_MMAP 1
+ #include <sys/mman.h>
+#else
+ #define CL_USE_MMAP 0
+#endif
+
+#if defined(_WIN32)
+ #define WIN32_LEAN_AND_MEAN
+ #include <windows.h>
+#else
+ #include <dirent.h>
+ #include <fcntl.h>
+ #include <unistd.h>
+ #if defined(__linux__)
+  #include <sys/syscall.h>
+ #endif
+#endif
+
+/// Glob expansion walks directories on several threads where there are pthreads.
+#if !defined(CL_USE_THREADS)
+ #if defined(_WIN32)
+  #define CL_USE_THREADS 0
+ #else
+  #define CL_USE_THREADS 1
+ #endif
+#endif
+#if CL_USE_THREADS
+ #include <pthread.h>
+#endif
 
 #if CL_USE_wchar_t
 #define STRCMP wcscmp
+#define STRNCMP wcsncmp
+#define STRLEN wcslen
 #define STR "%ls"
 #else
 #define STRCMP strcmp
+#define STRNCMP strncmp
+#define STRLEN strlen
 #define STR "%s"
 #endif
 
@@ -31,6 +72,14 @@ enum OptionType
     OT_INTEGER,
     OT_FLOAT,
     OT_STRING,
+    OT_INT64,
+    OT_DOUBLE,
+    OT_INTEGER_LIST,
+    OT_FLOAT_LIST,
+    OT_STRING_LIST,
+    OT_INT64_LIST,
+    OT_DOUBLE_LIST,
+    OT_CUSTOM,
     OT_NUM_TYPES
 };
 
@@ -41,18 +90,53 @@ struct CommandLineOption
 {
     enum OptionType type;
     CL_StringType name;
-    void* value;
-    struct CommandLineOption* next;
+    void* value;            ///< for lists, the caller's pointer to the first element
+    union
+    {
+        size_t* count;                      ///< for lists, the caller's count of elements
+        struct CustomParser const* parser;  ///< for custom options
+    };
+};
+
+/**
+ * How a custom option is parsed. These are kept apart from the options, which are looked at for
+ * every argument, so that the options stay small.
+ */
+struct CustomParser
+{
+    CL_ParseFn parse;
+    void* data;
+};
+
+/**
+ * One value of a list option as it's parsed. They're collected in the order they appear and then
+ * moved into the lists once the parse is done and it's known how long each one is.
+ */
+struct ListValue
+{
+    unsigned int option;
+    union
+    {
+        int i;
+        float f;
+        CL_StringType s;
+        int64_t i64;
+        double d;
+    } value;
 };
 
 /**
  * The functions that load option parameters.
  */
-typedef int (*LoadParametersFn)(struct CommandLineOption*, CL_StringType*);
-static int LoadCountingParameters(struct CommandLineOption*, CL_StringType*);
-static int LoadIntegerParameters(struct CommandLineOption*, CL_StringType*);
-static int LoadFloatParameters(struct CommandLineOption*, CL_StringType*);
-static int LoadStringParameters(struct CommandLineOption*, CL_StringType*);
+typedef int (*LoadParametersFn)(struct CommandLineOption*, CL_StringType const*, void* value);
+static int LoadCountingParameters(struct CommandLineOption*, CL_StringType const*, void*);
+static int LoadIntegerParameters(struct CommandLineOption*, CL_StringType const*, void*);
+static int LoadFloatParameters(struct CommandLineOption*, CL_StringType const*, void*);
+static int LoadStringParameters(struct CommandLineOption*, CL_StringType const*, void*);
+static int LoadInt64Parameters(struct CommandLineOption*, CL_StringType const*, void*);
+static int LoadDoubleParameters(struct CommandLineOption*, CL_StringType const*, void*);
+static int LoadCustomParameters(struct CommandLineOption*, CL_StringType const*, void*);
+static void NumberError(int parsed, struct CommandLineOption const*, CL_StringType param);
 
 /**
  * Static data that hooks option types up to their handlers.
@@ -61,361 +145,3031 @@ struct OptionTypeData
 {
     int numParameters;
     LoadParametersFn loadParameters;
+    size_t listElementSize;     ///< zero if the option isn't a list
 };
 
 static struct OptionTypeData s_optionTypeData[] =
 {
-    { 0, LoadCountingParameters },
-    { 1, LoadIntegerParameters },
-    { 1, LoadFloatParameters },
-    { 1, LoadStringParameters },
+    { 0, LoadCountingParameters, 0 },
+    { 1, LoadIntegerParameters, 0 },
+    { 1, LoadFloatParameters, 0 },
+    { 1, LoadStringParameters, 0 },
+    { 1, LoadInt64Parameters, 0 },
+    { 1, LoadDoubleParameters, 0 },
+    { 1, LoadIntegerParameters, sizeof(int) },
+    { 1, LoadFloatParameters, sizeof(float) },
+    { 1, LoadStringParameters, sizeof(CL_StringType) },
+    { 1, LoadInt64Parameters, sizeof(int64_t) },
+    { 1, LoadDoubleParameters, sizeof(double) },
+    { 1, LoadCustomParameters, 0 },
+};
+
+/**
+ * Text that values point into: a response file or stdin, which is tokenized in place, or the value
+ * of an environment variable.
+ */
+struct ResponseFile
+{
+    CL_CharType* text;
+    void* mapping;          ///< if the text is mapped rather than allocated
+    size_t mappingSize;
+};
+
+/**
+ * A setting from a config file, naming an option and giving its value.
+ */
+struct ConfigEntry
+{
+    CL_StringType name;
+    CL_StringType value;
+    unsigned int line;
+    int used;                   ///< whether the current parse has an option for it
 };
 
 /**
- * Command line arguments.
+ * A subcommand, whose options are only added if it's the one that's chosen.
  */
-struct CommandLineArgument
+struct Subcommand
 {
-    CL_StringType* value;
-    struct CommandLineArgument* next;
+    CL_StringType name;
+    CL_SubcommandFn addOptions;
+    void* data;
 };
 
 /**
  * The core opaque structure that gets returned.
+ *
+ * Everything it refers to lives in one block of memory, the arena, laid out as the list values
+ * being parsed (first, since they have the strictest alignment), then the custom options'
+ * parsers, then the options, then the arguments, then the overflow arguments, then the index.
+ * When any of them needs more room the whole arena is reallocated with more room for everything,
+ * so there are two allocations in all and the options and arguments are each in one array rather
+ * than scattered around the heap. The finished lists get a block of their own since callers hold
+ * pointers into it, and the arena can move if more options are added.
  */
 struct CommandLineProcessor_
 {
     CL_StringType appName;
-    struct CommandLineOption* options;
-    struct CommandLineArgument* arguments;
-    CL_StringType* overflow;
+
+    struct CommandLineOption* options;  ///< in the order they were added
+    size_t numOptions;
+    size_t optionCapacity;
+
+    CL_StringType** arguments;
+    size_t numArguments;
+    size_t argumentCapacity;
+
+    CL_StringType* overflow;    ///< NULL if overflow arguments aren't enabled
+    size_t overflowCapacity;
+
+    /// An open addressing hash of the options by name, holding option numbers plus one so that
+    /// zero is empty. It's built by CL_Parse and dropped when another option gets added. The size
+    /// is a power of two. With prefix matching, it's followed by the same option numbers sorted
+    /// by name.
+    unsigned int* index;
+    size_t indexSize;
+    size_t numSorted;
+    size_t indexCapacity;
+    int prefixMatching;
+    int globExpansion;
+
+    struct ListValue* listValues;   ///< only used during CL_Parse
+    size_t numListValues;
+    size_t numListOptions;
+    size_t listValueCapacity;
+
+    char* arena;
+    char* lists;                ///< the values of the list options, from the last CL_Parse
+
+    /// Response files have to stay around as long as the values that point into them.
+    int responseFilesEnabled;
+    struct ResponseFile* responseFiles;
+    size_t numResponseFiles;
+
+    CL_OverflowFn overflowFn;
+    void* overflowData;
+
+    /// Settings from a config file and the environment, which the command line overrides. The
+    /// file is read once, by the first parse, from its cache if that's up to date.
+    CL_StringType configPath;
+    CL_StringType configCachePath;
+    int configLoaded;
+    void* configText;           ///< what the entries point into, the file's text or its cache
+    struct ConfigEntry* configEntries;
+    size_t numConfigEntries;
+    CL_StringType environmentPrefix;
+    CL_StringType* environmentValues;   ///< the copies made so far, reused by later parses
+    size_t numEnvironmentValues;
+
+    /// There are only ever a few of these and they're looked up once per parse.
+    struct Subcommand* subcommands;
+    size_t numSubcommands;
+
+    struct CustomParser* parsers;   ///< for the custom options, which point at theirs
+    size_t numParsers;
+    size_t parserCapacity;
+
+    struct Subcommand* subcommand;  ///< the one chosen by the last CL_Parse
+
+    /// How many of everything there were before the chosen subcommand added its own, which is
+    /// what the next parse goes back to.
+    size_t numGlobalOptions;
+    size_t numGlobalArguments;
+    size_t numGlobalListOptions;
+    size_t numGlobalParsers;
 };
 
 /**
- * Create a CommandLineProcessor.
+ * Capacities grow geometrically so that adding options one at a time stays linear.
  */
-CommandLineProcessor CL_Create()
+static size_t Grow(size_t capacity, size_t needed)
 {
-    CommandLineProcessor clp = malloc(sizeof(struct CommandLineProcessor_));
-    clp->appName = NULL;
-    clp->options = NULL;
-    clp->arguments = NULL;
-    clp->overflow = NULL;
-    return clp;
+    if (needed <= capacity)
+        return capacity;
+    return (needed > capacity * 2) ? needed : capacity * 2;
 }
 
 /**
- * Destroy a CommandLineProcessor.
+ * Make sure there's room in the arena for the given number of everything, moving it if not.
  */
-void CL_Destroy(CommandLineProcessor clp)
+static void Reserve(CommandLineProcessor clp, size_t numOptions, size_t numArguments,
+                    size_t numOverflow, size_t indexSize, size_t numListValues, size_t numParsers)
 {
-    struct CommandLineOption* clo = clp->options;
-    while (clo != NULL)
+    if ((numOptions <= clp->optionCapacity) && (numArguments <= clp->argumentCapacity) &&
+        (numOverflow <= clp->overflowCapacity) && (indexSize <= clp->indexCapacity) &&
+        (numListValues <= clp->listValueCapacity) && (numParsers <= clp->parserCapacity))
     {
-        struct CommandLineOption* delete_me = clo;
-        clo = clo->next;
-        free(delete_me);
+        return;
     }
 
-    struct CommandLineArgument* cla = clp->arguments;
-    while (cla != NULL)
-    {
-        struct CommandLineArgument* delete_me = cla;
-        cla = cla->next;
-        free(delete_me);
-    }
+    size_t const optionCapacity = Grow(clp->optionCapacity, numOptions);
+    size_t const argumentCapacity = Grow(clp->argumentCapacity, numArguments);
+    size_t const overflowCapacity = Grow(clp->overflowCapacity, numOverflow);
+    size_t const indexCapacity = Grow(clp->indexCapacity, indexSize);
+    size_t const listValueCapacity = Grow(clp->listValueCapacity, numListValues);
+    size_t const parserCapacity = Grow(clp->parserCapacity, numParsers);
 
-    if (clp->overflow != NULL)
+    // the list values go first since they have the strictest alignment, then the parsers since
+    // they're all pointers
+    size_t const listValueBytes = listValueCapacity * sizeof(struct ListValue);
+    size_t const parserBytes = parserCapacity * sizeof(struct CustomParser);
+    size_t const optionBytes = optionCapacity * sizeof(struct CommandLineOption);
+    size_t const argumentBytes = argumentCapacity * sizeof(CL_StringType*);
+    size_t const overflowBytes = overflowCapacity * sizeof(CL_StringType);
+    size_t const indexBytes = indexCapacity * sizeof(unsigned int);
+    char* arena = malloc(listValueBytes + parserBytes + optionBytes + argumentBytes +
+                         overflowBytes + indexBytes);
+
+    struct ListValue* listValues = (struct ListValue*)arena;
+    struct CustomParser* parsers = (struct CustomParser*)(arena + listValueBytes);
+    char* const rest = arena + listValueBytes + parserBytes;
+    struct CommandLineOption* options = (struct CommandLineOption*)rest;
+    CL_StringType** arguments = (CL_StringType**)(rest + optionBytes);
+    CL_StringType* overflow = (CL_StringType*)(rest + optionBytes + argumentBytes);
+    unsigned int* index = (unsigned int*)(rest + optionBytes + argumentBytes + overflowBytes);
+
+    if (clp->numOptions > 0)
+        memcpy(options, clp->options, clp->numOptions * sizeof(struct CommandLineOption));
+    if (clp->numParsers > 0)
     {
-        free((void*)clp->overflow);
+        memcpy(parsers, clp->parsers, clp->numParsers * sizeof(struct CustomParser));
+        for (size_t i = 0; i < clp->numOptions; ++i)
+        {
+            if (options[i].type == OT_CUSTOM)
+                options[i].parser = parsers + (options[i].parser - clp->parsers);
+        }
     }
+    if (clp->numArguments > 0)
+        memcpy(arguments, clp->arguments, clp->numArguments * sizeof(CL_StringType*));
+    if (clp->overflow != NULL)
+        memcpy(overflow, clp->overflow, clp->overflowCapacity * sizeof(CL_StringType));
+    if (clp->indexSize > 0)
+        memcpy(index, clp->index, (clp->indexSize + clp->numSorted) * sizeof(unsigned int));
+    if (clp->numListValues > 0)
+        memcpy(listValues, clp->listValues, clp->numListValues * sizeof(struct ListValue));
 
-    free(clp);
+    free(clp->arena);
+    clp->arena = arena;
+    clp->options = options;
+    clp->optionCapacity = optionCapacity;
+    clp->arguments = arguments;
+    clp->argumentCapacity = argumentCapacity;
+    if (clp->overflow != NULL)
+        clp->overflow = overflow;
+    clp->overflowCapacity = overflowCapacity;
+    clp->index = index;
+    clp->indexCapacity = indexCapacity;
+    clp->listValues = listValues;
+    clp->listValueCapacity = listValueCapacity;
+    clp->parsers = parsers;
+    clp->parserCapacity = parserCapacity;
 }
 
 /**
- * Add a counting option to the CommandLineProcessor.
- *
- * A counting option adds one to \c *value each time it appears on the command line. This is
- * typically used to implement boolean options but a count of the number of times the option appears
- * is an easy extension.
+ * Create a CommandLineProcessor.
  */
-void CL_AddCountingOption(CommandLineProcessor clp, int* value, CL_StringType name)
+CommandLineProcessor CL_Create()
 {
-    struct CommandLineOption* clo = malloc(sizeof(struct CommandLineOption));
-    clo->type = OT_COUNTER;
-    clo->name = name;
-    clo->value = value;
-    clo->next = clp->options;
-    clp->options = clo;
-
-    *value = 0;
+    CommandLineProcessor clp = malloc(sizeof(struct CommandLineProcessor_));
+    memset(clp, 0, sizeof(struct CommandLineProcessor_));
+    Reserve(clp, 8, 4, 1, 16, 0, 0);
+    return clp;
 }
 
 /**
- * Add an integer option to the CommandLineProcessor.
- *
- * The value following the option is loaded into \c *value.
+ * Destroy a CommandLineProcessor.
  */
-void CL_AddIntegerOption(CommandLineProcessor clp, int* value, CL_StringType name)
+void CL_Destroy(CommandLineProcessor clp)
 {
-    struct CommandLineOption* clo = malloc(sizeof(struct CommandLineOption));
-    clo->type = OT_INTEGER;
-    clo->name = name;
-    clo->value = value;
-    clo->next = clp->options;
-    clp->options = clo;
+    for (size_t i = 0; i < clp->numResponseFiles; ++i)
+    {
+#if CL_USE_MMAP
+        if (clp->responseFiles[i].mapping != NULL)
+        {
+            munmap(clp->responseFiles[i].mapping, clp->responseFiles[i].mappingSize);
+            continue;
+        }
+#endif
+        free(clp->responseFiles[i].text);
+    }
+    free(clp->responseFiles);
+    free(clp->subcommands);
+    free(clp->configText);
+    free(clp->configEntries);
+    free(clp->environmentValues);
 
-    *value = 0;
+    free(clp->lists);
+    free(clp->arena);
+    free(clp);
 }
 
 /**
- * Add an floating point option to the CommandLineProcessor.
- *
- * The value following the option is loaded into \c *value.
+ * Add an option; the most recently added option of a name is the one that gets used.
  */
-void CL_AddFloatOption(CommandLineProcessor clp, float* value, CL_StringType name)
+static void AddOption(CommandLineProcessor clp, enum OptionType type, void* value,
+                      CL_StringType name)
 {
-    struct CommandLineOption* clo = malloc(sizeof(struct CommandLineOption));
-    clo->type = OT_FLOAT;
+    Reserve(clp, clp->numOptions + 1, 0, 0, 0, 0, 0);
+
+    struct CommandLineOption* clo = &clp->options[clp->numOptions++];
+    clo->type = type;
     clo->name = name;
     clo->value = value;
-    clo->next = clp->options;
-    clp->options = clo;
+    clo->count = NULL;
 
-    *value = 0;
+    clp->indexSize = 0;
 }
 
 /**
- * Add a string option to the CommandLineProcessor.
- *
- * The value following the option is loaded into \c *value.
+ * FNV-1a over the characters of an option name.
  */
-void CL_AddStringOption(CommandLineProcessor clp, CL_StringType* value, CL_StringType name)
+static size_t HashName(CL_StringType name)
 {
-    struct CommandLineOption* clo = malloc(sizeof(struct CommandLineOption));
-    clo->type = OT_STRING;
-    clo->name = name;
-    clo->value = (void*)value;
-    clo->next = clp->options;
-    clp->options = clo;
-
-    *value = NULL;
+    size_t h = 2166136261u;
+    while (*name != '\0')
+    {
+        h = (h ^ (size_t)*name) * 16777619u;
+        ++name;
+    }
+    return h;
 }
 
 /**
- * Add a argument for the command line.
+ * Merge sort option numbers (plus one) by name; qsort would need the options in a global.
  */
-void CL_AddArgument(CommandLineProcessor clp, CL_StringType* value)
+static void SortByName(struct CommandLineOption const* options, unsigned int* numbers,
+                       unsigned int* scratch, size_t count)
 {
-    struct CommandLineArgument* cla = malloc(sizeof(struct CommandLineArgument));
-    cla->value = value;
-    cla->next = NULL;
-
-    struct CommandLineArgument** end = &clp->arguments;
-    while (*end != NULL)
+    unsigned int* from = numbers;
+    unsigned int* to = scratch;
+    for (size_t width = 1; width < count; width *= 2)
     {
-        end = &((*end)->next);
+        for (size_t low = 0; low < count; low += 2 * width)
+        {
+            size_t const middle = (low + width < count) ? low + width : count;
+            size_t const high = (low + 2 * width < count) ? low + 2 * width : count;
+            size_t i = low, j = middle, k = low;
+            while ((i < middle) && (j < high))
+            {
+                if (STRCMP(options[from[j] - 1].name, options[from[i] - 1].name) < 0)
+                    to[k++] = from[j++];
+                else
+                    to[k++] = from[i++];
+            }
+            while (i < middle)
+                to[k++] = from[i++];
+            while (j < high)
+                to[k++] = from[j++];
+        }
+        unsigned int* const swap = from;
+        from = to;
+        to = swap;
     }
-    *end = cla;
-
-    *value = NULL;
+    if (from != numbers)
+        memcpy(numbers, from, count * sizeof(unsigned int));
 }
 
 /**
- * Let the system track non-option arguments.
+ * Build the option index, at most half full. Options are added newest first and a name that's
+ * already there is skipped, so the newest option of each name is the one that gets found.
  */
-void CL_EnableOverflowArguments(CommandLineProcessor clp)
+static void BuildIndex(CommandLineProcessor clp)
 {
-    if (clp->overflow == NULL)
+    size_t size = 16;
+    while (size < clp->numOptions * 2)
+        size *= 2;
+
+    // the sorted list needs as much again for sorting
+    size_t const sortedSpace = clp->prefixMatching ? 2 * clp->numOptions : 0;
+    Reserve(clp, 0, 0, 0, size + sortedSpace, 0, 0);
+    clp->indexSize = size;
+    clp->numSorted = 0;
+    memset(clp->index, 0, size * sizeof(unsigned int));
+
+    for (size_t i = clp->numOptions; i > 0; --i)
     {
-        clp->overflow = malloc(sizeof(CL_StringType));
-        *(clp->overflow) = NULL;
+        CL_StringType name = clp->options[i - 1].name;
+        size_t slot = HashName(name) & (size - 1);
+        while ((clp->index[slot] != 0) &&
+               (STRCMP(clp->options[clp->index[slot] - 1].name, name) != 0))
+        {
+            slot = (slot + 1) & (size - 1);
+        }
+
+        if (clp->index[slot] == 0)
+            clp->index[slot] = (unsigned int)i;
+    }
+
+    if (clp->prefixMatching)
+    {
+        // the hash has exactly the options that can be found, so sort those
+        unsigned int* const sorted = clp->index + size;
+        for (size_t slot = 0; slot < size; ++slot)
+        {
+            if (clp->index[slot] != 0)
+                sorted[clp->numSorted++] = clp->index[slot];
+        }
+        SortByName(clp->options, sorted, sorted + clp->numSorted, clp->numSorted);
     }
 }
 
 /**
- * Get the overflow arguments.
+ * Look an option up by name in an index built by BuildIndex(), returning its number or -1.
  */
-CL_StringType* CL_GetOverflowArguments(CommandLineProcessor clp)
+static long LookUp(struct CommandLineOption const* options, unsigned int const* index,
+                   size_t indexSize, CL_StringType name)
 {
-    return clp->overflow;
+    size_t const mask = indexSize - 1;
+    size_t slot = HashName(name) & mask;
+    unsigned int i;
+    while ((i = index[slot]) != 0)
+    {
+        if (STRCMP(options[i - 1].name, name) == 0)
+            return (long)i - 1;
+        slot = (slot + 1) & mask;
+    }
+    return -1;
 }
 
 /**
- * Get the application's name.
+ * Look up the one option whose name starts with \c prefix in the sorted option numbers, returning
+ * its number, -1 if there isn't one, or -2 if there's more than one. This is a binary search for
+ * the first name not before the prefix; if that and the name after both start with the prefix,
+ * it's ambiguous.
  */
-CL_StringType CL_GetAppName(CommandLineProcessor clp)
+static long LookUpPrefix(struct CommandLineOption const* options, unsigned int const* sorted,
+                         size_t numSorted, CL_StringType prefix, size_t* first)
 {
-    return clp->appName;
+    size_t const length = STRLEN(prefix);
+    size_t low = 0, high = numSorted;
+    while (low < high)
+    {
+        size_t const middle = (low + high) / 2;
+        if (STRCMP(options[sorted[middle] - 1].name, prefix) < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    *first = low;
+    if ((length == 0) || (low >= numSorted) ||
+        (STRNCMP(options[sorted[low] - 1].name, prefix, length) != 0))
+    {
+        return -1;
+    }
+    if ((low + 1 < numSorted) && (STRNCMP(options[sorted[low + 1] - 1].name, prefix, length) == 0))
+        return -2;
+    return (long)sorted[low] - 1;
 }
 
+/// How many of the options an ambiguous prefix could be are listed
+enum { k_maxCandidates = 8 };
+
 /**
- * Do the parse.
+ * Find the option for \c arg, which still has its '-', by name or, if \c numSorted isn't zero,
+ * by a unique prefix. If there isn't one it says why and returns -1.
  */
-int CL_Parse(CommandLineProcessor clp, int argc, CL_StringType* argv)
+static long FindOption(struct CommandLineOption const* options, unsigned int const* index,
+                       size_t indexSize, unsigned int const* sorted, size_t numSorted,
+                       CL_StringType arg)
 {
-    clp->appName = argv[0];
-    int numErrors = 0;
+    long n = LookUp(options, index, indexSize, arg + 1);
+    if (n >= 0)
+        return n;
 
-    struct CommandLineArgument* cla = clp->arguments;
+    size_t first = 0;
+    if (numSorted > 0)
+        n = LookUpPrefix(options, sorted, numSorted, arg + 1, &first);
+    if (n >= 0)
+        return n;
 
-    if (clp->overflow != NULL)
+    if (n == -1)
     {
-        free((void*)clp->overflow);
-        clp->overflow = malloc(sizeof(CL_StringType) * argc);
+        CL_Report(CL_UNKNOWN_OPTION, arg, NULL);
+        return -1;
     }
-    CL_StringType* overflow = clp->overflow;
 
-    for (int i = 1; i < argc; ++i)
+    // what it could be, and whether there are more than get listed
+    CL_StringType candidates[k_maxCandidates + 1];
+    size_t const length = STRLEN(arg + 1);
+    size_t count = 0;
+    for (size_t i = first; (i < numSorted) && (count <= k_maxCandidates); ++i)
     {
-        CL_StringType arg = argv[i];
-        if ((arg[0] == '-') || (arg[0] == '/'))
-        {
-            struct CommandLineOption* o = clp->options;
-            while ((o != NULL) && (STRCMP(o->name, arg+1) != 0))
-                o = o->next;
+        CL_StringType const name = options[sorted[i] - 1].name;
+        if (STRNCMP(name, arg + 1, length) != 0)
+            break;
+        candidates[count++] = name;
+    }
+    CL_ReportAmbiguousOption(arg, candidates, count);
+    return -1;
+}
 
-            if (o != NULL)
-            {
-                struct OptionTypeData const* otd = &s_optionTypeData[o->type];
-                int numArgsLeft = argc - (i + 1);
-                if (numArgsLeft >= otd->numParameters)
-                {
-                    int paramsLoaded = otd->loadParameters(o, &argv[i+1]);
-                    if (paramsLoaded != otd->numParameters)
-                        ++numErrors;
-                    i += paramsLoaded;
-                }
-                else
-                {
-                    Error("Command line option '" STR "' requires %d parameters but only %d are "
-                          "available.", arg, otd->numParameters, numArgsLeft);
-                    ++numErrors;
-                }
-            }
-            else
-            {
-                Error("Unknown option '" STR "'.", arg);
-                ++numErrors;
-            }
-        }
-        else if (cla != NULL)
-        {
-            *(cla->value) = arg;
-            cla = cla->next;
-        }
-        else
+/**
+ * Say that option \c arg is ambiguous, listing what it could be: the first eight of the \c count
+ * \c candidates, and that there are others if there are more than that.
+ */
+void CL_ReportAmbiguousOption(CL_StringType arg, CL_StringType const* candidates, size_t count)
+{
+    char list[256] = "";
+    size_t used = 0;
+    for (size_t i = 0; (i < count) && (used < sizeof(list)); ++i)
+    {
+        if (i == k_maxCandidates)
         {
-            if (overflow != NULL)
-            {
-                *overflow = arg;
-                ++overflow;
-            }
-            else
-            {
-                Error("Argument '" STR "' can't be handled.", arg);
-                ++numErrors;
-            }
+            snprintf(list + used, sizeof(list) - used, ", or others");
+            break;
         }
+        int const written = snprintf(list + used, sizeof(list) - used, "%s'%c" STR "'",
+                                     (i > 0) ? ", " : "", (char)arg[0], candidates[i]);
+        if (written < 0)
+            break;
+        used += (size_t)written;
     }
+    Error("Option '" STR "' is ambiguous; it could be %s.", arg, list);
+}
 
-    if (overflow != NULL)
-    {
-        *overflow = NULL;
+/**
+ * What CL_Report() and CL_ReportUtf8() say for each CL_Problem, with \c S where the text goes.
+ */
+#define MESSAGES(S)                                                                         \
+    {                                                                                       \
+        "Unknown option '" S "'.",                                                          \
+        "Command line option '" S "' requires 1 parameters but only 0 are available.",      \
+        "'" S "' is not a valid parameter to '-" S "'.",                                    \
+        "'" S "' is out of range for '-" S "'.",                                            \
+        "Argument '" S "' can't be handled.",                                               \
     }
 
-    return numErrors == 0;
-}
+static char const* const s_messages[] = MESSAGES(STR);
+static char const* const s_utf8Messages[] = MESSAGES("%s");
 
 /**
- * Load parameters into the OT_COUNTER command line option.
+ * Report a problem with an argument, or with a parameter to the option called \c name.
  */
-int LoadCountingParameters(struct CommandLineOption* o, CL_StringType* params)
+void CL_Report(CL_Problem problem, CL_StringType text, CL_StringType name)
 {
-    *(int*)(o->value) += 1;
-    return 0;
+    Error(s_messages[problem], text, name);
 }
 
 /**
- * Load parameters into the OT_INTEGER command line option.
+ * Report a problem in the same words as CL_Report(), for front ends whose arguments aren't in
+ * this build's character type and so are given in UTF-8.
  */
-int LoadIntegerParameters(struct CommandLineOption* o, CL_StringType* params)
+void CL_ReportUtf8(CL_Problem problem, char const* text, char const* name)
 {
-    int *v = o->value;
-    CL_StringType p = params[0];
+    Error(s_utf8Messages[problem], text, name);
+}
 
-    int negator = 1;
-    if (*p == '-')
+/**
+ * Read all of a stream into one allocation, with a terminator.
+ */
+static char* ReadAll(FILE* f, size_t* length)
+{
+    size_t capacity = 64 * 1024;
+    size_t size = 0;
+    char* text = malloc(capacity + 1);
+    size_t n;
+    while ((n = fread(text + size, 1, capacity - size, f)) > 0)
     {
-        negator = -1;
-        ++p;
+        size += n;
+        if (size == capacity)
+        {
+            capacity *= 2;
+            text = realloc(text, capacity + 1);
+        }
     }
+    text[size] = '\0';
+    *length = size;
+    return text;
+}
 
-    while ((*p != '\0') && (*p >= '0') && (*p <= '9'))
-    {
-        *v = (*v * 10) + (*p - '0');
-        ++p;
-    }
+/**
+ * Open a file by a name that may be wide.
+ */
+static FILE* OpenFile(CL_StringType name, int forWriting)
+{
+#if defined(_WIN32) && CL_USE_wchar_t
+    return _wfopen(name, forWriting ? L"wb" : L"rb");
+#elif CL_USE_wchar_t
+    char path[4096];
+    size_t n = wcstombs(path, name, sizeof(path));
+    return ((n > 0) && (n < sizeof(path))) ? fopen(path, forWriting ? "wb" : "rb") : NULL;
+#else
+    return fopen(name, forWriting ? "wb" : "rb");
+#endif
+}
 
-    if (*p != '\0')
-        Error("'" STR "' is not a valid parameter to '-" STR "'.", params[0], o->name);
+/**
+ * Turn text as read from a file into CL_CharTypes, taking ownership of \c bytes. Wide builds need
+ * the text converted, so this is one copy rather than none.
+ */
+static CL_CharType* WidenText(char* bytes, size_t length)
+{
+#if CL_USE_wchar_t
+    CL_CharType* text = malloc((length + 1) * sizeof(CL_CharType));
+    size_t converted = mbstowcs(text, bytes, length + 1);
+    if (converted == (size_t)-1)
+        converted = 0;
+    text[converted] = L'\0';
+    free(bytes);
+    return text;
+#else
+    (void)length;
+    return bytes;
+#endif
+}
 
-    *v *= negator;
-    return (*p == '\0') ? 1 : 0;
+/**
+ * Keep allocated text for as long as the values that point into it.
+ */
+static void KeepText(CommandLineProcessor clp, CL_CharType* text)
+{
+    struct ResponseFile const rf = { text, NULL, 0 };
+    clp->responseFiles = realloc(clp->responseFiles,
+                                 (clp->numResponseFiles + 1) * sizeof(struct ResponseFile));
+    clp->responseFiles[clp->numResponseFiles++] = rf;
 }
 
+#if CL_USE_MMAP
 /**
- * Load parameters into the OT_FLOAT command line option.
+ * Map a regular file privately, so that it can be tokenized in place without touching the file,
+ * with a page of zeros after it so that the last token always has a terminator.
  */
-int LoadFloatParameters(struct CommandLineOption* o, CL_StringType* params)
+static int MapFile(int fd, struct ResponseFile* rf)
 {
-    float *v = o->value;
-    CL_StringType p = params[0];
+    struct stat st;
+    if ((fstat(fd, &st) != 0) || !S_ISREG(st.st_mode) || (st.st_size == 0))
+        return 0;
 
-    float negator = 1.0f;
-    if (*p == '-')
+    size_t const size = (size_t)st.st_size;
+    size_t const page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t const mappingSize = (size + page) / page * page;
+
+    void* mapping = mmap(NULL, mappingSize, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED)
+        return 0;
+    if (mmap(mapping, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
     {
-        negator = -1.0f;
-        ++p;
+        munmap(mapping, mappingSize);
+        return 0;
     }
 
-    while ((*p != '\0') && (*p >= '0') && (*p <= '9'))
+    rf->text = mapping;
+    rf->mapping = mapping;
+    rf->mappingSize = mappingSize;
+    return 1;
+}
+#endif
+
+/**
+ * Load a response file, or stdin if \c name is NULL. Returns its text, or NULL if it couldn't be
+ * read.
+ */
+static CL_CharType* LoadResponseFile(CommandLineProcessor clp, CL_StringType name)
+{
+    struct ResponseFile rf = { NULL, NULL, 0 };
+
+#if CL_USE_MMAP
+    int const fd = (name != NULL) ? open(name, O_RDONLY) : 0;
+    if (fd < 0)
+        return NULL;
+    if (MapFile(fd, &rf))
     {
-        *v = (*v * 10.0f) + (*p - '0');
-        ++p;
+        if (name != NULL)
+            close(fd);
     }
-
-    if (*p == '.')
+    else
     {
-        float accumulator = 0.0f;
-        float divider = 1.0f;
+        // stdin is usually a pipe, and that can't be mapped
+        FILE* f = (name != NULL) ? fdopen(fd, "rb") : stdin;
+        if (f == NULL)
+        {
+            close(fd);
+            return NULL;
+        }
+        size_t length;
+        rf.text = ReadAll(f, &length);
+        if (name != NULL)
+            fclose(f);
+    }
+#else
+    FILE* f = stdin;
+    if (name != NULL)
+    {
+        f = OpenFile(name, 0);
+        if (f == NULL)
+            return NULL;
+    }
+    size_t length;
+    char* bytes = ReadAll(f, &length);
+    if (name != NULL)
+        fclose(f);
+    rf.text = WidenText(bytes, length);
+#endif
+
+    clp->responseFiles = realloc(clp->responseFiles,
+                                 (clp->numResponseFiles + 1) * sizeof(struct ResponseFile));
+    clp->responseFiles[clp->numResponseFiles++] = rf;
+    return rf.text;
+}
+
+static int IsSpace(CL_CharType c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n');
+}
 
+/**
+ * Take the next token from a response file, terminating it in place. Tokens are separated by
+ * whitespace; double quotes group whitespace into a token and a backslash escapes a quote or a
+ * backslash. Returns NULL at the end of the text.
+ */
+static CL_StringType NextToken(CL_CharType** cursor)
+{
+    CL_CharType* p = *cursor;
+    while (IsSpace(*p))
         ++p;
+    if (*p == '\0')
+    {
+        *cursor = p;
+        return NULL;
+    }
 
-        while ((*p != '\0') && (*p >= '0') && (*p <= '9'))
+    // unquoting only ever shortens the token, so it's rewritten over itself
+    CL_CharType* const token = p;
+    CL_CharType* out = p;
+    int quoted = 0;
+    while ((*p != '\0') && (quoted || !IsSpace(*p)))
+    {
+        if (*p == '"')
         {
-            accumulator = (accumulator * 10.0f) + (*p - '0');
-            divider *= 10.0f;
+            quoted = !quoted;
             ++p;
         }
-
-        *v += (accumulator / divider);
+        else if ((*p == '\\') && ((p[1] == '"') || (p[1] == '\\')))
+        {
+            *out++ = p[1];
+            p += 2;
+        }
+        else
+        {
+            *out++ = *p++;
+        }
     }
 
+    *cursor = (*p != '\0') ? p + 1 : p;
+    *out = '\0';
+    return token;
+}
+
+/**
+ * Where a parse gets its arguments: the command line, with response files spliced in if there's a
+ * processor that has them enabled.
+ */
+struct ArgumentSource
+{
+    int argc;
+    CL_StringType* argv;
+    int next;
+    CL_CharType* cursor;        ///< in the response file being read, or NULL
+    CL_StringType pushedBack;
+};
+
+static CL_StringType NextArgument(CommandLineProcessor clp, struct ArgumentSource* src,
+                                  int isParameter, int* numErrors)
+{
+    if (src->pushedBack != NULL)
+    {
+        CL_StringType arg = src->pushedBack;
+        src->pushedBack = NULL;
+        return arg;
+    }
+
+    for (;;)
+    {
+        if (src->cursor != NULL)
+        {
+            CL_StringType token = NextToken(&src->cursor);
+            if (token != NULL)
+                return token;
+            src->cursor = NULL;
+        }
+
+        if (src->next >= src->argc)
+            return NULL;
+
+        CL_StringType arg = src->argv[src->next++];
+        // an option's parameter is taken as it is, so that "-out -" still means stdout
+        int const expand = (clp != NULL) && clp->responseFilesEnabled && !isParameter;
+        int const isFile = expand && (arg[0] == '@');
+        int const isStdin = expand && (arg[0] == '-') && (arg[1] == '\0');
+        if (!isFile && !isStdin)
+            return arg;
+
+        src->cursor = LoadResponseFile(clp, isFile ? arg + 1 : NULL);
+        if (src->cursor == NULL)
+        {
+            Error("Couldn't read the arguments in '" STR "'.", arg);
+            ++*numErrors;
+        }
+    }
+}
+
+/**
+ * Add a counting option to the CommandLineProcessor.
+ *
+ * A counting option adds one to \c *value each time it appears on the command line. This is
+ * typically used to implement boolean options but a count of the number of times the option appears
+ * is an easy extension.
+ */
+void CL_AddCountingOption(CommandLineProcessor clp, int* value, CL_StringType name)
+{
+    AddOption(clp, OT_COUNTER, value, name);
+    *value = 0;
+}
+
+/**
+ * Add an integer option to the CommandLineProcessor.
+ *
+ * The value following the option is loaded into \c *value.
+ */
+void CL_AddIntegerOption(CommandLineProcessor clp, int* value, CL_StringType name)
+{
+    AddOption(clp, OT_INTEGER, value, name);
+    *value = 0;
+}
+
+/**
+ * Add an floating point option to the CommandLineProcessor.
+ *
+ * The value following the option is loaded into \c *value.
+ */
+void CL_AddFloatOption(CommandLineProcessor clp, float* value, CL_StringType name)
+{
+    AddOption(clp, OT_FLOAT, value, name);
+    *value = 0;
+}
+
+/**
+ * Add a string option to the CommandLineProcessor.
+ *
+ * The value following the option is loaded into \c *value.
+ */
+void CL_AddStringOption(CommandLineProcessor clp, CL_StringType* value, CL_StringType name)
+{
+    AddOption(clp, OT_STRING, (void*)value, name);
+    *value = NULL;
+}
+
+/**
+ * Add a 64 bit integer option to the CommandLineProcessor.
+ *
+ * The value following the option is loaded into \c *value.
+ */
+void CL_AddInt64Option(CommandLineProcessor clp, int64_t* value, CL_StringType name)
+{
+    AddOption(clp, OT_INT64, value, name);
+    *value = 0;
+}
+
+/**
+ * Add a double precision option to the CommandLineProcessor.
+ *
+ * The value following the option is loaded into \c *value.
+ */
+void CL_AddDoubleOption(CommandLineProcessor clp, double* value, CL_StringType name)
+{
+    AddOption(clp, OT_DOUBLE, value, name);
+    *value = 0;
+}
+
+/**
+ * Add an option of a type of the caller's own, like an enum or a duration.
+ *
+ * The value following the option is handed to \c parse along with \c value and \c data, and it
+ * returns 1 if it loaded the value, 0 if the text isn't valid, or -1 if it's out of range, as
+ * CL_ParseInt64() does; the errors are reported like those of the built in types. Unlike them,
+ * \c *value isn't reset, so whatever it holds is the default. The parser is called during
+ * CL_Parse(), and for a spec from any thread that's parsing with it.
+ */
+void CL_AddCustomOption(CommandLineProcessor clp, void* value, CL_StringType name,
+                        CL_ParseFn parse, void* data)
+{
+    // both at once, since either could move the other
+    Reserve(clp, clp->numOptions + 1, 0, 0, 0, 0, clp->numParsers + 1);
+    struct CustomParser* parser = &clp->parsers[clp->numParsers++];
+    parser->parse = parse;
+    parser->data = data;
+
+    AddOption(clp, OT_CUSTOM, value, name);
+    clp->options[clp->numOptions - 1].parser = parser;
+}
+
+/**
+ * Add a list option of any type.
+ */
+static void AddListOption(CommandLineProcessor clp, enum OptionType type, void* values,
+                          size_t* count, CL_StringType name)
+{
+    AddOption(clp, type, values, name);
+    clp->options[clp->numOptions - 1].count = count;
+    ++clp->numListOptions;
+    *(void const**)values = NULL;
+    *count = 0;
+}
+
+/**
+ * Add an integer list option to the CommandLineProcessor.
+ *
+ * Each time the option appears its value is added to the list. After the parse \c *values points
+ * to the \c *count values in the order they appeared; they belong to the CommandLineProcessor and
+ * last until it's destroyed or parses again.
+ */
+void CL_AddIntegerListOption(CommandLineProcessor clp, int const** values, size_t* count,
+                             CL_StringType name)
+{
+    AddListOption(clp, OT_INTEGER_LIST, (void*)values, count, name);
+}
+
+/**
+ * Add a floating point list option to the CommandLineProcessor. See CL_AddIntegerListOption().
+ */
+void CL_AddFloatListOption(CommandLineProcessor clp, float const** values, size_t* count,
+                           CL_StringType name)
+{
+    AddListOption(clp, OT_FLOAT_LIST, (void*)values, count, name);
+}
+
+/**
+ * Add a string list option to the CommandLineProcessor. See CL_AddIntegerListOption().
+ */
+void CL_AddStringListOption(CommandLineProcessor clp, CL_StringType const** values,
+                            size_t* count, CL_StringType name)
+{
+    AddListOption(clp, OT_STRING_LIST, (void*)values, count, name);
+}
+
+/**
+ * Add a 64 bit integer list option to the CommandLineProcessor. See CL_AddIntegerListOption().
+ */
+void CL_AddInt64ListOption(CommandLineProcessor clp, int64_t const** values, size_t* count,
+                           CL_StringType name)
+{
+    AddListOption(clp, OT_INT64_LIST, (void*)values, count, name);
+}
+
+/**
+ * Add a double precision list option to the CommandLineProcessor. See CL_AddIntegerListOption().
+ */
+void CL_AddDoubleListOption(CommandLineProcessor clp, double const** values, size_t* count,
+                            CL_StringType name)
+{
+    AddListOption(clp, OT_DOUBLE_LIST, (void*)values, count, name);
+}
+
+/**
+ * Add a argument for the command line.
+ */
+void CL_AddArgument(CommandLineProcessor clp, CL_StringType* value)
+{
+    Reserve(clp, 0, clp->numArguments + 1, 0, 0, 0, 0);
+    clp->arguments[clp->numArguments++] = value;
+
+    *value = NULL;
+}
+
+/**
+ * Let the system track non-option arguments.
+ */
+void CL_EnableOverflowArguments(CommandLineProcessor clp)
+{
+    if (clp->overflow == NULL)
+    {
+        clp->overflow = (CL_StringType*)((char*)clp->arguments +
+                                         clp->argumentCapacity * sizeof(CL_StringType*));
+        *(clp->overflow) = NULL;
+    }
+}
+
+/**
+ * Get the overflow arguments.
+ */
+CL_StringType* CL_GetOverflowArguments(CommandLineProcessor clp)
+{
+    return clp->overflow;
+}
+
+/**
+ * Hand overflow arguments to \c fn one at a time as they're parsed instead of collecting them.
+ */
+void CL_StreamOverflowArguments(CommandLineProcessor clp, CL_OverflowFn fn, void* data)
+{
+    CL_EnableOverflowArguments(clp);
+    clp->overflowFn = fn;
+    clp->overflowData = data;
+}
+
+/**
+ * Read arguments from the file named by an argument starting with '@', and from stdin for an
+ * argument of just '-'.
+ */
+void CL_EnableResponseFiles(CommandLineProcessor clp)
+{
+    clp->responseFilesEnabled = 1;
+}
+
+/**
+ * Let options be given by any prefix of their names that no other option shares, so "-verb" will
+ * do for "-verbose". A name given in full always matches its own option, even if it's the start of
+ * others too.
+ */
+void CL_EnablePrefixMatching(CommandLineProcessor clp)
+{
+    clp->prefixMatching = 1;
+    clp->indexSize = 0;
+}
+
+/**
+ * Expand overflow arguments that have wildcards into the paths they match, as a Unix shell
+ * would; see ExpandPattern().
+ */
+void CL_EnableGlobExpansion(CommandLineProcessor clp)
+{
+    clp->globExpansion = 1;
+}
+
+/**
+ * Add a subcommand. If the first argument on the command line, after any options, is \c name,
+ * then \c addOptions is called with \c data to add the subcommand's options and arguments, and
+ * parsing carries on with those as well as the ones that were there already. Options of the same
+ * name are the subcommand's from then on. Once there are subcommands the first argument has to be
+ * one of them; CL_GetSubcommand() says which, or gives NULL if there wasn't one.
+ *
+ * Nothing of a subcommand's is built unless it's chosen, so having lots of them costs next to
+ * nothing. Each parse drops the options and arguments the last one's subcommand added, so they're
+ * added again whenever it's chosen, and options added after such a parse are taken to be that
+ * subcommand's too.
+ */
+void CL_AddSubcommand(CommandLineProcessor clp, CL_StringType name, CL_SubcommandFn addOptions,
+                      void* data)
+{
+    clp->subcommands = realloc(clp->subcommands,
+                               (clp->numSubcommands + 1) * sizeof(struct Subcommand));
+    struct Subcommand* sc = &clp->subcommands[clp->numSubcommands++];
+    sc->name = name;
+    sc->addOptions = addOptions;
+    sc->data = data;
+}
+
+/**
+ * Get the name of the subcommand the last parse chose, or NULL if none was.
+ */
+CL_StringType CL_GetSubcommand(CommandLineProcessor clp)
+{
+    return (clp->subcommand != NULL) ? clp->subcommand->name : NULL;
+}
+
+/**
+ * Choose the subcommand named by \c arg and add its options.
+ */
+static int ChooseSubcommand(CommandLineProcessor clp, CL_StringType arg)
+{
+    for (size_t i = 0; i < clp->numSubcommands; ++i)
+    {
+        struct Subcommand* sc = &clp->subcommands[i];
+        if (STRCMP(sc->name, arg) != 0)
+            continue;
+
+        clp->subcommand = sc;
+        clp->numGlobalOptions = clp->numOptions;
+        clp->numGlobalArguments = clp->numArguments;
+        clp->numGlobalListOptions = clp->numListOptions;
+        clp->numGlobalParsers = clp->numParsers;
+        sc->addOptions(clp, sc->data);
+        if (clp->indexSize == 0)
+            BuildIndex(clp);
+        return 1;
+    }
+
+    Error("Unknown command '" STR "'.", arg);
+    return 0;
+}
+
+/**
+ * Get the application's name.
+ */
+CL_StringType CL_GetAppName(CommandLineProcessor clp)
+{
+    return clp->appName;
+}
+
+/**
+ * Load the parameters of an option. List values are collected as they come and sorted out at the
+ * end of the parse. Returns nonzero if they loaded.
+ */
+static int LoadOption(CommandLineProcessor clp, size_t option, CL_StringType const* params)
+{
+    struct CommandLineOption* o = &clp->options[option];
+    struct OptionTypeData const* otd = &s_optionTypeData[o->type];
+
+    void* value = o->value;
+    if (otd->listElementSize != 0)
+    {
+        Reserve(clp, 0, 0, 0, 0, clp->numListValues + 1, 0);
+        o = &clp->options[option];
+        clp->listValues[clp->numListValues].option = (unsigned int)option;
+        value = &clp->listValues[clp->numListValues].value;
+    }
+
+    int const loaded = otd->loadParameters(o, params, value);
+    if ((otd->listElementSize != 0) && (loaded == otd->numParameters))
+        ++clp->numListValues;
+    return loaded == otd->numParameters;
+}
+
+/**
+ * Take settings from the file at \c path, overridden by the environment and then the command
+ * line. Each line of the file is "name = value", where the name is an option's name without the
+ * '-'; blank lines and lines starting with '#' or ';' are skipped. A value can be quoted to keep
+ * the spaces at its ends, with a backslash escaping a quote or a backslash as in response files.
+ * It's not an error for the file to be missing, but it is for it to name an unknown option,
+ * unless there are subcommands.
+ *
+ * If \c cachePath isn't NULL the settings are saved there once they've been parsed, in a binary
+ * form that later runs load instead of parsing the text, so long as the file hasn't changed.
+ */
+void CL_EnableConfigFile(CommandLineProcessor clp, CL_StringType path, CL_StringType cachePath)
+{
+    clp->configPath = path;
+    clp->configCachePath = cachePath;
+    clp->configLoaded = 0;
+}
+
+/**
+ * Take settings from environment variables, overridden by the command line. An option's variable
+ * is \c prefix followed by its name in upper case with anything other than letters and digits
+ * turned into underscores, so with a prefix of "TOOL_", "-max-jobs" comes from TOOL_MAX_JOBS.
+ */
+void CL_EnableEnvironment(CommandLineProcessor clp, CL_StringType prefix)
+{
+    clp->environmentPrefix = prefix;
+}
+
+/**
+ * The config cache starts with this, then has an entry for each setting, and then the names and
+ * values, terminated, that the entries refer to.
+ */
+struct ConfigCacheHeader
+{
+    uint32_t magic;
+    uint32_t charSize;          ///< so that narrow and wide builds don't read each other's
+    uint64_t fileHash;          ///< of the text of the file it was made from
+    uint64_t fileSize;
+    uint32_t numEntries;
+    uint32_t checksum;          ///< of everything after the header, in case a write was cut short
+    uint64_t size;              ///< of everything after the header
+};
+
+struct ConfigCacheEntry
+{
+    uint32_t name;              ///< in characters from the start of the strings
+    uint32_t value;
+    uint32_t line;
+};
+
+static uint32_t const k_configCacheMagic = 0x46434c43;     // "CLCF"
+
+static uint32_t Checksum(void const* data, size_t size)
+{
+    unsigned char const* p = data;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < size; ++i)
+        h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+/**
+ * A 64 bit FNV-1a hash of the config file's text. It's far quicker to hash the text than to parse
+ * it, and unlike a modification time it can't miss an edit.
+ */
+static uint64_t FileHash(void const* data, size_t size)
+{
+    unsigned char const* p = data;
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i)
+        h = (h ^ p[i]) * 1099511628211ull;
+    return h;
+}
+
+/**
+ * Load the settings from the cache, if it's there, intact, and made from the file as it is now.
+ */
+static int LoadConfigCache(CommandLineProcessor clp, uint64_t fileHash, uint64_t fileSize)
+{
+    FILE* f = OpenFile(clp->configCachePath, 0);
+    if (f == NULL)
+        return 0;
+    size_t length;
+    char* bytes = ReadAll(f, &length);
+    fclose(f);
+
+    struct ConfigCacheHeader h;
+    int ok = (length >= sizeof(h));
+    if (ok)
+    {
+        memcpy(&h, bytes, sizeof(h));
+        ok = (h.magic == k_configCacheMagic) && (h.charSize == sizeof(CL_CharType)) &&
+             (h.fileHash == fileHash) && (h.fileSize == fileSize) &&
+             (h.size == length - sizeof(h)) &&
+             (h.numEntries <= h.size / sizeof(struct ConfigCacheEntry)) &&
+             (Checksum(bytes + sizeof(h), (size_t)h.size) == h.checksum);
+    }
+
+    // and everything has to point inside, with the last string terminated
+    struct ConfigCacheEntry const* entries = (struct ConfigCacheEntry const*)(bytes + sizeof(h));
+    CL_CharType const* strings = (CL_CharType const*)(entries + (ok ? h.numEntries : 0));
+    size_t const numChars = ok ? (size_t)(bytes + length - (char const*)strings) /
+                                 sizeof(CL_CharType) : 0;
+    ok = ok && ((h.numEntries == 0) || ((numChars > 0) && (strings[numChars - 1] == '\0')));
+    for (uint32_t i = 0; ok && (i < h.numEntries); ++i)
+        ok = (entries[i].name < numChars) && (entries[i].value < numChars);
+    if (!ok)
+    {
+        free(bytes);
+        return 0;
+    }
+
+    clp->configText = bytes;
+    clp->configEntries = malloc((h.numEntries + 1) * sizeof(struct ConfigEntry));
+    clp->numConfigEntries = h.numEntries;
+    for (uint32_t i = 0; i < h.numEntries; ++i)
+    {
+        struct ConfigEntry* e = &clp->configEntries[i];
+        e->name = strings + entries[i].name;
+        e->value = strings + entries[i].value;
+        e->line = entries[i].line;
+        e->used = 0;
+    }
+    return 1;
+}
+
+/**
+ * Save the settings for next time. Failing to is no great loss, so it's done quietly.
+ */
+static void WriteConfigCache(CommandLineProcessor clp, uint64_t fileHash, uint64_t fileSize)
+{
+    size_t numChars = 0;
+    for (size_t i = 0; i < clp->numConfigEntries; ++i)
+    {
+        numChars += STRLEN(clp->configEntries[i].name) + 1;
+        numChars += STRLEN(clp->configEntries[i].value) + 1;
+    }
+
+    size_t const entryBytes = clp->numConfigEntries * sizeof(struct ConfigCacheEntry);
+    size_t const size = entryBytes + numChars * sizeof(CL_CharType);
+    char* body = malloc(size + 1);
+    struct ConfigCacheEntry* entries = (struct ConfigCacheEntry*)body;
+    CL_CharType* strings = (CL_CharType*)(body + entryBytes);
+
+    size_t next = 0;
+    for (size_t i = 0; i < clp->numConfigEntries; ++i)
+    {
+        struct ConfigEntry const* e = &clp->configEntries[i];
+        size_t const nameLength = STRLEN(e->name) + 1;
+        size_t const valueLength = STRLEN(e->value) + 1;
+        entries[i].name = (uint32_t)next;
+        memcpy(strings + next, e->name, nameLength * sizeof(CL_CharType));
+        next += nameLength;
+        entries[i].value = (uint32_t)next;
+        memcpy(strings + next, e->value, valueLength * sizeof(CL_CharType));
+        next += valueLength;
+        entries[i].line = e->line;
+    }
+
+    struct ConfigCacheHeader h;
+    memset(&h, 0, sizeof(h));
+    h.magic = k_configCacheMagic;
+    h.charSize = sizeof(CL_CharType);
+    h.fileHash = fileHash;
+    h.fileSize = fileSize;
+    h.numEntries = (uint32_t)clp->numConfigEntries;
+    h.checksum = Checksum(body, size);
+    h.size = size;
+
+    FILE* f = OpenFile(clp->configCachePath, 1);
+    if (f != NULL)
+    {
+        fwrite(&h, sizeof(h), 1, f);
+        fwrite(body, 1, size, f);
+        fclose(f);
+    }
+    free(body);
+}
+
+/**
+ * Split the text of a config file into settings, in place.
+ */
+static int ParseConfigText(CommandLineProcessor clp, CL_CharType* text)
+{
+    int numErrors = 0;
+    size_t capacity = 0;
+    unsigned int line = 0;
+    CL_CharType* next = text;
+    while (*next != '\0')
+    {
+        ++line;
+        CL_CharType* p = next;
+        CL_CharType* end = p;
+        while ((*end != '\0') && (*end != '\n'))
+            ++end;
+        next = (*end != '\0') ? end + 1 : end;
+        *end = '\0';
+
+        while (IsSpace(*p))
+            ++p;
+        if ((*p == '\0') || (*p == '#') || (*p == ';'))
+            continue;
+
+        CL_CharType* equals = p;
+        while ((*equals != '\0') && (*equals != '='))
+            ++equals;
+        CL_CharType* nameEnd = equals;
+        while ((nameEnd > p) && IsSpace(nameEnd[-1]))
+            --nameEnd;
+        if ((*equals != '=') || (nameEnd == p))
+        {
+            Error(STR "(%u): expected 'name = value'.", clp->configPath, line);
+            ++numErrors;
+            continue;
+        }
+        *nameEnd = '\0';
+
+        CL_CharType* value = equals + 1;
+        while (IsSpace(*value))
+            ++value;
+        if (*value == '"')
+        {
+            // unquoting only ever shortens it, as with response files
+            CL_CharType* in = ++value;
+            CL_CharType* out = value;
+            while ((*in != '\0') && (*in != '"'))
+            {
+                if ((*in == '\\') && ((in[1] == '"') || (in[1] == '\\')))
+                    ++in;
+                *out++ = *in++;
+            }
+            *out = '\0';
+        }
+        else
+        {
+            CL_CharType* valueEnd = value + STRLEN(value);
+            while ((valueEnd > value) && IsSpace(valueEnd[-1]))
+                --valueEnd;
+            *valueEnd = '\0';
+        }
+
+        if (clp->numConfigEntries == capacity)
+        {
+            capacity = (capacity > 0) ? capacity * 2 : 16;
+            clp->configEntries = realloc(clp->configEntries,
+                                         capacity * sizeof(struct ConfigEntry));
+        }
+        struct ConfigEntry* e = &clp->configEntries[clp->numConfigEntries++];
+        e->name = p;
+        e->value = value;
+        e->line = line;
+        e->used = 0;
+    }
+    return numErrors;
+}
+
+/**
+ * Read the config file, from its cache if possible. Returns the number of errors.
+ */
+static int LoadConfigFile(CommandLineProcessor clp)
+{
+    clp->configLoaded = 1;
+
+    errno = 0;
+    FILE* f = OpenFile(clp->configPath, 0);
+    if (f == NULL)
+    {
+        // a file that isn't there is fine, but one that can't be read isn't
+        if ((errno == 0) || (errno == ENOENT))
+            return 0;
+        Error("Couldn't read the settings in '" STR "'.", clp->configPath);
+        return 1;
+    }
+    size_t length;
+    char* bytes = ReadAll(f, &length);
+    fclose(f);
+
+    uint64_t const hash = FileHash(bytes, length);
+    if ((clp->configCachePath != NULL) && LoadConfigCache(clp, hash, length))
+    {
+        free(bytes);
+        return 0;
+    }
+
+    CL_CharType* text = WidenText(bytes, length);
+    clp->configText = text;
+    int const numErrors = ParseConfigText(clp, text);
+    if ((numErrors == 0) && (clp->configCachePath != NULL))
+        WriteConfigCache(clp, hash, length);
+    return numErrors;
+}
+
+/**
+ * Does \c text say \c word, in any case?
+ */
+static int IsWord(CL_StringType text, char const* word)
+{
+    while ((*word != '\0') && ((*text | 0x20) == *word))
+        ++text, ++word;
+    return (*word == '\0') && (*text == '\0');
+}
+
+/**
+ * Set an option from a config file or the environment. Counting options are set rather than
+ * counted, to a number or to true or false, and the command line counts up from there.
+ */
+static int ApplySetting(CommandLineProcessor clp, size_t option, CL_StringType value)
+{
+    struct CommandLineOption* o = &clp->options[option];
+    if (o->type != OT_COUNTER)
+        return LoadOption(clp, option, &value);
+
+    int64_t count = 0;
+    int parsed = 1;
+    if (IsWord(value, "true") || IsWord(value, "yes") || IsWord(value, "on"))
+        count = 1;
+    else if (!IsWord(value, "false") && !IsWord(value, "no") && !IsWord(value, "off"))
+        parsed = CL_ParseInt64(value, &count);
+    if ((parsed > 0) && ((count < INT_MIN) || (count > INT_MAX)))
+        parsed = -1;
+    if (parsed <= 0)
+    {
+        NumberError(parsed, o, value);
+        return 0;
+    }
+    *(int*)o->value = (int)count;
+    return 1;
+}
+
+/**
+ * The value of an option's environment variable, kept for as long as the processor, or NULL. Each
+ * different value is only kept once, so that parsing again and again doesn't keep adding copies.
+ */
+static CL_StringType GetEnvironment(CommandLineProcessor clp, CL_StringType optionName)
+{
+    CL_CharType name[256];
+    size_t n = 0;
+    for (CL_StringType p = clp->environmentPrefix; (*p != '\0') && (n + 1 < 256); ++p)
+        name[n++] = *p;
+    for (CL_StringType p = optionName; (*p != '\0') && (n + 1 < 256); ++p)
+    {
+        CL_CharType c = *p;
+        if ((c >= 'a') && (c <= 'z'))
+            c = c - 'a' + 'A';
+        else if (((c < 'A') || (c > 'Z')) && ((c < '0') || (c > '9')))
+            c = '_';
+        name[n++] = c;
+    }
+    name[n] = '\0';
+
+#if defined(_WIN32) && CL_USE_wchar_t
+    wchar_t const* value = _wgetenv(name);
+    if (value == NULL)
+        return NULL;
+    size_t const length = wcslen(value);
+    CL_CharType* copy = malloc((length + 1) * sizeof(CL_CharType));
+    memcpy(copy, value, (length + 1) * sizeof(CL_CharType));
+#else
+    char narrow[256];
+    for (size_t i = 0; i <= n; ++i)
+        narrow[i] = (char)name[i];
+    char const* value = getenv(narrow);
+    if (value == NULL)
+        return NULL;
+    // the environment can change under us, so the value is copied
+    size_t const length = strlen(value);
+    char* bytes = malloc(length + 1);
+    memcpy(bytes, value, length + 1);
+    CL_CharType* copy = WidenText(bytes, length);
+#endif
+
+    for (size_t i = 0; i < clp->numEnvironmentValues; ++i)
+    {
+        if (STRCMP(clp->environmentValues[i], copy) == 0)
+        {
+            free(copy);
+            return clp->environmentValues[i];
+        }
+    }
+
+    KeepText(clp, copy);
+    clp->environmentValues = realloc(clp->environmentValues,
+                                     (clp->numEnvironmentValues + 1) * sizeof(CL_StringType));
+    clp->environmentValues[clp->numEnvironmentValues++] = copy;
+    return copy;
+}
+
+/**
+ * Apply the config file and then the environment to the options from \c firstOption on. This
+ * happens before the command line is looked at, so that the environment overrides the file and the
+ * command line overrides both. Returns the number of errors.
+ */
+static int ApplySettings(CommandLineProcessor clp, size_t firstOption)
+{
+    int numErrors = 0;
+    for (size_t i = 0; i < clp->numConfigEntries; ++i)
+    {
+        struct ConfigEntry* e = &clp->configEntries[i];
+        long const n = LookUp(clp->options, clp->index, clp->indexSize, e->name);
+        if ((n < 0) || ((size_t)n < firstOption))
+            continue;
+        e->used = 1;
+        if (!ApplySetting(clp, (size_t)n, e->value))
+        {
+            Error(STR "(%u): bad setting for '" STR "'.", clp->configPath, e->line, e->name);
+            ++numErrors;
+        }
+    }
+
+    if (clp->environmentPrefix == NULL)
+        return numErrors;
+
+    for (size_t i = firstOption; i < clp->numOptions; ++i)
+    {
+        // an option hidden by a newer one of the same name doesn't get set
+        CL_StringType const name = clp->options[i].name;
+        if (LookUp(clp->options, clp->index, clp->indexSize, name) != (long)i)
+            continue;
+        CL_StringType const value = GetEnvironment(clp, name);
+        if ((value != NULL) && !ApplySetting(clp, i, value))
+            ++numErrors;
+    }
+    return numErrors;
+}
+
+/**
+ * Does an argument have wildcards in it?
+ */
+static int IsPattern(CL_StringType arg)
+{
+    for (; *arg != '\0'; ++arg)
+    {
+        if ((*arg == '*') || (*arg == '?') || (*arg == '['))
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * Does one part of a path match one part of a pattern? '*' matches anything, '?' any one
+ * character, and '[...]' any character in the brackets, or not in them if they start with '!' or
+ * '^'. A leading '.' has to be matched by one in the pattern, so hidden files stay hidden.
+ */
+static int MatchName(char const* pattern, char const* name)
+{
+    if ((*name == '.') && (*pattern != '.'))
+        return 0;
+
+    // on a mismatch, the last '*' takes one more character and the rest is tried again
+    char const* star = NULL;
+    char const* starName = NULL;
+    while (*name != '\0')
+    {
+        if (*pattern == '*')
+        {
+            star = ++pattern;
+            starName = name;
+            continue;
+        }
+
+        int matched = 0;
+        char const* next = pattern + 1;
+        if (*pattern == '?')
+        {
+            matched = 1;
+        }
+        else if (*pattern == '[')
+        {
+            char const* p = pattern + 1;
+            int const negated = (*p == '!') || (*p == '^');
+            p += negated;
+            // a ']' straight after the '[' is one of the characters rather than the end
+            char const* const first = p;
+            int found = 0;
+            while ((*p != '\0') && ((*p != ']') || (p == first)))
+            {
+                unsigned char const low = (unsigned char)*p;
+                unsigned char high = low;
+                if ((p[1] == '-') && (p[2] != ']') && (p[2] != '\0'))
+                {
+                    high = (unsigned char)p[2];
+                    p += 2;
+                }
+                found |= ((unsigned char)*name >= low) && ((unsigned char)*name <= high);
+                ++p;
+            }
+
+            if (*p == ']')
+            {
+                matched = (found != negated);
+                next = p + 1;
+            }
+            else
+            {
+                // an unclosed bracket is just a bracket
+                matched = (*name == '[');
+            }
+        }
+        else
+        {
+            matched = (*pattern == *name);
+        }
+
+        if (matched && (*pattern != '\0'))
+        {
+            pattern = next;
+            ++name;
+        }
+        else if (star != NULL)
+        {
+            pattern = star;
+            name = ++starName;
+        }
+        else
+        {
+            return 0;
+        }
+    }
+
+    while (*pattern == '*')
+        ++pattern;
+    return *pattern == '\0';
+}
+
+/**
+ * A directory waiting to be read, and the part of the pattern its entries are matched against.
+ */
+struct GlobDirectory
+{
+    char* path;
+    unsigned int segment;
+};
+
+/**
+ * What one thread of the walk has found, kept to itself until the walk is done: the paths, one
+ * after another with their terminators, and where each starts.
+ */
+struct GlobWorker
+{
+    struct Glob* glob;
+    char* text;
+    size_t textSize;
+    size_t textCapacity;
+    size_t* offsets;
+    size_t numMatches;
+    size_t matchCapacity;
+
+    struct GlobDirectory* found;    ///< directories to pass on to the queue in one go
+    size_t numFound;
+    size_t foundCapacity;
+
+    uint64_t buffer[4096];          ///< for reading directory entries
+};
+
+/**
+ * A pattern being expanded. Its segments are the parts between separators, and the directories
+ * to read are shared out from a stack; the walk is over when it's empty and no one is still
+ * reading a directory that could add to it.
+ */
+struct Glob
+{
+    char const** segments;
+    unsigned int numSegments;
+
+    struct GlobDirectory* stack;
+    size_t numQueued;
+    size_t queueCapacity;
+    unsigned int numBusy;
+#if CL_USE_THREADS
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+#endif
+};
+
+static int IsSeparator(char c)
+{
+#if defined(_WIN32)
+    return (c == '/') || (c == '\\');
+#else
+    return c == '/';
+#endif
+}
+
+static int IsLiteral(char const* segment)
+{
+    return strpbrk(segment, "*?[") == NULL;
+}
+
+static char* JoinPath(char const* directory, char const* name, size_t nameLength)
+{
+    size_t const length = strlen(directory);
+    int const separate = (length > 0) && !IsSeparator(directory[length - 1]);
+    char* path = malloc(length + separate + nameLength + 1);
+    memcpy(path, directory, length);
+    path[length] = '/';
+    memcpy(path + length + separate, name, nameLength);
+    path[length + separate + nameLength] = '\0';
+    return path;
+}
+
+static void AddMatch(struct GlobWorker* w, char const* path)
+{
+    size_t const length = strlen(path) + 1;
+    if (w->textSize + length > w->textCapacity)
+    {
+        w->textCapacity = (w->textSize + length) * 2;
+        w->text = realloc(w->text, w->textCapacity);
+    }
+    if (w->numMatches == w->matchCapacity)
+    {
+        w->matchCapacity = (w->matchCapacity > 0) ? w->matchCapacity * 2 : 256;
+        w->offsets = realloc(w->offsets, w->matchCapacity * sizeof(size_t));
+    }
+    memcpy(w->text + w->textSize, path, length);
+    w->offsets[w->numMatches++] = w->textSize;
+    w->textSize += length;
+}
+
+/**
+ * Hang on to a directory to read, taking ownership of \c path.
+ */
+static void AddDirectory(struct GlobWorker* w, char* path, unsigned int segment)
+{
+    if (w->numFound == w->foundCapacity)
+    {
+        w->foundCapacity = (w->foundCapacity > 0) ? w->foundCapacity * 2 : 64;
+        w->found = realloc(w->found, w->foundCapacity * sizeof(struct GlobDirectory));
+    }
+    w->found[w->numFound].path = path;
+    w->found[w->numFound].segment = segment;
+    ++w->numFound;
+}
+
+enum EntryType
+{
+    ET_UNKNOWN,
+    ET_DIRECTORY,
+    ET_LINK,
+    ET_OTHER,
+};
+
+static int IsDirectory(char const* path, int followLinks)
+{
+#if defined(_WIN32)
+    (void)followLinks;
+    DWORD const attributes = GetFileAttributesA(path);
+    return (attributes != INVALID_FILE_ATTRIBUTES) && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+    struct stat st;
+    int const failed = followLinks ? stat(path, &st) : lstat(path, &st);
+    return !failed && S_ISDIR(st.st_mode);
+#endif
+}
+
+static int Exists(char const* path)
+{
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+/**
+ * Match an entry of the directory being read. The directory is \c d, and the entry \c name.
+ */
+static void VisitEntry(struct GlobWorker* w, struct GlobDirectory const* d, char const* name,
+                       size_t nameLength, enum EntryType type)
+{
+    if ((name[0] == '.') && ((name[1] == '\0') || ((name[1] == '.') && (name[2] == '\0'))))
+        return;
+
+    struct Glob const* g = w->glob;
+    unsigned int segment = d->segment;
+    char* path = NULL;
+    int isDirectory = -1;       ///< not known yet
+
+    // "**" is any number of directories, none included, but like shells it doesn't follow links
+    if ((g->segments[segment][0] == '*') && (g->segments[segment][1] == '*') &&
+        (g->segments[segment][2] == '\0'))
+    {
+        if ((name[0] != '.') && (type != ET_LINK) && (type != ET_OTHER))
+        {
+            path = JoinPath(d->path, name, nameLength);
+            isDirectory = (type == ET_DIRECTORY) || IsDirectory(path, 0);
+            if (isDirectory)
+                AddDirectory(w, JoinPath(d->path, name, nameLength), segment);
+        }
+        if (++segment == g->numSegments)
+        {
+            // a trailing "**" matches everything under it
+            if (name[0] != '.')
+                AddMatch(w, (path != NULL) ? path : (path = JoinPath(d->path, name, nameLength)));
+            free(path);
+            return;
+        }
+    }
+
+    if (MatchName(g->segments[segment], name))
+    {
+        if (path == NULL)
+            path = JoinPath(d->path, name, nameLength);
+        if (segment + 1 == g->numSegments)
+        {
+            AddMatch(w, path);
+        }
+        else
+        {
+            // past "**" links are followed, as they are by shells
+            if ((isDirectory < 0) || (type == ET_LINK))
+                isDirectory = (type == ET_DIRECTORY) ||
+                              ((type != ET_OTHER) && IsDirectory(path, 1));
+            if (isDirectory)
+            {
+                AddDirectory(w, path, segment + 1);
+                return;
+            }
+        }
+    }
+    free(path);
+}
+
+/**
+ * Read a directory and match its entries. Literal parts of the pattern don't need the directory
+ * read, just the one name looked at, which is most of what makes the walk fast.
+ */
+static void ReadDirectory(struct GlobWorker* w, struct GlobDirectory const* d)
+{
+    struct Glob const* g = w->glob;
+    char const* segment = g->segments[d->segment];
+    if (IsLiteral(segment))
+    {
+        char* path = JoinPath(d->path, segment, strlen(segment));
+        if (d->segment + 1 == g->numSegments)
+        {
+            if (Exists(path))
+                AddMatch(w, path);
+            free(path);
+        }
+        else
+        {
+            AddDirectory(w, path, d->segment + 1);
+        }
+        return;
+    }
+
+    char const* const directory = (d->path[0] != '\0') ? d->path : ".";
+#if defined(_WIN32)
+    char* search = JoinPath(directory, "*", 1);
+    WIN32_FIND_DATAA fd;
+    HANDLE h = FindFirstFileA(search, &fd);
+    free(search);
+    if (h == INVALID_HANDLE_VALUE)
+        return;
+    do
+    {
+        enum EntryType const type =
+            (fd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) ? ET_LINK :
+            (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) ? ET_DIRECTORY : ET_OTHER;
+        VisitEntry(w, d, fd.cFileName, strlen(fd.cFileName), type);
+    } while (FindNextFileA(h, &fd));
+    FindClose(h);
+#elif defined(__linux__) && defined(SYS_getdents64)
+    // getdents64 hands over a buffer full of entries per call, where readdir copies them one by one
+    struct LinuxDirent64
+    {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[1];
+    };
+    int const fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+    long n;
+    while ((n = syscall(SYS_getdents64, fd, w->buffer, sizeof(w->buffer))) > 0)
+    {
+        for (long offset = 0; offset < n; )
+        {
+            struct LinuxDirent64 const* e =
+                (struct LinuxDirent64 const*)((char const*)w->buffer + offset);
+            enum EntryType const type = (e->d_type == DT_DIR) ? ET_DIRECTORY :
+                                        (e->d_type == DT_LNK) ? ET_LINK :
+                                        (e->d_type == DT_UNKNOWN) ? ET_UNKNOWN : ET_OTHER;
+            VisitEntry(w, d, e->d_name, strlen(e->d_name), type);
+            offset += e->d_reclen;
+        }
+    }
+    close(fd);
+#else
+    DIR* dir = opendir(directory);
+    if (dir == NULL)
+        return;
+    struct dirent* e;
+    while ((e = readdir(dir)) != NULL)
+    {
+ #if defined(DT_DIR)
+        enum EntryType const type = (e->d_type == DT_DIR) ? ET_DIRECTORY :
+                                    (e->d_type == DT_LNK) ? ET_LINK :
+                                    (e->d_type == DT_UNKNOWN) ? ET_UNKNOWN : ET_OTHER;
+ #else
+        enum EntryType const type = ET_UNKNOWN;
+ #endif
+        VisitEntry(w, d, e->d_name, strlen(e->d_name), type);
+    }
+    closedir(dir);
+#endif
+}
+
+#if CL_USE_THREADS
+ #define LockGlob(g) pthread_mutex_lock(&(g)->lock)
+ #define UnlockGlob(g) pthread_mutex_unlock(&(g)->lock)
+#else
+ #define LockGlob(g) (void)0
+ #define UnlockGlob(g) (void)0
+#endif
+
+/**
+ * Read directories until there are none left. The stack is only locked to take a directory or
+ * to hand over all that reading one turned up.
+ */
+static void* GlobWorkerMain(void* data)
+{
+    struct GlobWorker* w = data;
+    struct Glob* g = w->glob;
+
+    LockGlob(g);
+    for (;;)
+    {
+        while ((g->numQueued == 0) && (g->numBusy > 0))
+        {
+#if CL_USE_THREADS
+            pthread_cond_wait(&g->wake, &g->lock);
+#endif
+        }
+        if (g->numQueued == 0)
+            break;
+
+        struct GlobDirectory d = g->stack[--g->numQueued];
+        ++g->numBusy;
+        UnlockGlob(g);
+
+        ReadDirectory(w, &d);
+        free(d.path);
+
+        LockGlob(g);
+        --g->numBusy;
+        if (g->numQueued + w->numFound > g->queueCapacity)
+        {
+            g->queueCapacity = (g->numQueued + w->numFound) * 2;
+            g->stack = realloc(g->stack, g->queueCapacity * sizeof(struct GlobDirectory));
+        }
+        memcpy(g->stack + g->numQueued, w->found, w->numFound * sizeof(struct GlobDirectory));
+        g->numQueued += w->numFound;
+#if CL_USE_THREADS
+        // the last one out has to wake everyone so that they see it's over
+        if ((w->numFound > 1) || ((g->numQueued == 0) && (g->numBusy == 0)))
+            pthread_cond_broadcast(&g->wake);
+        else if (w->numFound == 1)
+            pthread_cond_signal(&g->wake);
+#endif
+        w->numFound = 0;
+    }
+    UnlockGlob(g);
+    return NULL;
+}
+
+static int CompareStrings(void const* a, void const* b)
+{
+    return strcmp(*(char const* const*)a, *(char const* const*)b);
+}
+
+/**
+ * Find the paths matching \c pattern. They're sorted, without duplicates, and all in one block
+ * with the array of them, which is returned for the caller to free. Returns NULL if there are no
+ * matches.
+ */
+static char** Glob(char const* pattern, size_t* numMatches)
+{
+    // split the pattern up in a copy, where the parts before the first wildcard are the start
+    size_t const length = strlen(pattern);
+    char* copy = malloc(length + 1);
+    memcpy(copy, pattern, length + 1);
+    char const** segments = malloc((length / 2 + 2) * sizeof(char const*));
+    unsigned int numSegments = 0;
+    size_t start = 0;
+    for (size_t i = 0; i <= length; ++i)
+    {
+        if ((copy[i] != '\0') && !IsSeparator(copy[i]))
+            continue;
+        copy[i] = '\0';
+        char const* segment = copy + start;
+        int const isGlobstar = (strcmp(segment, "**") == 0);
+        int const repeatsGlobstar = isGlobstar && (numSegments > 0) &&
+                                    (strcmp(segments[numSegments - 1], "**") == 0);
+        if ((segment[0] != '\0') && !repeatsGlobstar)
+            segments[numSegments++] = segment;
+        start = i + 1;
+    }
+
+    size_t root = 0;
+    while (IsSeparator(pattern[root]))
+        ++root;
+    unsigned int firstWild = 0;
+    while ((firstWild < numSegments) && IsLiteral(segments[firstWild]))
+        ++firstWild;
+
+    char* base = malloc(length + 2);
+    memcpy(base, pattern, root);
+    base[root] = '\0';
+    for (unsigned int i = 0; i < firstWild; ++i)
+    {
+        char* joined = JoinPath(base, segments[i], strlen(segments[i]));
+        free(base);
+        base = joined;
+    }
+
+    struct Glob g;
+    memset(&g, 0, sizeof(g));
+    g.segments = segments + firstWild;
+    g.numSegments = numSegments - firstWild;
+    g.queueCapacity = 64;
+    g.stack = malloc(g.queueCapacity * sizeof(struct GlobDirectory));
+    g.stack[0].path = base;
+    g.stack[0].segment = 0;
+    g.numQueued = 1;
+
+    unsigned int numWorkers = 1;
+#if CL_USE_THREADS
+    long const numCores = sysconf(_SC_NPROCESSORS_ONLN);
+    numWorkers = (numCores < 1) ? 1 : (numCores > 8) ? 8 : (unsigned int)numCores;
+    pthread_mutex_init(&g.lock, NULL);
+    pthread_cond_init(&g.wake, NULL);
+#endif
+
+    struct GlobWorker* workers = calloc(numWorkers, sizeof(struct GlobWorker));
+    for (unsigned int i = 0; i < numWorkers; ++i)
+        workers[i].glob = &g;
+
+    if (g.numSegments == 0)
+    {
+        // nothing to walk after all; it could be an unclosed bracket
+        if (Exists(base))
+            AddMatch(&workers[0], base);
+        free(base);
+        g.numQueued = 0;
+    }
+#if CL_USE_THREADS
+    // most patterns only need a directory or two, which isn't worth starting threads for
+    if (g.numQueued > 0)
+    {
+        struct GlobDirectory d = g.stack[--g.numQueued];
+        ReadDirectory(&workers[0], &d);
+        free(d.path);
+        if (workers[0].numFound > g.queueCapacity)
+        {
+            g.queueCapacity = workers[0].numFound;
+            g.stack = realloc(g.stack, g.queueCapacity * sizeof(struct GlobDirectory));
+        }
+        if (workers[0].numFound > 0)
+            memcpy(g.stack, workers[0].found, workers[0].numFound * sizeof(struct GlobDirectory));
+        g.numQueued = workers[0].numFound;
+        workers[0].numFound = 0;
+    }
+    if (g.numQueued <= 1)
+        numWorkers = 1;
+
+    pthread_t* threads = malloc(numWorkers * sizeof(pthread_t));
+    unsigned int numThreads = 0;
+    while ((numThreads + 1 < numWorkers) &&
+           (pthread_create(&threads[numThreads], NULL, GlobWorkerMain, &workers[numThreads + 1])
+            == 0))
+    {
+        ++numThreads;
+    }
+    GlobWorkerMain(&workers[0]);
+    for (unsigned int i = 0; i < numThreads; ++i)
+        pthread_join(threads[i], NULL);
+    free(threads);
+    pthread_cond_destroy(&g.wake);
+    pthread_mutex_destroy(&g.lock);
+#else
+    GlobWorkerMain(&workers[0]);
+#endif
+
+    // gather everything into one block: the array of matches, and then their text
+    size_t count = 0;
+    size_t textSize = 0;
+    for (unsigned int i = 0; i < numWorkers; ++i)
+    {
+        count += workers[i].numMatches;
+        textSize += workers[i].textSize;
+    }
+
+    char** matches = NULL;
+    if (count > 0)
+    {
+        matches = malloc(count * sizeof(char*) + textSize);
+        char* text = (char*)(matches + count);
+        size_t n = 0;
+        for (unsigned int i = 0; i < numWorkers; ++i)
+        {
+            struct GlobWorker* w = &workers[i];
+            memcpy(text, w->text, w->textSize);
+            for (size_t m = 0; m < w->numMatches; ++m)
+                matches[n++] = text + w->offsets[m];
+            text += w->textSize;
+        }
+
+        qsort(matches, count, sizeof(char*), CompareStrings);
+        n = 1;
+        for (size_t m = 1; m < count; ++m)
+        {
+            if (strcmp(matches[m], matches[n - 1]) != 0)
+                matches[n++] = matches[m];
+        }
+        count = n;
+    }
+
+    for (unsigned int i = 0; i < numWorkers; ++i)
+    {
+        free(workers[i].text);
+        free(workers[i].offsets);
+        free(workers[i].found);
+    }
+    free(workers);
+    free(g.stack);
+    free(segments);
+    free(copy);
+
+    *numMatches = count;
+    return matches;
+}
+
+/**
+ * Replace an overflow argument that has wildcards with the paths it matches, in order. The
+ * separators in a pattern are '/' (and '\\' under Windows), "**" matches any number of
+ * directories, and the directories are read on several threads, so that patterns over big trees
+ * are quick. As in shells, a pattern that matches nothing is left as it is. The paths are kept
+ * in one block until CL_Destroy(). Returns the new number of overflow arguments.
+ */
+static size_t ExpandPattern(CommandLineProcessor clp, CL_StringType arg, size_t numOverflow)
+{
+#if CL_USE_wchar_t
+    // the walk is done in multibyte paths
+    char pattern[4096];
+    size_t const n = wcstombs(pattern, arg, sizeof(pattern));
+    if ((n == (size_t)-1) || (n >= sizeof(pattern)))
+        pattern[0] = '\0';
+#else
+    char const* pattern = arg;
+#endif
+
+    size_t numMatches = 0;
+    char** matches = (pattern[0] != '\0') ? Glob(pattern, &numMatches) : NULL;
+    if (matches == NULL)
+    {
+        if (clp->overflowFn != NULL)
+        {
+            clp->overflowFn(arg, clp->overflowData);
+        }
+        else
+        {
+            Reserve(clp, 0, 0, numOverflow + 2, 0, 0, 0);
+            clp->overflow[numOverflow++] = arg;
+        }
+        return numOverflow;
+    }
+
+#if CL_USE_wchar_t
+    // converted into a block laid out the same way
+    size_t numChars = 0;
+    for (size_t i = 0; i < numMatches; ++i)
+        numChars += strlen(matches[i]) + 1;
+    CL_StringType* paths = malloc(numMatches * sizeof(CL_StringType) +
+                                  numChars * sizeof(CL_CharType));
+    CL_CharType* next = (CL_CharType*)(paths + numMatches);
+    for (size_t i = 0; i < numMatches; ++i)
+    {
+        if (mbstowcs(next, matches[i], strlen(matches[i]) + 1) == (size_t)-1)
+            *next = L'\0';
+        paths[i] = next;
+        next += STRLEN(next) + 1;
+    }
+    free(matches);
+#else
+    CL_StringType* paths = (CL_StringType*)matches;
+#endif
+    KeepText(clp, (CL_CharType*)paths);
+
+    if (clp->overflowFn == NULL)
+    {
+        Reserve(clp, 0, 0, numOverflow + numMatches + 1, 0, 0, 0);
+        memcpy(clp->overflow + numOverflow, paths, numMatches * sizeof(CL_StringType));
+        return numOverflow + numMatches;
+    }
+    for (size_t i = 0; i < numMatches; ++i)
+        clp->overflowFn(paths[i], clp->overflowData);
+    return numOverflow;
+}
+
+/**
+ * Move the list values collected by the parse into the lists. The values are counted first so
+ * that every list can be given its exact size in one allocation, and then they're copied in.
+ */
+static void BuildLists(CommandLineProcessor clp)
+{
+    // this goes through all of the options, so don't bother if none of them are lists
+    if (clp->numListOptions == 0)
+        return;
+
+    free(clp->lists);
+    clp->lists = NULL;
+
+    for (size_t i = 0; i < clp->numOptions; ++i)
+    {
+        if (s_optionTypeData[clp->options[i].type].listElementSize != 0)
+            *clp->options[i].count = 0;
+    }
+    for (size_t i = 0; i < clp->numListValues; ++i)
+        ++*clp->options[clp->listValues[i].option].count;
+
+    // each list starts on an eight byte boundary, which suits all of the element types
+    size_t total = 0;
+    for (size_t i = 0; i < clp->numOptions; ++i)
+    {
+        struct CommandLineOption const* o = &clp->options[i];
+        if (s_optionTypeData[o->type].listElementSize != 0)
+            total += (*o->count * s_optionTypeData[o->type].listElementSize + 7) & ~(size_t)7;
+    }
+    if (total > 0)
+        clp->lists = malloc(total);
+
+    char* next = clp->lists;
+    for (size_t i = 0; i < clp->numOptions; ++i)
+    {
+        struct CommandLineOption const* o = &clp->options[i];
+        if (s_optionTypeData[o->type].listElementSize == 0)
+            continue;
+        size_t const size = *o->count * s_optionTypeData[o->type].listElementSize;
+        *(void const**)o->value = (size > 0) ? next : NULL;
+        next += (size + 7) & ~(size_t)7;
+        *o->count = 0;
+    }
+
+    for (size_t i = 0; i < clp->numListValues; ++i)
+    {
+        struct ListValue const* lv = &clp->listValues[i];
+        struct CommandLineOption const* o = &clp->options[lv->option];
+        size_t const elementSize = s_optionTypeData[o->type].listElementSize;
+        char* list = *(char**)o->value;
+        memcpy(list + elementSize * (*o->count)++, &lv->value, elementSize);
+    }
+    clp->numListValues = 0;
+}
+
+/**
+ * The loop that every parse shares, whatever its options are kept in: each option is found and
+ * loaded with its parameters, a parameter that doesn't load gets another chance as an argument,
+ * and everything else is an argument. Returns the number of errors.
+ */
+static int ParseArguments(CL_Handler const* handler, void* data, CommandLineProcessor clp,
+                          struct ArgumentSource* src)
+{
+    int numErrors = 0;
+    CL_StringType arg;
+    while ((arg = NextArgument(clp, src, 0, &numErrors)) != NULL)
+    {
+        if ((arg[0] == '-') || (arg[0] == '/'))
+        {
+            size_t option;
+            int const numParameters = handler->findOption(arg, &option, data);
+            if (numParameters < 0)
+            {
+                ++numErrors;
+                continue;
+            }
+
+            CL_StringType params[1];
+            int numParams = 0;
+            while (numParams < numParameters)
+            {
+                CL_StringType param = NextArgument(clp, src, 1, &numErrors);
+                if (param == NULL)
+                    break;
+                params[numParams++] = param;
+            }
+
+            if (numParams < numParameters)
+            {
+                CL_Report(CL_MISSING_PARAMETER, arg, NULL);
+                ++numErrors;
+            }
+            else if (!handler->loadOption(option, params, data))
+            {
+                ++numErrors;
+                if (numParams > 0)
+                    src->pushedBack = params[0];
+            }
+        }
+        else
+        {
+            int const taken = handler->takeArgument(arg, data);
+            if (taken == 0)
+                CL_Report(CL_UNHANDLED_ARGUMENT, arg, NULL);
+            if (taken <= 0)
+                ++numErrors;
+            if (taken < 0)
+                break;
+        }
+    }
+    return numErrors;
+}
+
+/**
+ * Parse a command line with a front end's own table of options, just as CL_Parse() would with a
+ * processor's that doesn't have response files enabled.
+ */
+int CL_ParseWith(CL_Handler const* handler, void* data, int argc, CL_StringType* argv)
+{
+    struct ArgumentSource src = { argc, argv, 1, NULL, NULL };
+    return ParseArguments(handler, data, NULL, &src);
+}
+
+/**
+ * How far CL_Parse() has got in putting arguments where they go.
+ */
+struct ProcessorParse
+{
+    CommandLineProcessor clp;
+    size_t nextArgument;
+    size_t numOverflow;
+    int numErrors;              ///< in the settings for the subcommand
+};
+
+static int FindProcessorOption(CL_StringType arg, size_t* option, void* data)
+{
+    CommandLineProcessor clp = ((struct ProcessorParse*)data)->clp;
+    long const n = FindOption(clp->options, clp->index, clp->indexSize,
+                              clp->index + clp->indexSize, clp->numSorted, arg);
+    if (n < 0)
+        return -1;
+    *option = (size_t)n;
+    return s_optionTypeData[clp->options[n].type].numParameters;
+}
+
+static int LoadProcessorOption(size_t option, CL_StringType const* params, void* data)
+{
+    return LoadOption(((struct ProcessorParse*)data)->clp, option, params);
+}
+
+static int TakeProcessorArgument(CL_StringType arg, void* data)
+{
+    struct ProcessorParse* pp = data;
+    CommandLineProcessor clp = pp->clp;
+    if ((clp->numSubcommands > 0) && (clp->subcommand == NULL))
+    {
+        // anything after an unknown command would only make more errors
+        size_t const numGlobalOptions = clp->numOptions;
+        if (!ChooseSubcommand(clp, arg))
+            return -1;
+        pp->numErrors += ApplySettings(clp, numGlobalOptions);
+    }
+    else if (pp->nextArgument < clp->numArguments)
+    {
+        *(clp->arguments[pp->nextArgument++]) = arg;
+    }
+    else if (clp->globExpansion && ((clp->overflowFn != NULL) || (clp->overflow != NULL)) &&
+             IsPattern(arg))
+    {
+        pp->numOverflow = ExpandPattern(clp, arg, pp->numOverflow);
+    }
+    else if (clp->overflowFn != NULL)
+    {
+        clp->overflowFn(arg, clp->overflowData);
+    }
+    else if (clp->overflow != NULL)
+    {
+        // response files can make for more than there were on the command line
+        Reserve(clp, 0, 0, pp->numOverflow + 2, 0, 0, 0);
+        clp->overflow[pp->numOverflow++] = arg;
+    }
+    else
+    {
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Do the parse.
+ */
+int CL_Parse(CommandLineProcessor clp, int argc, CL_StringType* argv)
+{
+    static CL_Handler const k_handler =
+    {
+        FindProcessorOption, LoadProcessorOption, TakeProcessorArgument
+    };
+
+    clp->appName = argv[0];
+    int numErrors = 0;
+
+    // the last parse's subcommand may not be this one's, so its options and arguments go
+    if (clp->subcommand != NULL)
+    {
+        clp->numOptions = clp->numGlobalOptions;
+        clp->numArguments = clp->numGlobalArguments;
+        clp->numListOptions = clp->numGlobalListOptions;
+        clp->numParsers = clp->numGlobalParsers;
+        clp->indexSize = 0;
+        clp->subcommand = NULL;
+    }
+
+    if (clp->indexSize == 0)
+        BuildIndex(clp);
+
+    if (clp->overflow != NULL)
+        Reserve(clp, 0, 0, (size_t)argc, 0, 0, 0);
+
+    if ((clp->configPath != NULL) && !clp->configLoaded)
+        numErrors += LoadConfigFile(clp);
+    for (size_t i = 0; i < clp->numConfigEntries; ++i)
+        clp->configEntries[i].used = 0;
+    numErrors += ApplySettings(clp, 0);
+
+    struct ArgumentSource src = { argc, argv, 1, NULL, NULL };
+    struct ProcessorParse pp = { clp, 0, 0, 0 };
+    numErrors += ParseArguments(&k_handler, &pp, clp, &src);
+    numErrors += pp.numErrors;
+    size_t const numOverflow = pp.numOverflow;
+
+    if (clp->overflow != NULL)
+    {
+        clp->overflow[numOverflow] = NULL;
+    }
+
+    // settings for another subcommand's options can't be told from mistakes
+    for (size_t i = 0; (i < clp->numConfigEntries) && (clp->numSubcommands == 0); ++i)
+    {
+        struct ConfigEntry const* e = &clp->configEntries[i];
+        if (!e->used)
+        {
+            Error(STR "(%u): unknown option '" STR "'.", clp->configPath, e->line, e->name);
+            ++numErrors;
+        }
+    }
+
+    BuildLists(clp);
+
+    return numErrors == 0;
+}
+
+/**
+ * An immutable copy of a CommandLineProcessor's options and arguments, with the variables they're
+ * bound to turned into offsets into a struct. Everything is in the one allocation with the struct
+ * itself, after the struct's initial values, the options, their offsets, the argument offsets,
+ * the index, and copies of any custom options' parsers.
+ */
+struct CL_Spec_
+{
+    size_t size;                ///< of the struct the options are bound into
+    unsigned char const* initial;
+
+    struct CommandLineOption const* options;
+    size_t const* optionOffsets;
+    size_t numOptions;
+
+    size_t const* argumentOffsets;
+    size_t numArguments;
+
+    unsigned int const* index;  ///< followed by the sorted option numbers, as in the processor
+    size_t indexSize;
+    size_t numSorted;
+
+    int overflowEnabled;
+    CL_OverflowFn overflowFn;
+    void* overflowData;
+};
+
+/**
+ * Where \c value, of \c size bytes, is in the struct at \c base, or -1 if it isn't all inside.
+ */
+static long OffsetInStruct(void const* value, size_t size, void const* base, size_t structSize)
+{
+    char const* const p = value;
+    char const* const b = base;
+    if ((p < b) || (p + size > b + structSize))
+        return -1;
+    return (long)(p - b);
+}
+
+/**
+ * Freeze the options and arguments of \c clp, all of which have to be bound to members of the
+ * struct at \c base, into a spec that can be parsed into any number of structs like it at once.
+ * The struct's current contents become the values each parse starts from. The processor can be
+ * destroyed afterwards, but the option names need to last as long as the spec.
+ *
+ * List options and response files need storage that lasts beyond the parse, and subcommands add
+ * options as they go, so they can't be part of a spec. Returns NULL, after logging why, if the
+ * processor has anything that can't be.
+ */
+CL_Spec CL_CreateSpec(CommandLineProcessor clp, void const* base, size_t size)
+{
+    static size_t const k_valueSizes[OT_NUM_TYPES] =
+    {
+        sizeof(int), sizeof(int), sizeof(float), sizeof(CL_StringType), sizeof(int64_t),
+        sizeof(double),
+    };
+
+    int numErrors = 0;
+    if (clp->responseFilesEnabled)
+    {
+        Error("Response files can't be used with a spec.");
+        ++numErrors;
+    }
+    if (clp->globExpansion)
+    {
+        Error("Glob expansion can't be used with a spec.");
+        ++numErrors;
+    }
+    if (clp->numSubcommands > 0)
+    {
+        Error("Subcommands can't be used with a spec.");
+        ++numErrors;
+    }
+    if ((clp->configPath != NULL) || (clp->environmentPrefix != NULL))
+    {
+        Error("Config files and the environment can't be used with a spec.");
+        ++numErrors;
+    }
+    for (size_t i = 0; i < clp->numOptions; ++i)
+    {
+        struct CommandLineOption const* o = &clp->options[i];
+        if (s_optionTypeData[o->type].listElementSize != 0)
+        {
+            Error("List option '" STR "' can't be part of a spec.", o->name);
+            ++numErrors;
+        }
+        // only a custom option's parser knows how big its value is, so just its start is checked
+        else if (OffsetInStruct(o->value, (o->type == OT_CUSTOM) ? 1 : k_valueSizes[o->type],
+                                base, size) < 0)
+        {
+            Error("Option '" STR "' isn't bound to a member of the struct.", o->name);
+            ++numErrors;
+        }
+    }
+    for (size_t i = 0; i < clp->numArguments; ++i)
+    {
+        if (OffsetInStruct(clp->arguments[i], sizeof(CL_StringType), base, size) < 0)
+        {
+            Error("Argument %d isn't bound to a member of the struct.", (int)i + 1);
+            ++numErrors;
+        }
+    }
+    if (numErrors > 0)
+        return NULL;
+
+    if (clp->indexSize == 0)
+        BuildIndex(clp);
+
+    size_t const headerBytes = (sizeof(struct CL_Spec_) + 7) & ~(size_t)7;
+    size_t const initialBytes = (size + 7) & ~(size_t)7;
+    size_t const optionBytes = clp->numOptions * sizeof(struct CommandLineOption);
+    size_t const offsetBytes = (clp->numOptions + clp->numArguments) * sizeof(size_t);
+    size_t const indexBytes = (clp->indexSize + clp->numSorted) * sizeof(unsigned int);
+    size_t numParsers = 0;
+    for (size_t i = 0; i < clp->numOptions; ++i)
+        numParsers += (clp->options[i].type == OT_CUSTOM);
+    size_t const parserOffset = (headerBytes + initialBytes + optionBytes + offsetBytes +
+                                 indexBytes + 7) & ~(size_t)7;
+    char* block = malloc(parserOffset + numParsers * sizeof(struct CustomParser));
+
+    struct CL_Spec_* spec = (struct CL_Spec_*)block;
+    unsigned char* initial = (unsigned char*)(block + headerBytes);
+    struct CommandLineOption* options = (struct CommandLineOption*)(block + headerBytes +
+                                                                    initialBytes);
+    size_t* offsets = (size_t*)((char*)options + optionBytes);
+    unsigned int* index = (unsigned int*)((char*)offsets + offsetBytes);
+
+    memcpy(initial, base, size);
+    if (optionBytes > 0)
+        memcpy(options, clp->options, optionBytes);
+    for (size_t i = 0; i < clp->numOptions; ++i)
+        offsets[i] = (size_t)OffsetInStruct(options[i].value, 0, base, size);
+    for (size_t i = 0; i < clp->numArguments; ++i)
+    {
+        offsets[clp->numOptions + i] =
+            (size_t)OffsetInStruct(clp->arguments[i], 0, base, size);
+    }
+    memcpy(index, clp->index, indexBytes);
+
+    // the spec outlives the processor, so it gets its own copies of the parsers
+    struct CustomParser* parsers = (struct CustomParser*)(block + parserOffset);
+    for (size_t i = 0; i < clp->numOptions; ++i)
+    {
+        if (options[i].type == OT_CUSTOM)
+        {
+            *parsers = *options[i].parser;
+            options[i].parser = parsers++;
+        }
+    }
+
+    spec->size = size;
+    spec->initial = initial;
+    spec->options = options;
+    spec->optionOffsets = offsets;
+    spec->numOptions = clp->numOptions;
+    spec->argumentOffsets = offsets + clp->numOptions;
+    spec->numArguments = clp->numArguments;
+    spec->index = index;
+    spec->indexSize = clp->indexSize;
+    spec->numSorted = clp->numSorted;
+    spec->overflowEnabled = (clp->overflow != NULL);
+    spec->overflowFn = clp->overflowFn;
+    spec->overflowData = clp->overflowData;
+    return spec;
+}
+
+/**
+ * Destroy a spec.
+ */
+void CL_DestroySpec(CL_Spec spec)
+{
+    free((void*)spec);
+}
+
+/**
+ * How far CL_ParseInto() has got in putting arguments where they go.
+ */
+struct SpecParse
+{
+    CL_Spec spec;
+    char* base;
+    CL_ParseResult* result;
+    size_t nextArgument;
+};
+
+static int FindSpecOption(CL_StringType arg, size_t* option, void* data)
+{
+    CL_Spec spec = ((struct SpecParse*)data)->spec;
+    long const n = FindOption(spec->options, spec->index, spec->indexSize,
+                              spec->index + spec->indexSize, spec->numSorted, arg);
+    if (n < 0)
+        return -1;
+    *option = (size_t)n;
+    return s_optionTypeData[spec->options[n].type].numParameters;
+}
+
+static int LoadSpecOption(size_t option, CL_StringType const* params, void* data)
+{
+    struct SpecParse const* sp = data;
+    struct CommandLineOption* o = (struct CommandLineOption*)&sp->spec->options[option];
+    struct OptionTypeData const* otd = &s_optionTypeData[o->type];
+    return otd->loadParameters(o, params, sp->base + sp->spec->optionOffsets[option]) ==
+           otd->numParameters;
+}
+
+static int TakeSpecArgument(CL_StringType arg, void* data)
+{
+    struct SpecParse* sp = data;
+    CL_Spec spec = sp->spec;
+    if (sp->nextArgument < spec->numArguments)
+    {
+        *(CL_StringType*)(sp->base + spec->argumentOffsets[sp->nextArgument++]) = arg;
+    }
+    else if (spec->overflowFn != NULL)
+    {
+        spec->overflowFn(arg, spec->overflowData);
+    }
+    else if (spec->overflowEnabled)
+    {
+        // this never writes past the argument that's being read
+        sp->result->overflow[sp->result->numOverflow++] = arg;
+    }
+    else
+    {
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Parse a command line into \c out, a struct like the one the spec was made from, which is first
+ * reset to the values that one had. The spec isn't changed and nothing is allocated, so any number
+ * of threads can do this with the same spec at once. Overflow arguments, if they're enabled and
+ * not streamed, are moved to the front of argv just after the application name, and \c result
+ * says where they are. Returns nonzero if the parse succeeded.
+ */
+int CL_ParseInto(CL_Spec spec, void* out, int argc, CL_StringType* argv, CL_ParseResult* result)
+{
+    static CL_Handler const k_handler = { FindSpecOption, LoadSpecOption, TakeSpecArgument };
+
+    struct SpecParse sp = { spec, out, result, 0 };
+    memcpy(sp.base, spec->initial, spec->size);
+
+    result->appName = (argc > 0) ? argv[0] : NULL;
+    result->overflow = argv + 1;
+    result->numOverflow = 0;
+    result->numErrors = CL_ParseWith(&k_handler, &sp, argc, argv);
+    return result->numErrors == 0;
+}
+
+/**
+ * Load parameters into the OT_COUNTER command line option.
+ */
+int LoadCountingParameters(struct CommandLineOption* o, CL_StringType const* params, void* value)
+{
+    (void)o;
+    (void)params;
+    *(int*)value += 1;
+    return 0;
+}
+
+/**
+ * The value of a suffix multiplying a number, or zero if \c c isn't one. These are the binary
+ * multiples since they're mostly used for sizes.
+ */
+static int64_t SuffixMultiplier(CL_CharType c)
+{
+    switch (c)
+    {
+    case 'k': case 'K': return (int64_t)1 << 10;
+    case 'm': case 'M': return (int64_t)1 << 20;
+    case 'g': case 'G': return (int64_t)1 << 30;
+    default: return 0;
+    }
+}
+
+static int DigitValue(CL_CharType c)
+{
+    if ((c >= '0') && (c <= '9'))
+        return c - '0';
+    if ((c >= 'a') && (c <= 'z'))
+        return c - 'a' + 10;
+    if ((c >= 'A') && (c <= 'Z'))
+        return c - 'A' + 10;
+    return 99;
+}
+
+/**
+ * Parse an integer: an optional sign, then decimal digits, or hexadecimal after "0x", binary after
+ * "0b", or octal after "0o", then optionally a k, M or G suffix. Leading zeros are just zeros, so
+ * "010" is ten. Returns 1 if \c text is such a number and it fits, -1 if it doesn't fit, and 0 if
+ * it isn't a number at all.
+ */
+int CL_ParseInt64(CL_StringType text, int64_t* value)
+{
+    CL_StringType p = text;
+    int negative = 0;
+    if ((*p == '-') || (*p == '+'))
+        negative = (*p++ == '-');
+
+    unsigned int base = 10;
+    if (p[0] == '0')
+    {
+        CL_CharType const b = p[1];
+        if ((b == 'x') || (b == 'X'))
+            base = 16, p += 2;
+        else if ((b == 'b') || (b == 'B'))
+            base = 2, p += 2;
+        else if ((b == 'o') || (b == 'O'))
+            base = 8, p += 2;
+    }
+
+    // accumulate the magnitude unsigned so that INT64_MIN is reachable
+    uint64_t const limit = negative ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX;
+    uint64_t magnitude = 0;
+    int outOfRange = 0;
+    CL_StringType const digits = p;
+    int d;
+    while ((d = DigitValue(*p)) < (int)base)
+    {
+        if (magnitude > (limit - d) / base)
+            outOfRange = 1;
+        else
+            magnitude = magnitude * base + d;
+        ++p;
+    }
+    if (p == digits)
+        return 0;
+
+    int64_t const multiplier = SuffixMultiplier(*p);
+    if (multiplier != 0)
+    {
+        if (magnitude > limit / (uint64_t)multiplier)
+            outOfRange = 1;
+        magnitude *= (uint64_t)multiplier;
+        ++p;
+    }
+
+    if (*p != '\0')
+        return 0;
+    if (outOfRange)
+        return -1;
+
+    *value = negative ? (int64_t)(0 - magnitude) : (int64_t)magnitude;
+    return 1;
+}
+
+/**
+ * Parse a floating point number: an optional sign, digits with an optional decimal point, an
+ * optional exponent, and then optionally a k, M or G suffix; or "inf", "infinity" or "nan". The
+ * result is correctly rounded. Returns 1 if \c text is a finite number (or an explicit infinity or
+ * NaN), -1 if it overflows or underflows, and 0 if it isn't a number.
+ *
+ * When every significant digit fits in a mantissa of at most 2^53 (so any number of up to 15
+ * significant digits, and some of 16 or 17) and the power of ten is at most 22 either way, both
+ * are exact doubles and one multiplication or division rounds correctly (Clinger's fast path).
+ * The rest are checked here and then handed to strtod, which is slower but gets them right too.
+ */
+int CL_ParseDouble(CL_StringType text, double* value)
+{
+    static double const k_powersOf10[] =
+    {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+
+    CL_StringType p = text;
+    int negative = 0;
+    if ((*p == '-') || (*p == '+'))
+        negative = (*p++ == '-');
+
+    // infinities and NaNs, any case
+    static char const* const k_special[] = { "infinity", "inf", "nan" };
+    for (int i = 0; i < 3; ++i)
+    {
+        char const* w = k_special[i];
+        CL_StringType q = p;
+        while ((*w != '\0') && ((*q | 0x20) == *w))
+            ++q, ++w;
+        if ((*w == '\0') && (*q == '\0'))
+        {
+            double const special = (i < 2) ? HUGE_VAL : NAN;
+            *value = negative ? -special : special;
+            return 1;
+        }
+    }
+
+    uint64_t mantissa = 0;
+    int numDigits = 0;          // significant ones, not counting leading zeros
+    int exact = 1;              // whether every significant digit made it into the mantissa
+    long exponent = 0;
+    int sawDigit = 0;
+
+    for (int afterPoint = 0; ; ++p)
+    {
+        if ((*p >= '0') && (*p <= '9'))
+        {
+            sawDigit = 1;
+            if ((mantissa == 0) && (*p == '0'))
+            {
+                if (afterPoint)
+                    --exponent;
+            }
+            else if (numDigits < 19)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                ++numDigits;
+                if (afterPoint)
+                    --exponent;
+            }
+            else
+            {
+                if (*p != '0')
+                    exact = 0;
+                if (!afterPoint)
+                    ++exponent;
+            }
+        }
+        else if ((*p == '.') && !afterPoint)
+        {
+            afterPoint = 1;
+        }
+        else
+        {
+            break;
+        }
+    }
+    if (!sawDigit)
+        return 0;
+
+    if ((*p == 'e') || (*p == 'E'))
+    {
+        ++p;
+        int negativeExponent = 0;
+        if ((*p == '-') || (*p == '+'))
+            negativeExponent = (*p++ == '-');
+        if ((*p < '0') || (*p > '9'))
+            return 0;
+        long e = 0;
+        for (; (*p >= '0') && (*p <= '9'); ++p)
+        {
+            if (e < 100000)
+                e = e * 10 + (*p - '0');
+        }
+        exponent += negativeExponent ? -e : e;
+    }
+
+    CL_StringType const end = p;
+    int64_t const multiplier = SuffixMultiplier(*p);
+    if (multiplier != 0)
+        ++p;
     if (*p != '\0')
-        Error("'" STR "' is not a valid parameter to '-" STR "'.", params[0], o->name);
+        return 0;
+
+    // a big exponent on a short mantissa can move some of its zeros into the mantissa, as long as
+    // that stays exact: 1.5e25 is 15000 * 1e22
+    uint64_t const k_maxExact = (uint64_t)1 << 53;
+    if (exact && (exponent > 22) && (exponent <= 22 + 15))
+    {
+        uint64_t const scale = (uint64_t)k_powersOf10[exponent - 22];
+        if (mantissa <= k_maxExact / scale)
+        {
+            mantissa *= scale;
+            exponent = 22;
+        }
+    }
+
+    double result;
+    if (exact && (mantissa <= k_maxExact) && (exponent >= -22) && (exponent <= 22))
+    {
+        result = (double)mantissa;
+        if (exponent < 0)
+            result /= k_powersOf10[-exponent];
+        else
+            result *= k_powersOf10[exponent];
+        if (negative)
+            result = -result;
+    }
+    else
+    {
+        // the text has been checked already, so (in the C locale) strtod sees nothing it could
+        // take differently
+        char buffer[256];
+        size_t const length = (size_t)(end - text);
+        char* narrow = (length < sizeof(buffer)) ? buffer : malloc(length + 1);
+        for (size_t i = 0; i < length; ++i)
+            narrow[i] = (char)text[i];
+        narrow[length] = '\0';
+        result = strtod(narrow, NULL);
+        if (narrow != buffer)
+            free(narrow);
+    }
+
+    // multiplying by a power of two is exact unless it overflows
+    if (multiplier != 0)
+        result *= (double)multiplier;
+
+    if ((result == HUGE_VAL) || (result == -HUGE_VAL) || ((result == 0.0) && (mantissa != 0)))
+        return -1;
+
+    *value = result;
+    return 1;
+}
+
+/**
+ * Report a number, or a custom option's value, that couldn't be parsed for an option.
+ */
+static void NumberError(int parsed, struct CommandLineOption const* o, CL_StringType param)
+{
+    CL_Report((parsed < 0) ? CL_PARAMETER_OUT_OF_RANGE : CL_INVALID_PARAMETER, param, o->name);
+}
+
+/**
+ * Load parameters into the OT_INTEGER command line option.
+ */
+int LoadIntegerParameters(struct CommandLineOption* o, CL_StringType const* params, void* value)
+{
+    int64_t v;
+    int parsed = CL_ParseInt64(params[0], &v);
+    if ((parsed > 0) && ((v < INT_MIN) || (v > INT_MAX)))
+        parsed = -1;
+    if (parsed <= 0)
+    {
+        NumberError(parsed, o, params[0]);
+        return 0;
+    }
+
+    *(int*)value = (int)v;
+    return 1;
+}
+
+/**
+ * Load parameters into the OT_FLOAT command line option.
+ */
+int LoadFloatParameters(struct CommandLineOption* o, CL_StringType const* params, void* value)
+{
+    double v;
+    int parsed = CL_ParseDouble(params[0], &v);
+    if ((parsed > 0) &&
+        (((v > FLT_MAX) && (v != HUGE_VAL)) || ((v < -FLT_MAX) && (v != -HUGE_VAL))))
+    {
+        parsed = -1;
+    }
+    if (parsed <= 0)
+    {
+        NumberError(parsed, o, params[0]);
+        return 0;
+    }
 
-    *v *= negator;
-    return (*p == '\0') ? 1 : 0;
+    *(float*)value = (float)v;
+    return 1;
+}
+
+/**
+ * Load parameters into the OT_INT64 command line option.
+ */
+int LoadInt64Parameters(struct CommandLineOption* o, CL_StringType const* params, void* value)
+{
+    int const parsed = CL_ParseInt64(params[0], (int64_t*)value);
+    if (parsed <= 0)
+        NumberError(parsed, o, params[0]);
+    return (parsed > 0) ? 1 : 0;
+}
+
+/**
+ * Load parameters into the OT_DOUBLE command line option.
+ */
+int LoadDoubleParameters(struct CommandLineOption* o, CL_StringType const* params, void* value)
+{
+    int const parsed = CL_ParseDouble(params[0], (double*)value);
+    if (parsed <= 0)
+        NumberError(parsed, o, params[0]);
+    return (parsed > 0) ? 1 : 0;
+}
+
+/**
+ * Load parameters into the OT_CUSTOM command line option.
+ */
+int LoadCustomParameters(struct CommandLineOption* o, CL_StringType const* params, void* value)
+{
+    int const parsed = o->parser->parse(params[0], value, o->parser->data);
+    if (parsed <= 0)
+        NumberError(parsed, o, params[0]);
+    return (parsed > 0) ? 1 : 0;
 }
 
 /**
  * Load parameters into the OT_STRING command line option.
  */
-int LoadStringParameters(struct CommandLineOption* o, CL_StringType* params)
+int LoadStringParameters(struct CommandLineOption* o, CL_StringType const* params, void* value)
 {
-    CL_StringType* v = o->value;
+    (void)o;
+    CL_StringType* v = value;
     CL_StringType p = params[0];
     *v = p;
     return 1;
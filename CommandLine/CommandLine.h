@@ -17,6 +17,9 @@
  *              configured to collect the overflow.
  */
 
+#include <stddef.h>
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -51,16 +54,109 @@ void CL_AddCountingOption(CommandLineProcessor, int* value, CL_StringType name);
 void CL_AddIntegerOption(CommandLineProcessor, int* value, CL_StringType name);
 void CL_AddFloatOption(CommandLineProcessor, float* value, CL_StringType name);
 void CL_AddStringOption(CommandLineProcessor, CL_StringType* value, CL_StringType name);
+void CL_AddInt64Option(CommandLineProcessor, int64_t* value, CL_StringType name);
+void CL_AddDoubleOption(CommandLineProcessor, double* value, CL_StringType name);
+
+/// List options collect every occurrence; the values last until CL_Destroy or the next CL_Parse
+void CL_AddIntegerListOption(CommandLineProcessor, int const** values, size_t* count,
+                             CL_StringType name);
+void CL_AddFloatListOption(CommandLineProcessor, float const** values, size_t* count,
+                           CL_StringType name);
+void CL_AddStringListOption(CommandLineProcessor, CL_StringType const** values, size_t* count,
+                            CL_StringType name);
+void CL_AddInt64ListOption(CommandLineProcessor, int64_t const** values, size_t* count,
+                           CL_StringType name);
+void CL_AddDoubleListOption(CommandLineProcessor, double const** values, size_t* count,
+                            CL_StringType name);
+
+/// Custom options: \c parse loads the text into \c value, returning as CL_ParseInt64 does
+typedef int (*CL_ParseFn)(CL_StringType text, void* value, void* data);
+void CL_AddCustomOption(CommandLineProcessor, void* value, CL_StringType name, CL_ParseFn parse,
+                        void* data);
 
 /// Arguments
 void CL_AddArgument(CommandLineProcessor, CL_StringType* value);
 void CL_EnableOverflowArguments(CommandLineProcessor);
 CL_StringType* CL_GetOverflowArguments(CommandLineProcessor);
 
+/// Overflow arguments can be handed over one at a time rather than collected
+typedef void (*CL_OverflowFn)(CL_StringType argument, void* data);
+void CL_StreamOverflowArguments(CommandLineProcessor, CL_OverflowFn fn, void* data);
+
+/// Response files: '@file' and '-' (stdin) are replaced by the arguments they contain
+void CL_EnableResponseFiles(CommandLineProcessor);
+
+/// Overflow arguments with wildcards are replaced by the paths they match, in order
+void CL_EnableGlobExpansion(CommandLineProcessor);
+
+/// Options can be given by any unambiguous prefix of their names
+void CL_EnablePrefixMatching(CommandLineProcessor);
+
+
+/// Settings from a config file (optionally cached) and the environment, under the command line
+void CL_EnableConfigFile(CommandLineProcessor, CL_StringType path, CL_StringType cachePath);
+void CL_EnableEnvironment(CommandLineProcessor, CL_StringType prefix);
+
+/// Subcommands: the first argument picks one, and only then are its options added
+typedef void (*CL_SubcommandFn)(CommandLineProcessor, void* data);
+void CL_AddSubcommand(CommandLineProcessor, CL_StringType name, CL_SubcommandFn addOptions,
+                      void* data);
+CL_StringType CL_GetSubcommand(CommandLineProcessor);
+
+/// Numbers as options parse them: 1 if \c text is a number, -1 if it's out of range, 0 if not
+int CL_ParseInt64(CL_StringType text, int64_t* value);
+int CL_ParseDouble(CL_StringType text, double* value);
+
 /// Post
 CL_StringType CL_GetAppName(CommandLineProcessor);
 int CL_Parse(CommandLineProcessor, int argc, CL_StringType* argv);
 
+/// Specs: options bound to the members of a struct, frozen so that many threads can parse with them
+struct CL_Spec_;
+typedef struct CL_Spec_ const* CL_Spec;
+
+typedef struct CL_ParseResult
+{
+    CL_StringType appName;
+    CL_StringType* overflow;    ///< moved to the front of argv, just after the application name
+    int numOverflow;
+    int numErrors;
+} CL_ParseResult;
+
+CL_Spec CL_CreateSpec(CommandLineProcessor, void const* base, size_t size);
+void CL_DestroySpec(CL_Spec);
+int CL_ParseInto(CL_Spec, void* out, int argc, CL_StringType* argv, CL_ParseResult* result);
+
+/// Front ends with tables of their own: CL_ParseWith() walks the command line as CL_Parse() does
+/// and hands over what it finds, returning the number of errors. \c findOption returns how many
+/// parameters the option for \c arg (with its '-') takes and sets its number, or -1 once it's
+/// reported why there's no such option; \c loadOption returns nonzero if the parameters loaded,
+/// reporting why not otherwise; \c takeArgument returns 1 if it took an argument, 0 if there's
+/// nowhere for it, or -1 to end the parse after an error it's reported.
+typedef struct CL_Handler
+{
+    int (*findOption)(CL_StringType arg, size_t* option, void* data);
+    int (*loadOption)(size_t option, CL_StringType const* params, void* data);
+    int (*takeArgument)(CL_StringType arg, void* data);
+} CL_Handler;
+
+int CL_ParseWith(CL_Handler const*, void* data, int argc, CL_StringType* argv);
+
+/// The errors parsing reports, in the same words whichever front end finds them; \c name is the
+/// option's, for a parameter that didn't load
+typedef enum CL_Problem
+{
+    CL_UNKNOWN_OPTION,
+    CL_MISSING_PARAMETER,
+    CL_INVALID_PARAMETER,
+    CL_PARAMETER_OUT_OF_RANGE,
+    CL_UNHANDLED_ARGUMENT
+} CL_Problem;
+
+void CL_Report(CL_Problem, CL_StringType text, CL_StringType name);
+void CL_ReportUtf8(CL_Problem, char const* text, char const* name);
+void CL_ReportAmbiguousOption(CL_StringType arg, CL_StringType const* candidates, size_t count);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
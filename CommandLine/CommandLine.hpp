@@ -11,8 +11,54 @@
 
 #include "CommandLine.h"
 
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <vector>
 
+/**
+ * The values of a list option, which the CommandLine fills in when it parses. It has the read-only
+ * parts of std::vector's interface and refers to storage the CommandLine owns, so it's good until
+ * the CommandLine is destroyed or parses again; copy it into a std::vector to keep it longer.
+ */
+template <typename T>
+class CommandLineList
+{
+public:
+    typedef T value_type;
+    typedef size_t size_type;
+    typedef T const& const_reference;
+    typedef T const* const_iterator;
+
+    CommandLineList() : items(nullptr), count(0) {}
+
+    T const* begin() const { return items; }
+    T const* end() const { return items + count; }
+    T const* data() const { return items; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T const& operator[](size_t i) const { return items[i]; }
+    T const& front() const { return items[0]; }
+    T const& back() const { return items[count - 1]; }
+
+    operator std::vector<T>() const { return std::vector<T>(begin(), end()); }
+
+private:
+    friend class CommandLine;
+
+    T const* items;
+    size_t count;
+};
+
+/**
+ * How CommandLine::AddOption<T>() parses a T. Specialize it with a static function
+ * <code>Parse(CL_StringType text, T& value)</code> that returns whether it could, or 1, 0, or -1
+ * as CL_ParseInt64() does.
+ */
+template <typename T>
+struct CommandLineParser;
+
 class CommandLine
 {
 public:
@@ -27,10 +73,60 @@ public:
         { CL_AddFloatOption(processor, value, name); }
     void AddStringOption(CL_StringType* value, CL_StringType name)
         { CL_AddStringOption(processor, value, name); }
+    void AddInt64Option(int64_t* value, CL_StringType name)
+        { CL_AddInt64Option(processor, value, name); }
+    void AddDoubleOption(double* value, CL_StringType name)
+        { CL_AddDoubleOption(processor, value, name); }
+    void AddIntegerListOption(CommandLineList<int>* values, CL_StringType name)
+        { CL_AddIntegerListOption(processor, &values->items, &values->count, name); }
+    void AddFloatListOption(CommandLineList<float>* values, CL_StringType name)
+        { CL_AddFloatListOption(processor, &values->items, &values->count, name); }
+    void AddStringListOption(CommandLineList<CL_StringType>* values, CL_StringType name)
+        { CL_AddStringListOption(processor, &values->items, &values->count, name); }
+    void AddInt64ListOption(CommandLineList<int64_t>* values, CL_StringType name)
+        { CL_AddInt64ListOption(processor, &values->items, &values->count, name); }
+    void AddDoubleListOption(CommandLineList<double>* values, CL_StringType name)
+        { CL_AddDoubleListOption(processor, &values->items, &values->count, name); }
+
+    /// An option of any type, parsed by CommandLineParser<T>, or by the built in code for the
+    /// types there are Add functions for. The parser's called through a function made for it
+    /// alone, so it can be inlined there, and nothing is allocated for it.
+    template <typename T>
+    void AddOption(T* value, CL_StringType name)
+        { Add(value, name); }
+    /// An option parsed by \c parser, which has to last as long as the CommandLine, with
+    /// <code>parser(text, *value)</code>.
+    template <typename T, typename Parser>
+    void AddOption(T* value, CL_StringType name, Parser const* parser)
+        {
+            CL_AddCustomOption(processor, value, name, &ParseWithObject<T, Parser>,
+                               const_cast<Parser*>(parser));
+        }
+
     void AddArgument(CL_StringType* value)
         { CL_AddArgument(processor, value); }
     void EnableOverflowArguments()
         { CL_EnableOverflowArguments(processor); }
+    void StreamOverflowArguments(CL_OverflowFn fn, void* data)
+        { CL_StreamOverflowArguments(processor, fn, data); }
+    void EnableResponseFiles()
+        { CL_EnableResponseFiles(processor); }
+    void EnableGlobExpansion()
+        { CL_EnableGlobExpansion(processor); }
+    void EnablePrefixMatching()
+        { CL_EnablePrefixMatching(processor); }
+    void EnableConfigFile(CL_StringType path, CL_StringType cachePath = nullptr)
+        { CL_EnableConfigFile(processor, path, cachePath); }
+    void EnableEnvironment(CL_StringType prefix)
+        { CL_EnableEnvironment(processor, prefix); }
+
+    /// \c addOptions is only called, to add the subcommand's options, if it's the one chosen.
+    void AddSubcommand(CL_StringType name, std::function<void(CommandLine&)> addOptions)
+        {
+            subcommands.push_back({ this, std::move(addOptions) });
+            CL_AddSubcommand(processor, name, &AddSubcommandOptions, &subcommands.back());
+        }
+    CL_StringType GetSubcommand() const { return CL_GetSubcommand(processor); }
     std::vector<CL_StringType> GetOverflowArguments()
         {
             CL_StringType* overflow = CL_GetOverflowArguments(processor);
@@ -42,10 +138,47 @@ public:
 
     bool Parse(int argc, CL_StringType* argv) { return CL_Parse(processor, argc, argv) != 0; }
 
+    /// Freeze the options, all bound to members of \c prototype, for CL_ParseInto().
+    template <typename T>
+    CL_Spec CreateSpec(T const& prototype)
+        { return CL_CreateSpec(processor, &prototype, sizeof(T)); }
+
     CL_StringType GetApplicationName() const { return CL_GetAppName(processor); }
 
 private:
+    void Add(int* value, CL_StringType name) { AddIntegerOption(value, name); }
+    void Add(float* value, CL_StringType name) { AddFloatOption(value, name); }
+    void Add(CL_StringType* value, CL_StringType name) { AddStringOption(value, name); }
+    void Add(int64_t* value, CL_StringType name) { AddInt64Option(value, name); }
+    void Add(double* value, CL_StringType name) { AddDoubleOption(value, name); }
+    template <typename T>
+    void Add(T* value, CL_StringType name)
+        { CL_AddCustomOption(processor, value, name, &ParseWithParser<T>, nullptr); }
+
+    static int Result(bool parsed) { return parsed ? 1 : 0; }
+    static int Result(int parsed) { return parsed; }
+
+    template <typename T>
+    static int ParseWithParser(CL_StringType text, void* value, void*)
+        { return Result(CommandLineParser<T>::Parse(text, *static_cast<T*>(value))); }
+    template <typename T, typename Parser>
+    static int ParseWithObject(CL_StringType text, void* value, void* parser)
+        { return Result((*static_cast<Parser const*>(parser))(text, *static_cast<T*>(value))); }
+
+    struct Subcommand
+    {
+        CommandLine* commandLine;
+        std::function<void(CommandLine&)> addOptions;
+    };
+
+    static void AddSubcommandOptions(CommandLineProcessor, void* data)
+        {
+            Subcommand* sc = static_cast<Subcommand*>(data);
+            sc->addOptions(*sc->commandLine);
+        }
+
     CommandLineProcessor processor;
+    std::deque<Subcommand> subcommands;     ///< a deque so that they don't move
 };
 
 #endif // ndef CommandLine_hpp
@@ -0,0 +1,459 @@
+/**
+ * Timing for CommandLine with very large option tables and command lines.
+ *
+ * \author Tom Plunket <tom@mightysprite.com>
+ * \copyright (c) 2019 Tom Plunket, all rights reserved
+ *
+ * Licensed under the MIT/X license. Do with these files what you will.
+ *
+ * With no arguments this runs the whole suite: CL_Parse() and CommandLine::Parse() with 10 to
+ * 10,000 options of each type, on command lines of 10 to a million arguments, with and without
+ * overflow arguments mixed in. For each it reports the time per argument and the number of
+ * allocations the first parse makes and that each parse after it makes, which ought to be none
+ * unless there are lists. Allocations are counted by replacing malloc, which only works with
+ * glibc; elsewhere they're reported as '-'.
+ *
+ * <code>CommandLineBench options arguments</code> times a single run like the tool wrappers do,
+ * registering that many integer and counting options and parsing a command line of them.
+ *
+ * <code>CommandLineBench numbers [count]</code> instead times CL_ParseInt64() and
+ * CL_ParseDouble() against strtoll() and strtod() on a million (or count) random numbers, and
+ * checks that they agree.
+ *
+ * <code>CommandLineBench glob pattern...</code> times expanding the patterns, which are best
+ * quoted so that the shell leaves them alone, and says how many paths they matched.
+ */
+
+#include "CommandLine.hpp"
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+typedef std::basic_string<CL_CharType> String;
+
+static unsigned long long s_allocations = 0;
+
+#if defined(__GLIBC__)
+ #define BENCH_COUNTS_ALLOCATIONS 1
+extern "C"
+{
+    void* __libc_malloc(size_t);
+    void* __libc_calloc(size_t, size_t);
+    void* __libc_realloc(void*, size_t);
+    void __libc_free(void*);
+
+    void* malloc(size_t size) noexcept
+    {
+        ++s_allocations;
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t n, size_t size) noexcept
+    {
+        ++s_allocations;
+        return __libc_calloc(n, size);
+    }
+
+    void* realloc(void* p, size_t size) noexcept
+    {
+        ++s_allocations;
+        return __libc_realloc(p, size);
+    }
+
+    void free(void* p) noexcept
+    {
+        __libc_free(p);
+    }
+}
+#else
+ #define BENCH_COUNTS_ALLOCATIONS 0
+#endif
+
+static String MakeString(std::string const& s)
+{
+    return String(s.begin(), s.end());
+}
+
+static int BenchNumbers(int count)
+{
+    uint64_t state = 88172645463325252ull;
+    std::vector<std::string> integers, doubles;
+    for (int i = 0; i < count; ++i)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        char text[64];
+        snprintf(text, sizeof(text), "%" PRId64, (int64_t)state >> (state % 60));
+        integers.push_back(text);
+        snprintf(text, sizeof(text), "%.*g", (int)(state % 17) + 1,
+                 (double)(state >> 11) * 1e-10 * ((state & 1) ? 1e-20 : 1e20));
+        doubles.push_back(text);
+    }
+    std::vector<String> wideIntegers, wideDoubles;
+    for (int i = 0; i < count; ++i)
+    {
+        wideIntegers.push_back(MakeString(integers[i]));
+        wideDoubles.push_back(MakeString(doubles[i]));
+    }
+
+    using namespace std::chrono;
+    int mismatches = 0;
+    int64_t iSum = 0, iCheck = 0;
+    double dSum = 0, dCheck = 0;
+
+    auto const start = steady_clock::now();
+    for (String const& s : wideIntegers)
+    {
+        int64_t value;
+        CL_ParseInt64(s.c_str(), &value);
+        iSum += value;
+    }
+    auto const parsedIntegers = steady_clock::now();
+    for (std::string const& s : integers)
+        iCheck += strtoll(s.c_str(), nullptr, 10);
+    auto const strtolled = steady_clock::now();
+    for (String const& s : wideDoubles)
+    {
+        double value;
+        CL_ParseDouble(s.c_str(), &value);
+        dSum += value;
+    }
+    auto const parsedDoubles = steady_clock::now();
+    for (std::string const& s : doubles)
+        dCheck += strtod(s.c_str(), nullptr);
+    auto const strtoded = steady_clock::now();
+
+    for (int i = 0; i < count; ++i)
+    {
+        int64_t value;
+        double d;
+        if ((CL_ParseInt64(wideIntegers[i].c_str(), &value) != 1) ||
+            (value != strtoll(integers[i].c_str(), nullptr, 10)))
+        {
+            ++mismatches;
+        }
+        if ((CL_ParseDouble(wideDoubles[i].c_str(), &d) != 1) ||
+            (d != strtod(doubles[i].c_str(), nullptr)))
+        {
+            ++mismatches;
+        }
+    }
+
+    bool const sumsMatch = (iSum == iCheck) && (memcmp(&dSum, &dCheck, sizeof(double)) == 0);
+    printf("%d numbers of each kind, %d mismatches%s\n", count, mismatches,
+           sumsMatch ? "" : " (SUMS DIFFER)");
+    printf("  CL_ParseInt64:  %8.3f ms\n",
+           duration<double, std::milli>(parsedIntegers - start).count());
+    printf("  strtoll:        %8.3f ms\n",
+           duration<double, std::milli>(strtolled - parsedIntegers).count());
+    printf("  CL_ParseDouble: %8.3f ms\n",
+           duration<double, std::milli>(parsedDoubles - strtolled).count());
+    printf("  strtod:         %8.3f ms\n",
+           duration<double, std::milli>(strtoded - parsedDoubles).count());
+    return (mismatches == 0) ? 0 : 1;
+}
+
+enum OptionKind
+{
+    k_counting,
+    k_integer,
+    k_float,
+    k_string,
+    k_list,
+    k_numKinds
+};
+
+static char const* const k_kindNames[k_numKinds] = { "counting", "integer", "float", "string",
+                                                     "list" };
+
+/**
+ * A command line, and the names of the options on it.
+ */
+struct Workload
+{
+    std::vector<String> names;
+    std::vector<String> strings;
+    std::vector<CL_StringType> args;
+};
+
+/// Each option appears about as often as every other one, in a scattered order; every other
+/// argument is an overflow argument if there are any.
+static void MakeWorkload(Workload* w, OptionKind kind, int numOptions, int numArguments,
+                         bool overflow)
+{
+    w->names.clear();
+    w->strings.clear();
+    w->args.clear();
+
+    for (int i = 0; i < numOptions; ++i)
+        w->names.push_back(MakeString("option-" + std::to_string(i)));
+
+    w->strings.reserve(numArguments + 1);
+    w->strings.push_back(MakeString("bench"));
+    for (int i = 0; (int)w->strings.size() < numArguments; ++i)
+    {
+        if (overflow && (i % 2 == 1))
+        {
+            w->strings.push_back(MakeString("file" + std::to_string(i)));
+            continue;
+        }
+        int const option = (int)((i * 7919u) % numOptions);
+        w->strings.push_back(MakeString("-") + w->names[option]);
+        if (kind == k_float)
+            w->strings.push_back(MakeString(std::to_string(i % 1000) + ".25"));
+        else if (kind != k_counting)
+            w->strings.push_back(MakeString(std::to_string(i % 1000)));
+    }
+    for (String const& s : w->strings)
+        w->args.push_back(s.c_str());
+}
+
+/**
+ * Somewhere for the options to put their values.
+ */
+struct Values
+{
+    explicit Values(int numOptions) :
+        integers(numOptions), floats(numOptions), strings(numOptions), lists(numOptions),
+        counts(numOptions) {}
+
+    std::vector<int> integers;
+    std::vector<float> floats;
+    std::vector<CL_StringType> strings;
+    std::vector<int const*> lists;
+    std::vector<size_t> counts;
+};
+
+static void AddOptions(CommandLineProcessor clp, OptionKind kind, Workload const& w, Values* v)
+{
+    for (size_t i = 0; i < w.names.size(); ++i)
+    {
+        CL_StringType const name = w.names[i].c_str();
+        switch (kind)
+        {
+        case k_counting: CL_AddCountingOption(clp, &v->integers[i], name); break;
+        case k_integer: CL_AddIntegerOption(clp, &v->integers[i], name); break;
+        case k_float: CL_AddFloatOption(clp, &v->floats[i], name); break;
+        case k_string: CL_AddStringOption(clp, &v->strings[i], name); break;
+        default: CL_AddIntegerListOption(clp, &v->lists[i], &v->counts[i], name); break;
+        }
+    }
+}
+
+static void AddOptions(CommandLine* cl, OptionKind kind, Workload const& w, Values* v,
+                       std::vector<CommandLineList<int>>* lists)
+{
+    for (size_t i = 0; i < w.names.size(); ++i)
+    {
+        CL_StringType const name = w.names[i].c_str();
+        switch (kind)
+        {
+        case k_counting: cl->AddCountingOption(&v->integers[i], name); break;
+        case k_integer: cl->AddIntegerOption(&v->integers[i], name); break;
+        case k_float: cl->AddFloatOption(&v->floats[i], name); break;
+        case k_string: cl->AddStringOption(&v->strings[i], name); break;
+        default: cl->AddIntegerListOption(&(*lists)[i], name); break;
+        }
+    }
+}
+
+struct Measurement
+{
+    bool ok;
+    double nsPerArgument;
+    unsigned long long firstAllocations;
+    unsigned long long laterAllocations;    ///< per parse
+};
+
+/**
+ * Parse once to see what a fresh processor allocates, then again until enough time has gone by
+ * to get a steady number.
+ */
+template <typename ParseFn>
+static Measurement Measure(ParseFn parse, size_t numArguments)
+{
+    using namespace std::chrono;
+    Measurement m;
+
+    unsigned long long const before = s_allocations;
+    m.ok = parse();
+    m.firstAllocations = s_allocations - before;
+
+    int parses = 0;
+    unsigned long long const allocationsBefore = s_allocations;
+    auto const start = steady_clock::now();
+    auto now = start;
+    do
+    {
+        m.ok = parse() && m.ok;
+        ++parses;
+        now = steady_clock::now();
+    } while ((now - start < milliseconds(50)) && (parses < 1000000));
+
+    m.laterAllocations = (s_allocations - allocationsBefore) / parses;
+    m.nsPerArgument = duration<double, std::nano>(now - start).count() / parses / numArguments;
+    return m;
+}
+
+static void Report(char const* api, OptionKind kind, int numOptions, size_t numArguments,
+                   bool overflow, Measurement const& m)
+{
+    printf("%-4s %-9s %6d %8d %-3s %9.1f", api, k_kindNames[kind], numOptions, (int)numArguments,
+           overflow ? "yes" : "no", m.nsPerArgument);
+    if (BENCH_COUNTS_ALLOCATIONS)
+        printf(" %6llu %6llu", m.firstAllocations, m.laterAllocations);
+    else
+        printf(" %6s %6s", "-", "-");
+    printf("%s\n", m.ok ? "" : "  FAILED");
+}
+
+static int BenchSuite()
+{
+    static int const k_optionCounts[] = { 10, 100, 1000, 10000 };
+    static int const k_argumentCounts[] = { 10, 1000, 100000, 1000000 };
+
+    printf("%-4s %-9s %6s %8s %-3s %9s %6s %6s\n", "api", "type", "opts", "args", "ovf",
+           "ns/arg", "allocs", "later");
+
+    bool allOk = true;
+    Workload w;
+    for (int kind = 0; kind < k_numKinds; ++kind)
+    {
+        for (int numOptions : k_optionCounts)
+        {
+            for (int numArguments : k_argumentCounts)
+            {
+                for (int overflow = 0; overflow < 2; ++overflow)
+                {
+                    MakeWorkload(&w, (OptionKind)kind, numOptions, numArguments, overflow != 0);
+                    int const argc = (int)w.args.size();
+                    CL_StringType* const argv = &w.args[0];
+
+                    {
+                        Values v(numOptions);
+                        CommandLineProcessor clp = CL_Create();
+                        AddOptions(clp, (OptionKind)kind, w, &v);
+                        if (overflow)
+                            CL_EnableOverflowArguments(clp);
+                        Measurement m = Measure([&] { return CL_Parse(clp, argc, argv) != 0; },
+                                                w.args.size());
+                        CL_Destroy(clp);
+                        Report("C", (OptionKind)kind, numOptions, w.args.size(), overflow != 0, m);
+                        allOk = allOk && m.ok;
+                    }
+
+                    {
+                        Values v(numOptions);
+                        std::vector<CommandLineList<int>> lists(numOptions);
+                        CommandLine cl;
+                        AddOptions(&cl, (OptionKind)kind, w, &v, &lists);
+                        if (overflow)
+                            cl.EnableOverflowArguments();
+                        Measurement m = Measure([&] { return cl.Parse(argc, argv); },
+                                                w.args.size());
+                        Report("C++", (OptionKind)kind, numOptions, w.args.size(), overflow != 0,
+                               m);
+                        allOk = allOk && m.ok;
+                    }
+                }
+            }
+        }
+    }
+    return allOk ? 0 : 1;
+}
+
+/**
+ * Time glob expansion of the patterns in \c argv.
+ */
+static int BenchGlob(int argc, char** argv)
+{
+    std::vector<String> strings;
+    strings.push_back(MakeString("bench"));
+    for (int i = 0; i < argc; ++i)
+        strings.push_back(MakeString(argv[i]));
+    std::vector<CL_StringType> args;
+    for (String const& s : strings)
+        args.push_back(s.c_str());
+
+    using namespace std::chrono;
+    auto const start = steady_clock::now();
+
+    CommandLine cl;
+    size_t numPaths = 0;
+    cl.EnableGlobExpansion();
+    cl.StreamOverflowArguments([](CL_StringType, void* data) { ++*(size_t*)data; }, &numPaths);
+    bool const ok = cl.Parse((int)args.size(), &args[0]);
+    auto const expanded = steady_clock::now();
+
+    printf("%d patterns, %zu paths%s\n", argc, numPaths, ok ? "" : " (FAILED)");
+    printf("  expand: %8.3f ms\n", duration<double, std::milli>(expanded - start).count());
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+        return BenchSuite();
+    if (strcmp(argv[1], "numbers") == 0)
+        return BenchNumbers((argc > 2) ? atoi(argv[2]) : 1000000);
+    if (strcmp(argv[1], "glob") == 0)
+        return BenchGlob(argc - 2, argv + 2);
+
+    int const numOptions = atoi(argv[1]);
+    int const numArguments = (argc > 2) ? atoi(argv[2]) : 100000;
+    if ((numOptions <= 0) || (numArguments <= 0))
+    {
+        fprintf(stderr, "usage: %s [options [arguments] | numbers [count] | glob pattern...]\n",
+                argv[0]);
+        return 1;
+    }
+
+    std::vector<String> names;
+    for (int i = 0; i < numOptions; ++i)
+        names.push_back(MakeString("option-" + std::to_string(i)));
+
+    // every third option takes an integer
+    std::vector<String> strings;
+    strings.push_back(MakeString("bench"));
+    for (int i = 0; (int)strings.size() < numArguments; ++i)
+    {
+        int const option = (int)((i * 7919u) % numOptions);
+        strings.push_back(MakeString("-") + names[option]);
+        if (option % 3 == 0)
+            strings.push_back(MakeString(std::to_string(i)));
+    }
+    std::vector<CL_StringType> args;
+    for (String const& s : strings)
+        args.push_back(s.c_str());
+
+    std::vector<int> values(numOptions);
+
+    using namespace std::chrono;
+    auto const start = steady_clock::now();
+
+    CommandLine cl;
+    for (int i = 0; i < numOptions; ++i)
+    {
+        if (i % 3 == 0)
+            cl.AddIntegerOption(&values[i], names[i].c_str());
+        else
+            cl.AddCountingOption(&values[i], names[i].c_str());
+    }
+    auto const added = steady_clock::now();
+
+    bool const ok = cl.Parse((int)args.size(), &args[0]);
+    auto const parsed = steady_clock::now();
+
+    printf("%d options, %d arguments%s\n", numOptions, (int)args.size(), ok ? "" : " (FAILED)");
+    printf("  add:   %8.3f ms\n", duration<double, std::milli>(added - start).count());
+    printf("  parse: %8.3f ms (%.1f ns per argument)\n",
+           duration<double, std::milli>(parsed - added).count(),
+           duration<double, std::nano>(parsed - added).count() / args.size());
+    return ok ? 0 : 1;
+}
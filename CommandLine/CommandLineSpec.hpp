@@ -0,0 +1,354 @@
+#ifndef CommandLineSpec_hpp
+#define CommandLineSpec_hpp
+/**
+ * A command line processor whose options are described by a constexpr table.
+ *
+ * \author Tom Plunket <tom@mightysprite.com>
+ * \copyright (c) 2019 Tom Plunket, all rights reserved
+ *
+ * Licensed under the MIT/X license. Do with these files what you will.
+ *
+ * The options are bound to the members of a struct, so the table is a compile-time constant and
+ * each binding is checked against the member's type. The table has to be sorted by name, which
+ * IsSorted() checks at compile time, so options are found with a binary search; parsing doesn't
+ * allocate anything, and since the table is read-only any number of threads can parse with it at
+ * once. (CL_CreateSpec() does the same for options registered at run time.)
+ *
+ *     struct Settings
+ *     {
+ *         int verbose;
+ *         int count;
+ *         CL_StringType input;
+ *     };
+ *
+ *     constexpr CommandLineSpec::Option<Settings> k_options[] =
+ *     {
+ *         CommandLineSpec::Integer("count", &Settings::count),
+ *         CommandLineSpec::Counting("v", &Settings::verbose),
+ *         CommandLineSpec::Argument(&Settings::input),
+ *     };
+ *     static_assert(CommandLineSpec::IsSorted(k_options), "Options need to be sorted by name.");
+ *
+ *     Settings settings = {};
+ *     if (!CommandLineSpec::Parse(k_options, settings, argc, argv))
+ *         return 1;
+ *
+ * Arguments come after the options in the table and are filled in that order. Unlike the
+ * CommandLine class, members aren't reset before parsing, so whatever they're initialized to
+ * serves as the default. The parse itself is CL_ParseWith(), so it follows the same rules and
+ * gives the same error messages as CL_Parse(), and numbers are parsed by the same functions; this
+ * needs CommandLine.c too.
+ */
+
+#include "CommandLine.h"
+
+#include "Log/Log.h"
+
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace CommandLineSpec
+{
+    enum Kind
+    {
+        k_counting,
+        k_integer,
+        k_float,
+        k_string,
+        k_int64,
+        k_double,
+        k_argument,
+    };
+
+    template <typename T>
+    struct Option
+    {
+        CL_StringType name;     ///< nullptr for arguments
+        Kind kind;
+        int T::* intMember;
+        float T::* floatMember;
+        CL_StringType T::* stringMember;
+        int64_t T::* int64Member;
+        double T::* doubleMember;
+    };
+
+    template <typename T>
+    constexpr Option<T> Counting(CL_StringType name, int T::* member)
+    {
+        return Option<T>{ name, k_counting, member, nullptr, nullptr, nullptr, nullptr };
+    }
+
+    template <typename T>
+    constexpr Option<T> Integer(CL_StringType name, int T::* member)
+    {
+        return Option<T>{ name, k_integer, member, nullptr, nullptr, nullptr, nullptr };
+    }
+
+    template <typename T>
+    constexpr Option<T> Float(CL_StringType name, float T::* member)
+    {
+        return Option<T>{ name, k_float, nullptr, member, nullptr, nullptr, nullptr };
+    }
+
+    template <typename T>
+    constexpr Option<T> String(CL_StringType name, CL_StringType T::* member)
+    {
+        return Option<T>{ name, k_string, nullptr, nullptr, member, nullptr, nullptr };
+    }
+
+    template <typename T>
+    constexpr Option<T> Int64(CL_StringType name, int64_t T::* member)
+    {
+        return Option<T>{ name, k_int64, nullptr, nullptr, nullptr, member, nullptr };
+    }
+
+    template <typename T>
+    constexpr Option<T> Double(CL_StringType name, double T::* member)
+    {
+        return Option<T>{ name, k_double, nullptr, nullptr, nullptr, nullptr, member };
+    }
+
+    template <typename T>
+    constexpr Option<T> Argument(CL_StringType T::* member)
+    {
+        return Option<T>{ nullptr, k_argument, nullptr, nullptr, member, nullptr, nullptr };
+    }
+
+    /// Like strcmp, but usable at compile time.
+    constexpr int Compare(CL_StringType a, CL_StringType b)
+    {
+        return (*a != *b) ? ((*a < *b) ? -1 : 1) : (*a == 0) ? 0 : Compare(a + 1, b + 1);
+    }
+
+    template <typename T, size_t N>
+    constexpr bool AreArguments(Option<T> const (&options)[N], size_t i)
+    {
+        return (i >= N) || ((options[i].name == nullptr) && AreArguments(options, i + 1));
+    }
+
+    /// Are the options in order by name, each name different, with the arguments at the end?
+    template <typename T, size_t N>
+    constexpr bool IsSorted(Option<T> const (&options)[N], size_t i=0)
+    {
+        return (i >= N) ? true :
+               (options[i].name == nullptr) ? AreArguments(options, i) :
+               ((i > 0) && (Compare(options[i - 1].name, options[i].name) >= 0)) ? false :
+               IsSorted(options, i + 1);
+    }
+
+    struct Result
+    {
+        bool ok;
+        CL_StringType appName;
+        CL_StringType* overflow;    ///< the overflow arguments, moved to the front of argv
+        int numOverflow;
+
+        explicit operator bool() const { return ok; }
+    };
+
+    namespace Detail
+    {
+        template <typename T, size_t N>
+        Option<T> const* Find(Option<T> const (&options)[N], CL_StringType name)
+        {
+            // arguments have no name and sort after everything
+            size_t low = 0, high = N;
+            while (low < high)
+            {
+                size_t const middle = (low + high) / 2;
+                int const c = (options[middle].name == nullptr) ? 1 :
+                              Compare(options[middle].name, name);
+                if (c == 0)
+                    return &options[middle];
+                if (c < 0)
+                    low = middle + 1;
+                else
+                    high = middle;
+            }
+            return nullptr;
+        }
+
+        inline bool StartsWith(CL_StringType name, CL_StringType prefix)
+        {
+            while ((*prefix != 0) && (*name == *prefix))
+                ++name, ++prefix;
+            return *prefix == 0;
+        }
+
+        /**
+         * Find the option for \c arg, which still has its '-', by name or, if \c allowPrefixes,
+         * by a prefix no other option shares. If there isn't one it says why.
+         */
+        template <typename T, size_t N>
+        Option<T> const* Lookup(Option<T> const (&options)[N], CL_StringType arg,
+                                bool allowPrefixes)
+        {
+            CL_StringType const name = arg + 1;
+            Option<T> const* o = Find(options, name);
+            if ((o != nullptr) || !allowPrefixes || (*name == 0))
+            {
+                if (o == nullptr)
+                    CL_Report(CL_UNKNOWN_OPTION, arg, nullptr);
+                return o;
+            }
+
+            // the first name not before the prefix, and then any more that start with it
+            size_t low = 0, high = N;
+            while (low < high)
+            {
+                size_t const middle = (low + high) / 2;
+                if ((options[middle].name != nullptr) && (Compare(options[middle].name, name) < 0))
+                    low = middle + 1;
+                else
+                    high = middle;
+            }
+            size_t end = low;
+            while ((end < N) && (options[end].name != nullptr) &&
+                   StartsWith(options[end].name, name))
+            {
+                ++end;
+            }
+
+            if (end == low + 1)
+                return &options[low];
+            if (end == low)
+            {
+                CL_Report(CL_UNKNOWN_OPTION, arg, nullptr);
+                return nullptr;
+            }
+
+            // the same message as CL_Parse, which lists at most eight of them
+            CL_StringType candidates[9];
+            size_t count = 0;
+            for (size_t i = low; (i < end) && (count < 9); ++i)
+                candidates[count++] = options[i].name;
+            CL_ReportAmbiguousOption(arg, candidates, count);
+            return nullptr;
+        }
+
+        inline bool Report(int parsed, CL_StringType param, CL_StringType name)
+        {
+            if (parsed <= 0)
+                CL_Report((parsed < 0) ? CL_PARAMETER_OUT_OF_RANGE : CL_INVALID_PARAMETER, param,
+                          name);
+            return parsed > 0;
+        }
+
+        template <typename T>
+        bool Load(Option<T> const& o, T& out, CL_StringType param)
+        {
+            int64_t i;
+            double d;
+            switch (o.kind)
+            {
+            case k_integer:
+            {
+                int parsed = CL_ParseInt64(param, &i);
+                if ((parsed > 0) && ((i < INT_MIN) || (i > INT_MAX)))
+                    parsed = -1;
+                if (parsed > 0)
+                    out.*(o.intMember) = (int)i;
+                return Report(parsed, param, o.name);
+            }
+            case k_int64:
+                return Report(CL_ParseInt64(param, &(out.*(o.int64Member))), param, o.name);
+            case k_float:
+            {
+                int parsed = CL_ParseDouble(param, &d);
+                if ((parsed > 0) && std::isfinite(d) && (std::fabs(d) > FLT_MAX))
+                    parsed = -1;
+                if (parsed > 0)
+                    out.*(o.floatMember) = (float)d;
+                return Report(parsed, param, o.name);
+            }
+            case k_double:
+                return Report(CL_ParseDouble(param, &(out.*(o.doubleMember))), param, o.name);
+            default:
+                out.*(o.stringMember) = param;
+                return true;
+            }
+        }
+
+        /// Where a parse has got to, and what CL_ParseWith() hands what it finds to.
+        template <typename T, size_t N>
+        struct Parser
+        {
+            Option<T> const (&options)[N];
+            T& out;
+            Result& result;
+            size_t nextArgument;
+            bool allowOverflow;
+            bool allowPrefixes;
+
+            static int FindOption(CL_StringType arg, size_t* option, void* data)
+            {
+                Parser const* p = static_cast<Parser const*>(data);
+                Option<T> const* o = Lookup(p->options, arg, p->allowPrefixes);
+                if (o == nullptr)
+                    return -1;
+                *option = (size_t)(o - p->options);
+                return (o->kind == k_counting) ? 0 : 1;
+            }
+
+            static int LoadOption(size_t option, CL_StringType const* params, void* data)
+            {
+                Parser* p = static_cast<Parser*>(data);
+                Option<T> const& o = p->options[option];
+                if (o.kind != k_counting)
+                    return Load(o, p->out, params[0]);
+                p->out.*(o.intMember) += 1;
+                return 1;
+            }
+
+            static int TakeArgument(CL_StringType arg, void* data)
+            {
+                Parser* p = static_cast<Parser*>(data);
+                if (p->nextArgument < N)
+                {
+                    p->out.*(p->options[p->nextArgument++].stringMember) = arg;
+                }
+                else if (p->allowOverflow)
+                {
+                    // this never writes past the argument that's being read
+                    p->result.overflow[p->result.numOverflow++] = arg;
+                }
+                else
+                {
+                    return 0;
+                }
+                return 1;
+            }
+        };
+    }
+
+    /**
+     * Parse the command line into \c out. Arguments beyond the ones in the table are an error
+     * unless \c allowOverflow is set, in which case they're gathered at the front of argv (just
+     * after the application name) and the result says where. With \c allowPrefixes, options can
+     * be given by any prefix of their names that no other option shares, as with
+     * CL_EnablePrefixMatching().
+     */
+    template <typename T, size_t N>
+    Result Parse(Option<T> const (&options)[N], T& out, int argc, CL_StringType* argv,
+                 bool allowOverflow=false, bool allowPrefixes=false)
+    {
+        static CL_Handler const k_handler =
+        {
+            Detail::Parser<T, N>::FindOption, Detail::Parser<T, N>::LoadOption,
+            Detail::Parser<T, N>::TakeArgument
+        };
+
+        Result result = { true, (argc > 0) ? argv[0] : nullptr, argv + 1, 0 };
+        Detail::Parser<T, N> parser = { options, out, result, 0, allowOverflow, allowPrefixes };
+        while ((parser.nextArgument < N) && (options[parser.nextArgument].name != nullptr))
+            ++parser.nextArgument;
+
+        result.ok = (CL_ParseWith(&k_handler, &parser, argc, argv) == 0);
+        return result;
+    }
+}
+
+#endif // ndef CommandLineSpec_hpp
@@ -0,0 +1,181 @@
+/**
+ * Tests for the constexpr command line specification.
+ *
+ * \author Tom Plunket <tom@mightysprite.com>
+ * \copyright (c) 2019 Tom Plunket, all rights reserved
+ *
+ * Licensed under the MIT/X license. Do with these files what you will.
+ */
+
+#include "CommandLineSpec.hpp"
+
+#include "Log/LogTarget.hpp"
+
+#include "Catch/Catch.hpp"
+
+#include <string>
+#include <vector>
+
+#if CL_USE_wchar_t
+#define S(x) L ## x
+#else
+#define S(x) x
+#endif
+
+#define ARGS(...) \
+    CL_StringType args[] = { __VA_ARGS__ }; \
+    int const num_args = sizeof(args) / sizeof(args[0])
+
+namespace
+{
+    struct Settings
+    {
+        int verbose;
+        int count;
+        float scale;
+        CL_StringType name;
+        CL_StringType input;
+        CL_StringType output;
+    };
+
+    constexpr CommandLineSpec::Option<Settings> k_options[] =
+    {
+        CommandLineSpec::Integer(S("count"), &Settings::count),
+        CommandLineSpec::String(S("name"), &Settings::name),
+        CommandLineSpec::Float(S("scale"), &Settings::scale),
+        CommandLineSpec::Counting(S("v"), &Settings::verbose),
+        CommandLineSpec::Argument(&Settings::input),
+        CommandLineSpec::Argument(&Settings::output),
+    };
+    static_assert(CommandLineSpec::IsSorted(k_options), "The test table is in order.");
+
+    constexpr CommandLineSpec::Option<Settings> k_unsorted[] =
+    {
+        CommandLineSpec::Counting(S("v"), &Settings::verbose),
+        CommandLineSpec::Integer(S("count"), &Settings::count),
+    };
+    static_assert(!CommandLineSpec::IsSorted(k_unsorted), "Out of order tables are caught.");
+
+    constexpr CommandLineSpec::Option<Settings> k_duplicated[] =
+    {
+        CommandLineSpec::Counting(S("v"), &Settings::verbose),
+        CommandLineSpec::Counting(S("v"), &Settings::count),
+    };
+    static_assert(!CommandLineSpec::IsSorted(k_duplicated), "Duplicates are caught.");
+
+    constexpr CommandLineSpec::Option<Settings> k_argumentFirst[] =
+    {
+        CommandLineSpec::Argument(&Settings::input),
+        CommandLineSpec::Counting(S("v"), &Settings::verbose),
+    };
+    static_assert(!CommandLineSpec::IsSorted(k_argumentFirst), "Arguments go last.");
+
+    struct Messages : public LogTarget
+    {
+        std::vector<std::string> messages;
+
+        void LogMessage(char const* m, LogType, char const*, unsigned int) override
+        {
+            messages.push_back(m);
+        }
+    };
+}
+
+TEST_CASE( "CommandLineSpec" )
+{
+    Messages log;
+    Settings settings = {};
+
+    SECTION( "Options and arguments." )
+    {
+        ARGS(S("app"), S("in"), S("-v"), S("-count"), S("-12"), S("-v"), S("-scale"), S("2.5"),
+             S("-name"), S("bob"), S("out"));
+        CommandLineSpec::Result r = CommandLineSpec::Parse(k_options, settings, num_args, args);
+        REQUIRE(r);
+        REQUIRE(r.appName == args[0]);
+        REQUIRE(settings.verbose == 2);
+        REQUIRE(settings.count == -12);
+        REQUIRE(settings.scale == 2.5f);
+        REQUIRE(settings.name == args[9]);
+        REQUIRE(settings.input == args[1]);
+        REQUIRE(settings.output == args[10]);
+        REQUIRE(log.messages.empty());
+    }
+
+    SECTION( "Defaults are left alone." )
+    {
+        settings.count = 7;
+        ARGS(S("app"), S("-v"));
+        REQUIRE(CommandLineSpec::Parse(k_options, settings, num_args, args));
+        REQUIRE(settings.count == 7);
+    }
+
+    SECTION( "Errors." )
+    {
+        ARGS(S("app"), S("-nope"), S("-count"), S("x"), S("-name"));
+        REQUIRE(!CommandLineSpec::Parse(k_options, settings, num_args, args));
+        REQUIRE(log.messages.size() == 3);
+        REQUIRE_THAT(log.messages[0], Catch::StartsWith("Unknown option"));
+        REQUIRE_THAT(log.messages[1], Catch::Contains("is not a valid parameter"));
+        REQUIRE_THAT(log.messages[2], Catch::Contains("requires 1 parameters"));
+        REQUIRE(settings.input == args[3]);     // as with CL_Parse
+    }
+
+    SECTION( "Overflow." )
+    {
+        ARGS(S("app"), S("a"), S("b"), S("-v"), S("c"), S("d"));
+
+        SECTION( "is an error unless it's allowed" )
+        {
+            REQUIRE(!CommandLineSpec::Parse(k_options, settings, num_args, args));
+            REQUIRE_THAT(log.messages[0], Catch::Contains("can't be handled"));
+        }
+
+        SECTION( "and is gathered at the front of argv." )
+        {
+            CL_StringType c = args[4], d = args[5];
+            CommandLineSpec::Result r =
+                CommandLineSpec::Parse(k_options, settings, num_args, args, true);
+            REQUIRE(r);
+            REQUIRE(r.numOverflow == 2);
+            REQUIRE(r.overflow == args + 1);
+            REQUIRE(r.overflow[0] == c);
+            REQUIRE(r.overflow[1] == d);
+        }
+    }
+    SECTION( "Prefixes, when they're allowed." )
+    {
+        SECTION( "A unique prefix finds its option." )
+        {
+            ARGS(S("app"), S("-sc"), S("2"), S("-c"), S("3"));
+            REQUIRE(CommandLineSpec::Parse(k_options, settings, num_args, args, false, true));
+            REQUIRE(settings.scale == 2.0f);
+            REQUIRE(settings.count == 3);
+        }
+
+        SECTION( "They aren't otherwise." )
+        {
+            ARGS(S("app"), S("-sc"), S("2"));
+            REQUIRE(!CommandLineSpec::Parse(k_options, settings, num_args, args));
+            REQUIRE_THAT(log.messages[0], Catch::StartsWith("Unknown option '-sc'"));
+        }
+    }
+
+    SECTION( "Ambiguous prefixes are errors that say what they could be." )
+    {
+        constexpr CommandLineSpec::Option<Settings> k_similar[] =
+        {
+            CommandLineSpec::Integer(S("count"), &Settings::count),
+            CommandLineSpec::Counting(S("counting"), &Settings::verbose),
+            CommandLineSpec::Float(S("scale"), &Settings::scale),
+        };
+        static_assert(CommandLineSpec::IsSorted(k_similar), "The test table is in order.");
+
+        ARGS(S("app"), S("-co"), S("-count"), S("1"));
+        REQUIRE(!CommandLineSpec::Parse(k_similar, settings, num_args, args, false, true));
+        REQUIRE(log.messages.size() == 1);
+        REQUIRE(log.messages[0] ==
+                "Option '-co' is ambiguous; it could be '-count', '-counting'.\n");
+        REQUIRE(settings.count == 1);
+    }
+}
@@ -14,8 +14,22 @@
 #define CATCH_CONFIG_MAIN
 #include "Catch/Catch.hpp"
 
+#include <cinttypes>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <string>
 #include <queue>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
 
 #if CL_USE_wchar_t
 #define S(x) L ## x
@@ -319,15 +333,1173 @@ TEST_CASE( "CommandLine API, C Interface" )
         }
     }
 
+    SECTION( "Option lookup" )
+    {
+        SECTION( "Many options all get found." )
+        {
+            int values[100];
+            std::vector<std::basic_string<CL_CharType>> names;
+            for (int i = 0; i < 100; ++i)
+            {
+                std::string name = "opt" + std::to_string(i);
+                names.emplace_back(name.begin(), name.end());
+            }
+            for (int i = 0; i < 100; ++i)
+                CL_AddCountingOption(clp, &values[i], names[i].c_str());
+
+            ARGS(S("app"), S("-opt0"), S("-opt99"), S("-opt42"), S("-opt42"));
+            REQUIRE(CL_Parse(clp, num_args, args));
+            REQUIRE(values[0] == 1);
+            REQUIRE(values[99] == 1);
+            REQUIRE(values[42] == 2);
+            REQUIRE(values[1] == 0);
+        }
+
+        SECTION( "Options and arguments keep working as the storage grows." )
+        {
+            int value;
+            CL_StringType arguments[20];
+            CL_EnableOverflowArguments(clp);
+            CL_AddCountingOption(clp, &value, S("first"));
+            for (int i = 0; i < 20; ++i)
+                CL_AddArgument(clp, &arguments[i]);
+
+            std::vector<CL_StringType> argv(1, S("app"));
+            for (int i = 0; i < 25; ++i)
+                argv.push_back(S("arg"));
+            argv.push_back(S("-first"));
+            REQUIRE(CL_Parse(clp, (int)argv.size(), &argv[0]));
+            REQUIRE(value == 1);
+            REQUIRE(arguments[19] == argv[20]);
+
+            CL_StringType* overflow = CL_GetOverflowArguments(clp);
+            int numOverflow = 0;
+            while (overflow[numOverflow] != NULL)
+                ++numOverflow;
+            REQUIRE(numOverflow == 5);
+        }
+
+        SECTION( "The most recently added option of a name wins." )
+        {
+            int older, newer;
+            CL_AddCountingOption(clp, &older, S("v"));
+            CL_AddCountingOption(clp, &newer, S("v"));
+            ARGS(S("app"), S("-v"));
+            REQUIRE(CL_Parse(clp, num_args, args));
+            REQUIRE(older == 0);
+            REQUIRE(newer == 1);
+        }
+
+        SECTION( "Options added after a parse are found by the next one." )
+        {
+            int a, b;
+            CL_AddCountingOption(clp, &a, S("a"));
+            ARGS(S("app"), S("-a"), S("-b"));
+            REQUIRE(!CL_Parse(clp, num_args, args));
+            REQUIRE_THAT(tlt.pop(), Catch::StartsWith("Unknown option"));
+
+            CL_AddCountingOption(clp, &b, S("b"));
+            a = 0;
+            REQUIRE(CL_Parse(clp, num_args, args));
+            REQUIRE(a == 1);
+            REQUIRE(b == 1);
+        }
+    }
+
+    SECTION( "Prefix matching" )
+    {
+        int verbose, version, quiet;
+        CL_AddCountingOption(clp, &verbose, S("verbose"));
+        CL_AddCountingOption(clp, &version, S("version"));
+        CL_AddCountingOption(clp, &quiet, S("quiet"));
+        CL_AddCountingOption(clp, &quiet, S("q"));
+
+        SECTION( "Is off unless it's enabled." )
+        {
+            ARGS(S("app"), S("-verb"));
+            REQUIRE(!CL_Parse(clp, num_args, args));
+            REQUIRE_THAT(tlt.pop(), Catch::StartsWith("Unknown option '-verb'"));
+        }
+
+        SECTION( "Unique prefixes and whole names work." )
+        {
+            CL_EnablePrefixMatching(clp);
+            ARGS(S("app"), S("-verb"), S("-versi"), S("-qu"), S("-q"), S("-version"));
+            REQUIRE(CL_Parse(clp, num_args, args));
+            REQUIRE(verbose == 1);
+            REQUIRE(version == 2);
+            REQUIRE(quiet == 2);
+        }
+
+        SECTION( "Ambiguous prefixes say what they could be." )
+        {
+            CL_EnablePrefixMatching(clp);
+            ARGS(S("app"), S("-ver"), S("/v"), S("-z"));
+            REQUIRE(!CL_Parse(clp, num_args, args));
+            REQUIRE(tlt.pop() ==
+                    "Option '-ver' is ambiguous; it could be '-verbose', '-version'.\n");
+            REQUIRE(tlt.pop() ==
+                    "Option '/v' is ambiguous; it could be '/verbose', '/version'.\n");
+            REQUIRE_THAT(tlt.pop(), Catch::StartsWith("Unknown option '-z'"));
+        }
+
+        SECTION( "Long lists of candidates are cut short." )
+        {
+            CL_EnablePrefixMatching(clp);
+            std::vector<std::basic_string<CL_CharType>> names;
+            for (int i = 0; i < 20; ++i)
+            {
+                std::string name = "opt" + std::to_string(i);
+                names.emplace_back(name.begin(), name.end());
+            }
+            for (int i = 0; i < 20; ++i)
+                CL_AddCountingOption(clp, &quiet, names[i].c_str());
+
+            ARGS(S("app"), S("-opt1"), S("-opt"));
+            REQUIRE(!CL_Parse(clp, num_args, args));
+            REQUIRE(tlt.pop() == "Option '-opt' is ambiguous; it could be '-opt0', '-opt1', "
+                                 "'-opt10', '-opt11', '-opt12', '-opt13', '-opt14', '-opt15', "
+                                 "or others.\n");
+        }
+    }
+
+    SECTION( "Subcommands" )
+    {
+        struct Build
+        {
+            int added = 0;
+            int jobs;
+            CL_StringType target;
+
+            static void AddOptions(CommandLineProcessor clp, void* data)
+            {
+                Build* b = (Build*)data;
+                ++b->added;
+                CL_AddIntegerOption(clp, &b->jobs, S("j"));
+                CL_AddArgument(clp, &b->target);
+            }
+        } build;
+
+        struct Clean
+        {
+            int added = 0;
+            int all;
+
+            static void AddOptions(CommandLineProcessor clp, void* data)
+            {
+                Clean* c = (Clean*)data;
+                ++c->added;
+                CL_AddCountingOption(clp, &c->all, S("all"));
+            }
+        } clean;
+
+        int verbose;
+        CL_AddCountingOption(clp, &verbose, S("v"));
+        CL_AddSubcommand(clp, S("build"), &Build::AddOptions, &build);
+        CL_AddSubcommand(clp, S("clean"), &Clean::AddOptions, &clean);
+
+        SECTION( "Only the chosen one's options get added." )
+        {
+            ARGS(S("app"), S("-v"), S("build"), S("-j"), S("8"), S("everything"), S("-v"));
+            REQUIRE(CL_Parse(clp, num_args, args));
+            REQUIRE(CL_GetSubcommand(clp) == args[2]);
+            REQUIRE(build.added == 1);
+            REQUIRE(clean.added == 0);
+            REQUIRE(verbose == 2);
+            REQUIRE(build.jobs == 8);
+            REQUIRE(build.target == args[5]);
+
+            // and again for each parse that chooses it, starting over
+            REQUIRE(CL_Parse(clp, 3, args));
+            REQUIRE(build.added == 2);
+            REQUIRE(build.jobs == 0);
+            REQUIRE(build.target == NULL);
+        }
+
+        SECTION( "Parse again with the other subcommand." )
+        {
+            ARGS(S("app"), S("build"), S("x"));
+            REQUIRE(CL_Parse(clp, num_args, args));
+            REQUIRE(build.target == args[2]);
+
+            CL_StringType cleanArgs[] = { S("app"), S("clean"), S("-j"), S("4"), S("stray") };
+            REQUIRE(!CL_Parse(clp, 5, cleanArgs));
+            REQUIRE_THAT(tlt.pop(), Catch::StartsWith("Unknown option '-j'"));
+            REQUIRE_THAT(tlt.pop(), Catch::StartsWith("Argument '4'"));
+            REQUIRE_THAT(tlt.pop(), Catch::StartsWith("Argument 'stray'"));
+            REQUIRE(CL_GetSubcommand(clp) == cleanArgs[1]);
+            REQUIRE(build.jobs == 0);
+            REQUIRE(build.target == args[2]);
+
+            // and with none, there are only the shared options
+            CL_StringType noneArgs[] = { S("app"), S("-j"), S("9") };
+            REQUIRE(!CL_Parse(clp, 3, noneArgs));
+            REQUIRE_THAT(tlt.pop(), Catch::StartsWith("Unknown option '-j'"));
+            REQUIRE_THAT(tlt.pop(), Catch::StartsWith("Unknown command '9'"));
+            REQUIRE(CL_GetSubcommand(clp) == NULL);
+            REQUIRE(clean.added == 1);
+        }
+
+        SECTION( "Other subcommands' options aren't there." )
+        {
+            ARGS(S("app"), S("clean"), S("-j"), S("8"));
+            REQUIRE(!CL_Parse(clp, num_args, args));
+            REQUIRE_THAT(tlt.pop(), Catch::StartsWith("Unknown option '-j'"));
+            REQUIRE_THAT(tlt.pop(), Catch::StartsWith("Argument '8'"));
+            REQUIRE(build.added == 0);
+        }
+
+        SECTION( "Unknown commands are errors." )
+        {
+            ARGS(S("app"), S("-v"), S("bild"), S("-j"), S("8"));
+            REQUIRE(!CL_Parse(clp, num_args, args));
+            REQUIRE(tlt.pop() == "Unknown command 'bild'.\n");
+            REQUIRE(CL_GetSubcommand(clp) == NULL);
+        }
+
+        SECTION( "Choosing none is up to the caller." )
+        {
+            ARGS(S("app"), S("-v"));
+            REQUIRE(CL_Parse(clp, num_args, args));
+            REQUIRE(CL_GetSubcommand(clp) == NULL);
+        }
+    }
+
+    SECTION( "List options" )
+    {
+        int const* integers;
+        size_t numIntegers;
+        CL_StringType const* strings;
+        size_t numStrings;
+        double const* doubles;
+        size_t numDoubles;
+        CL_AddIntegerListOption(clp, &integers, &numIntegers, S("n"));
+        CL_AddStringListOption(clp, &strings, &numStrings, S("I"));
+        CL_AddDoubleListOption(clp, &doubles, &numDoubles, S("d"));
+
+        SECTION( "Start out empty." )
+        {
+            REQUIRE(integers == NULL);
+            REQUIRE(numIntegers == 0);
+        }
+
+        SECTION( "Every occurrence is kept, in order." )
+        {
+            ARGS(S("app"), S("-I"), S("include"), S("-n"), S("1"), S("-I"), S("src"), S("-n"),
+                 S("0x10"), S("-n"), S("-3"), S("-d"), S("0.5"));
+            REQUIRE(CL_Parse(clp, num_args, args));
+            REQUIRE(numIntegers == 3);
+            REQUIRE(integers[0] == 1);
+            REQUIRE(integers[1] == 16);
+            REQUIRE(integers[2] == -3);
+            REQUIRE(numStrings == 2);
+            REQUIRE(strings[0] == args[2]);
+            REQUIRE(strings[1] == args[6]);
+            REQUIRE(numDoubles == 1);
+            REQUIRE(doubles[0] == 0.5);
+        }
+
+        SECTION( "Lists that don't appear are empty." )
+        {
+            ARGS(S("app"), S("-n"), S("7"));
+            REQUIRE(CL_Parse(clp, num_args, args));
+            REQUIRE(numIntegers == 1);
+            REQUIRE(numStrings == 0);
+            REQUIRE(strings == NULL);
+        }
+
+        SECTION( "Bad values are left out and reported." )
+        {
+            ARGS(S("app"), S("-n"), S("1"), S("-n"), S("x"));
+            REQUIRE(!CL_Parse(clp, num_args, args));
+            REQUIRE_THAT(tlt.pop(), Catch::StartsWith("'x' is not a valid parameter"));
+            REQUIRE_THAT(tlt.pop(), Catch::StartsWith("Argument 'x'"));
+            REQUIRE(numIntegers == 1);
+        }
+
+        SECTION( "Lots of values, and parsing again starts over." )
+        {
+            std::vector<std::basic_string<CL_CharType>> numbers;
+            for (int i = 0; i < 1000; ++i)
+            {
+                std::string n = std::to_string(i);
+                numbers.emplace_back(n.begin(), n.end());
+            }
+            std::vector<CL_StringType> argv(1, S("app"));
+            for (int i = 0; i < 1000; ++i)
+            {
+                argv.push_back(S("-n"));
+                argv.push_back(numbers[i].c_str());
+            }
+            REQUIRE(CL_Parse(clp, (int)argv.size(), &argv[0]));
+            REQUIRE(numIntegers == 1000);
+            bool inOrder = true;
+            for (int i = 0; i < 1000; ++i)
+                inOrder = inOrder && (integers[i] == i);
+            REQUIRE(inOrder);
+
+            REQUIRE(CL_Parse(clp, 3, &argv[0]));
+            REQUIRE(numIntegers == 1);
+            REQUIRE(integers[0] == 0);
+        }
+    }
+
     CL_Destroy(clp);
     CHECK(!tlt.hasMessages());
 }
 
+/// Parse a narrow string with a wide or narrow parser.
+static int ParseDouble(char const* text, double* value)
+{
+    std::basic_string<CL_CharType> s(text, text + strlen(text));
+    return CL_ParseDouble(s.c_str(), value);
+}
+
+static int ParseInt64(char const* text, int64_t* value)
+{
+    std::basic_string<CL_CharType> s(text, text + strlen(text));
+    return CL_ParseInt64(s.c_str(), value);
+}
+
+TEST_CASE( "Number parsing" )
+{
+    int64_t i = 0;
+    double d = 0;
+
+    SECTION( "Integers in various bases." )
+    {
+        REQUIRE(ParseInt64("1234", &i) == 1);
+        REQUIRE(i == 1234);
+        REQUIRE(ParseInt64("-0x7fFF", &i) == 1);
+        REQUIRE(i == -0x7fff);
+        REQUIRE(ParseInt64("0b1011", &i) == 1);
+        REQUIRE(i == 11);
+        REQUIRE(ParseInt64("017", &i) == 1);
+        REQUIRE(i == 17);
+        REQUIRE(ParseInt64("-0010", &i) == 1);
+        REQUIRE(i == -10);
+        REQUIRE(ParseInt64("09", &i) == 1);
+        REQUIRE(i == 9);
+        REQUIRE(ParseInt64("0o17", &i) == 1);
+        REQUIRE(i == 15);
+        REQUIRE(ParseInt64("0", &i) == 1);
+        REQUIRE(i == 0);
+        REQUIRE(ParseInt64("+5", &i) == 1);
+        REQUIRE(i == 5);
+    }
+
+    SECTION( "Size suffixes." )
+    {
+        REQUIRE(ParseInt64("64k", &i) == 1);
+        REQUIRE(i == 64 * 1024);
+        REQUIRE(ParseInt64("3M", &i) == 1);
+        REQUIRE(i == 3 * 1024 * 1024);
+        REQUIRE(ParseInt64("-2G", &i) == 1);
+        REQUIRE(i == -2LL * 1024 * 1024 * 1024);
+        REQUIRE(ParseDouble("1.5k", &d) == 1);
+        REQUIRE(d == 1536.0);
+    }
+
+    SECTION( "Integer limits." )
+    {
+        REQUIRE(ParseInt64("9223372036854775807", &i) == 1);
+        REQUIRE(i == INT64_MAX);
+        REQUIRE(ParseInt64("-9223372036854775808", &i) == 1);
+        REQUIRE(i == INT64_MIN);
+        REQUIRE(ParseInt64("9223372036854775808", &i) == -1);
+        REQUIRE(ParseInt64("0xffffffffffffffffff", &i) == -1);
+        REQUIRE(ParseInt64("8G", &i) == 1);
+        REQUIRE(ParseInt64("9000000000G", &i) == -1);
+    }
+
+    SECTION( "Not integers." )
+    {
+        REQUIRE(ParseInt64("", &i) == 0);
+        REQUIRE(ParseInt64("-", &i) == 0);
+        REQUIRE(ParseInt64("0x", &i) == 0);
+        REQUIRE(ParseInt64("12a", &i) == 0);
+        REQUIRE(ParseInt64("0o9", &i) == 0);
+        REQUIRE(ParseInt64("1.5", &i) == 0);
+        REQUIRE(ParseInt64("5kk", &i) == 0);
+    }
+
+    SECTION( "Doubles match strtod exactly." )
+    {
+        char const* const k_numbers[] =
+        {
+            "0", "-0.0", "1", "0.1", ".5", "5.", "-.625", "3.14159265358979323846", "1e10",
+            "1E-5", "2.2250738585072014e-308", "4.9e-324", "1.7976931348623157e308",
+            "123456789012345678901234567890", "0.000000000000000000000000000001",
+            "9007199254740993",
+            "1e22", "1e23", "8.98846567431158e307", "2.4703282292062328e-324",
+            "1.5e25", "-12345e30", "1e37", "90071992547409e24", "900719925474099e24",
+            "9007199254740993e23", "0e300",
+        };
+        for (char const* number : k_numbers)
+        {
+            INFO(number);
+            REQUIRE(ParseDouble(number, &d) == 1);
+            REQUIRE(d == strtod(number, nullptr));
+        }
+
+        // and a lot of random ones, kept small enough that none of them overflow
+        uint64_t state = 88172645463325252ull;
+        bool allMatch = true;
+        for (int n = 0; n < 20000; ++n)
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            char number[64];
+            snprintf(number, sizeof(number), "%llu.%llue%d", (unsigned long long)(state >> 20),
+                     (unsigned long long)(state & 0xfffff), (int)(state % 580) - 300);
+            allMatch = allMatch && (ParseDouble(number, &d) == 1) && (d == strtod(number, nullptr));
+        }
+        REQUIRE(allMatch);
+    }
+
+    SECTION( "Special values and ranges." )
+    {
+        REQUIRE(ParseDouble("inf", &d) == 1);
+        REQUIRE(d == HUGE_VAL);
+        REQUIRE(ParseDouble("-Infinity", &d) == 1);
+        REQUIRE(d == -HUGE_VAL);
+        REQUIRE(ParseDouble("NaN", &d) == 1);
+        REQUIRE(d != d);
+        REQUIRE(ParseDouble("1e400", &d) == -1);
+        REQUIRE(ParseDouble("1e-400", &d) == -1);
+        REQUIRE(ParseDouble("0e-400", &d) == 1);
+    }
+
+    SECTION( "Not doubles." )
+    {
+        REQUIRE(ParseDouble("", &d) == 0);
+        REQUIRE(ParseDouble(".", &d) == 0);
+        REQUIRE(ParseDouble("1e", &d) == 0);
+        REQUIRE(ParseDouble("1.2.3", &d) == 0);
+        REQUIRE(ParseDouble("infinite", &d) == 0);
+        REQUIRE(ParseDouble("0x10", &d) == 0);
+    }
+
+    SECTION( "Options." )
+    {
+        TestLogTarget tlt;
+        CommandLineProcessor clp = CL_Create();
+        int small;
+        float f;
+        int64_t big;
+        CL_AddIntegerOption(clp, &small, S("i"));
+        CL_AddFloatOption(clp, &f, S("f"));
+        CL_AddInt64Option(clp, &big, S("big"));
+        CL_AddDoubleOption(clp, &d, S("d"));
+
+        ARGS(S("app"), S("-i"), S("0x10"), S("-f"), S("0.1"), S("-big"), S("4G"),
+             S("-d"), S("2.5e-3"));
+        REQUIRE(CL_Parse(clp, num_args, args));
+        REQUIRE(small == 16);
+        REQUIRE(f == 0.1f);
+        REQUIRE(big == 4LL * 1024 * 1024 * 1024);
+        REQUIRE(d == 2.5e-3);
+
+        CL_StringType bad[] = { S("app"), S("-i"), S("3000000000"), S("-f"), S("1e39") };
+        REQUIRE(!CL_Parse(clp, 5, bad));
+        REQUIRE_THAT(tlt.pop(), Catch::Equals("'3000000000' is out of range for '-i'.\n"));
+        REQUIRE_THAT(tlt.pop(), Catch::Contains("can't be handled"));
+        REQUIRE_THAT(tlt.pop(), Catch::Equals("'1e39' is out of range for '-f'.\n"));
+        REQUIRE_THAT(tlt.pop(), Catch::Contains("can't be handled"));
+        CL_Destroy(clp);
+    }
+}
+
+/// Response file contents are ASCII in the tests, so narrowing wide characters is fine.
+static std::string Narrow(CL_StringType s)
+{
+    std::string narrow;
+    while (*s != 0)
+        narrow += (char)*s++;
+    return narrow;
+}
+
+static void WriteFile(char const* name, std::string const& contents)
+{
+    FILE* f = fopen(name, "wb");
+    REQUIRE(f != nullptr);
+    fwrite(contents.data(), 1, contents.size(), f);
+    fclose(f);
+}
+
+namespace
+{
+    /// A duration in milliseconds, given with a unit.
+    int ParseDuration(CL_StringType text, void* value, void*)
+    {
+        int64_t n = 0;
+        CL_StringType p = text;
+        while ((*p >= '0') && (*p <= '9'))
+            n = n * 10 + (*p++ - '0');
+        int64_t const scale = (Narrow(p) == "ms") ? 1 : (Narrow(p) == "s") ? 1000 :
+                              (Narrow(p) == "m") ? 60000 : 0;
+        if ((p == text) || (scale == 0))
+            return 0;
+        if (n * scale > INT_MAX)
+            return -1;
+        *(int*)value = (int)(n * scale);
+        return 1;
+    }
+
+    /// The position of the text in a null terminated table of names.
+    int ParseName(CL_StringType text, void* value, void* data)
+    {
+        CL_StringType const* names = (CL_StringType const*)data;
+        for (int i = 0; names[i] != nullptr; ++i)
+        {
+            if (Narrow(names[i]) == Narrow(text))
+            {
+                *(int*)value = i;
+                return 1;
+            }
+        }
+        return 0;
+    }
+}
+
+TEST_CASE( "Custom options" )
+{
+    TestLogTarget tlt;
+    CommandLineProcessor clp = CL_Create();
+
+    int timeout = 500;
+    int level = 1;
+    CL_StringType const k_levels[] = { S("low"), S("medium"), S("high"), nullptr };
+    CL_AddCustomOption(clp, &timeout, S("timeout"), ParseDuration, nullptr);
+    CL_AddCustomOption(clp, &level, S("level"), ParseName, (void*)k_levels);
+
+    SECTION( "Values are whatever the parser makes of them, and defaults are left alone." )
+    {
+        ARGS(S("app"), S("-level"), S("high"));
+        REQUIRE(CL_Parse(clp, num_args, args));
+        REQUIRE(timeout == 500);
+        REQUIRE(level == 2);
+
+        CL_StringType more[] = { S("app"), S("-timeout"), S("3s"), S("-timeout"), S("2m") };
+        REQUIRE(CL_Parse(clp, 5, more));
+        REQUIRE(timeout == 120000);
+    }
+
+    SECTION( "Errors are reported like those of numbers." )
+    {
+        CL_EnableOverflowArguments(clp);
+        ARGS(S("app"), S("-level"), S("extreme"), S("-timeout"), S("9999999m"));
+        REQUIRE(!CL_Parse(clp, num_args, args));
+        REQUIRE(tlt.pop() == "'extreme' is not a valid parameter to '-level'.\n");
+        REQUIRE(tlt.pop() == "'9999999m' is out of range for '-timeout'.\n");
+        REQUIRE(level == 1);
+    }
+
+    SECTION( "Their parsers move with the options as more are added." )
+    {
+        std::vector<std::basic_string<CL_CharType>> names;
+        for (int i = 0; i < 100; ++i)
+        {
+            std::string name = "t" + std::to_string(i);
+            names.emplace_back(name.begin(), name.end());
+        }
+        std::vector<int> timeouts(names.size());
+        for (size_t i = 0; i < names.size(); ++i)
+            CL_AddCustomOption(clp, &timeouts[i], names[i].c_str(), ParseDuration, nullptr);
+
+        ARGS(S("app"), S("-t0"), S("1s"), S("-t99"), S("5ms"), S("-level"), S("low"));
+        REQUIRE(CL_Parse(clp, num_args, args));
+        REQUIRE(timeouts[0] == 1000);
+        REQUIRE(timeouts[99] == 5);
+        REQUIRE(level == 0);
+    }
+
+    SECTION( "They can be part of a spec." )
+    {
+        struct Times { int timeout; int level; } prototype = { 50, 0 };
+        CommandLineProcessor spc = CL_Create();
+        CL_AddCustomOption(spc, &prototype.timeout, S("timeout"), ParseDuration, nullptr);
+        CL_Spec spec = CL_CreateSpec(spc, &prototype, sizeof(prototype));
+        CL_Destroy(spc);
+        REQUIRE(spec != nullptr);
+
+        Times times;
+        CL_ParseResult result;
+        ARGS(S("app"), S("-timeout"), S("7s"));
+        REQUIRE(CL_ParseInto(spec, &times, num_args, args, &result));
+        REQUIRE(times.timeout == 7000);
+        CL_DestroySpec(spec);
+    }
+
+    CL_Destroy(clp);
+    CHECK(!tlt.hasMessages());
+}
+
+TEST_CASE( "Response files" )
+{
+    TestLogTarget tlt;
+    CommandLineProcessor clp = CL_Create();
+    CL_EnableResponseFiles(clp);
+
+    int verbose;
+    CL_StringType name;
+    CL_StringType first;
+    CL_AddCountingOption(clp, &verbose, S("v"));
+    CL_AddStringOption(clp, &name, S("name"));
+    CL_AddArgument(clp, &first);
+    CL_EnableOverflowArguments(clp);
+
+    SECTION( "Arguments and options come from the file, in place." )
+    {
+        WriteFile("CommandLine_t.rsp", "one -v\n  \"two words\"\t-name \"say \\\"hi\\\"\"\nthree");
+        ARGS(S("app"), S("zero"), S("@CommandLine_t.rsp"), S("four"));
+        REQUIRE(CL_Parse(clp, num_args, args));
+        REQUIRE(Narrow(first) == "zero");
+        REQUIRE(verbose == 1);
+        REQUIRE(Narrow(name) == "say \"hi\"");
+
+        CL_StringType* overflow = CL_GetOverflowArguments(clp);
+        std::vector<std::string> rest;
+        for (; *overflow != nullptr; ++overflow)
+            rest.push_back(Narrow(*overflow));
+        REQUIRE(rest == std::vector<std::string>({ "one", "two words", "three", "four" }));
+    }
+
+    SECTION( "A token that ends the file on a page boundary still gets terminated." )
+    {
+        WriteFile("CommandLine_t.rsp", std::string(4093, ' ') + "end");
+        ARGS(S("app"), S("@CommandLine_t.rsp"));
+        REQUIRE(CL_Parse(clp, num_args, args));
+        REQUIRE(Narrow(first) == "end");
+    }
+
+    SECTION( "An option's parameter can come from after the file." )
+    {
+        WriteFile("CommandLine_t.rsp", "-name");
+        ARGS(S("app"), S("@CommandLine_t.rsp"), S("bob"));
+        REQUIRE(CL_Parse(clp, num_args, args));
+        REQUIRE(Narrow(name) == "bob");
+    }
+
+    SECTION( "An option's parameter is never a file, so '-name -' still means '-'." )
+    {
+        ARGS(S("app"), S("-name"), S("-"), S("x"));
+        REQUIRE(CL_Parse(clp, num_args, args));
+        REQUIRE(Narrow(name) == "-");
+        REQUIRE(Narrow(first) == "x");
+
+        CL_StringType args2[] = { S("app"), S("-name"), S("@CommandLine_t.rsp") };
+        REQUIRE(CL_Parse(clp, 3, args2));
+        REQUIRE(Narrow(name) == "@CommandLine_t.rsp");
+    }
+
+    SECTION( "A missing file is an error." )
+    {
+        ARGS(S("app"), S("@does-not-exist.rsp"));
+        REQUIRE(!CL_Parse(clp, num_args, args));
+        REQUIRE_THAT(tlt.pop(), Catch::StartsWith("Couldn't read the arguments"));
+    }
+
+    SECTION( "Overflow arguments can be streamed." )
+    {
+        WriteFile("CommandLine_t.rsp", "a b c d e f g");
+        std::vector<std::string> streamed;
+        CL_StreamOverflowArguments(clp, [](CL_StringType arg, void* data)
+        {
+            ((std::vector<std::string>*)data)->push_back(Narrow(arg));
+        }, &streamed);
+        ARGS(S("app"), S("@CommandLine_t.rsp"));
+        REQUIRE(CL_Parse(clp, num_args, args));
+        REQUIRE(Narrow(first) == "a");
+        REQUIRE(streamed == std::vector<std::string>({ "b", "c", "d", "e", "f", "g" }));
+        REQUIRE(CL_GetOverflowArguments(clp)[0] == nullptr);
+    }
+
+#ifndef _WIN32
+    SECTION( "'-' reads stdin." )
+    {
+        int fds[2];
+        REQUIRE(pipe(fds) == 0);
+        REQUIRE(write(fds[1], "from stdin\n", 11) == 11);
+        close(fds[1]);
+        int const savedStdin = dup(0);
+        dup2(fds[0], 0);
+        close(fds[0]);
+
+        ARGS(S("app"), S("-"));
+        int rv = CL_Parse(clp, num_args, args);
+
+        dup2(savedStdin, 0);
+        close(savedStdin);
+        clearerr(stdin);
+
+        REQUIRE(rv);
+        REQUIRE(Narrow(first) == "from");
+        REQUIRE(Narrow(CL_GetOverflowArguments(clp)[0]) == "stdin");
+    }
+#endif
+
+    CL_Destroy(clp);
+    remove("CommandLine_t.rsp");
+    CHECK(!tlt.hasMessages());
+}
+
+TEST_CASE( "Config files and the environment" )
+{
+    TestLogTarget tlt;
+    CommandLineProcessor clp = CL_Create();
+
+    int verbose = 0;
+    int jobs = 0;
+    double scale = 0;
+    CL_StringType name = nullptr;
+    int const* ids;
+    size_t numIds;
+    CL_AddCountingOption(clp, &verbose, S("v"));
+    CL_AddIntegerOption(clp, &jobs, S("max-jobs"));
+    CL_AddDoubleOption(clp, &scale, S("scale"));
+    CL_AddStringOption(clp, &name, S("name"));
+    CL_AddIntegerListOption(clp, &ids, &numIds, S("id"));
+    CL_EnableConfigFile(clp, S("CommandLine_t.cfg"), S("CommandLine_t.cfgc"));
+    remove("CommandLine_t.cfgc");
+
+    SECTION( "Settings come from the file, and the command line overrides them." )
+    {
+        WriteFile("CommandLine_t.cfg", "# comment\n; another\n\nv = yes\r\n  max-jobs= 4\n"
+                  "scale =2.5 \nname = \"  say \\\"hi\\\"  \"\nid = 1\nid = 2\n");
+        ARGS(S("app"), S("-max-jobs"), S("8"), S("-v"), S("-id"), S("3"));
+        REQUIRE(CL_Parse(clp, num_args, args));
+        REQUIRE(verbose == 2);
+        REQUIRE(jobs == 8);
+        REQUIRE(scale == 2.5);
+        REQUIRE(Narrow(name) == "  say \"hi\"  ");
+        REQUIRE(std::vector<int>(ids, ids + numIds) == std::vector<int>({ 1, 2, 3 }));
+    }
+
+    SECTION( "A missing file is no error, but a bad or unknown setting is." )
+    {
+        remove("CommandLine_t.cfg");
+        ARGS(S("app"));
+        REQUIRE(CL_Parse(clp, num_args, args));
+
+        CommandLineProcessor clp2 = CL_Create();
+        CL_AddIntegerOption(clp2, &jobs, S("max-jobs"));
+        CL_EnableConfigFile(clp2, S("CommandLine_t.cfg"), nullptr);
+        WriteFile("CommandLine_t.cfg", "max-jobs = many\njobs = 4\njust words\n");
+        REQUIRE(!CL_Parse(clp2, num_args, args));
+        REQUIRE_THAT(tlt.pop(), Catch::Contains("(3): expected 'name = value'."));
+        tlt.pop();
+        REQUIRE_THAT(tlt.pop(), Catch::Contains("(1): bad setting for 'max-jobs'."));
+        REQUIRE_THAT(tlt.pop(), Catch::Contains("(2): unknown option 'jobs'."));
+        CL_Destroy(clp2);
+    }
+
+#ifndef _WIN32
+    SECTION( "The environment overrides the file." )
+    {
+        WriteFile("CommandLine_t.cfg", "max-jobs = 4\nscale = 1.5\nv = 3\n");
+        setenv("CLTEST_MAX_JOBS", "6", 1);
+        setenv("CLTEST_V", "off", 1);
+        CL_EnableEnvironment(clp, S("CLTEST_"));
+        ARGS(S("app"));
+        int const rv = CL_Parse(clp, num_args, args);
+        unsetenv("CLTEST_MAX_JOBS");
+        unsetenv("CLTEST_V");
+        REQUIRE(rv);
+        REQUIRE(jobs == 6);
+        REQUIRE(scale == 1.5);
+        REQUIRE(verbose == 0);
+    }
+
+    SECTION( "Parsing again doesn't copy the environment again." )
+    {
+        remove("CommandLine_t.cfg");
+        setenv("CLTEST_NAME", "from the environment", 1);
+        CL_EnableEnvironment(clp, S("CLTEST_"));
+        ARGS(S("app"));
+        REQUIRE(CL_Parse(clp, num_args, args));
+        CL_StringType const first = name;
+        REQUIRE(CL_Parse(clp, num_args, args));
+        unsetenv("CLTEST_NAME");
+        REQUIRE(Narrow(name) == "from the environment");
+        REQUIRE(name == first);
+    }
+
+    SECTION( "The cache is used while the file's unchanged, and only if it's intact." )
+    {
+        WriteFile("CommandLine_t.cfg", "max-jobs = 1\nname = first\n");
+        ARGS(S("app"));
+        REQUIRE(CL_Parse(clp, num_args, args));
+        REQUIRE(jobs == 1);
+        FILE* cache = fopen("CommandLine_t.cfgc", "rb");
+        REQUIRE(cache != nullptr);
+        fclose(cache);
+
+        CommandLineProcessor clp2 = CL_Create();
+        CL_AddIntegerOption(clp2, &jobs, S("max-jobs"));
+        CL_AddStringOption(clp2, &name, S("name"));
+        CL_EnableConfigFile(clp2, S("CommandLine_t.cfg"), S("CommandLine_t.cfgc"));
+        REQUIRE(CL_Parse(clp2, num_args, args));
+        REQUIRE(jobs == 1);
+        REQUIRE(Narrow(name) == "first");
+        CL_Destroy(clp2);
+
+        // the same size and time, which the cache isn't fooled by
+        struct utimbuf times = { 1000000000, 1000000000 };
+        REQUIRE(utime("CommandLine_t.cfg", &times) == 0);
+        WriteFile("CommandLine_t.cfg", "max-jobs = 2\nname = first\n");
+        REQUIRE(utime("CommandLine_t.cfg", &times) == 0);
+        clp2 = CL_Create();
+        CL_AddIntegerOption(clp2, &jobs, S("max-jobs"));
+        CL_AddStringOption(clp2, &name, S("name"));
+        CL_EnableConfigFile(clp2, S("CommandLine_t.cfg"), S("CommandLine_t.cfgc"));
+        REQUIRE(CL_Parse(clp2, num_args, args));
+        REQUIRE(jobs == 2);
+        REQUIRE(Narrow(name) == "first");
+        CL_Destroy(clp2);
+
+        // a damaged cache is ignored
+        FILE* f = fopen("CommandLine_t.cfgc", "r+b");
+        REQUIRE(f != nullptr);
+        fseek(f, -2, SEEK_END);
+        fputc('x', f);
+        fclose(f);
+        clp2 = CL_Create();
+        CL_AddIntegerOption(clp2, &jobs, S("max-jobs"));
+        CL_AddStringOption(clp2, &name, S("name"));
+        CL_EnableConfigFile(clp2, S("CommandLine_t.cfg"), S("CommandLine_t.cfgc"));
+        REQUIRE(CL_Parse(clp2, num_args, args));
+        REQUIRE(jobs == 2);
+        CL_Destroy(clp2);
+    }
+#endif
+
+    SECTION( "A subcommand's options are set once it's chosen." )
+    {
+        WriteFile("CommandLine_t.cfg", "max-jobs = 3\nlevel = 7\n");
+        static int level;
+        level = 0;
+        CL_AddSubcommand(clp, S("build"), [](CommandLineProcessor p, void*)
+        {
+            CL_AddIntegerOption(p, &level, S("level"));
+        }, nullptr);
+        ARGS(S("app"), S("build"));
+        REQUIRE(CL_Parse(clp, num_args, args));
+        REQUIRE(jobs == 3);
+        REQUIRE(level == 7);
+    }
+
+    CL_Destroy(clp);
+    remove("CommandLine_t.cfg");
+    remove("CommandLine_t.cfgc");
+    CHECK(!tlt.hasMessages());
+}
+
+#ifndef _WIN32
+TEST_CASE( "Glob expansion" )
+{
+    TestLogTarget tlt;
+    char const* const k_dirs[] = { "CommandLine_t.glob", "CommandLine_t.glob/a",
+                                   "CommandLine_t.glob/a/b", "CommandLine_t.glob/a/.hidden",
+                                   "CommandLine_t.glob/c" };
+    char const* const k_files[] = { "CommandLine_t.glob/one.bin", "CommandLine_t.glob/two.txt",
+                                    "CommandLine_t.glob/a/three.bin",
+                                    "CommandLine_t.glob/a/b/4.bin",
+                                    "CommandLine_t.glob/a/.hidden/5.bin",
+                                    "CommandLine_t.glob/c/six.bin", "CommandLine_t.glob/.7.bin",
+                                    "CommandLine_t.glob/x[" };
+    for (char const* d : k_dirs)
+        mkdir(d, 0755);
+    for (char const* f : k_files)
+        WriteFile(f, "");
+
+    CommandLineProcessor clp = CL_Create();
+    CL_EnableGlobExpansion(clp);
+    CL_EnableOverflowArguments(clp);
+    auto expand = [clp](CL_StringType pattern)
+    {
+        CL_StringType args[] = { S("app"), pattern };
+        REQUIRE(CL_Parse(clp, 2, args));
+        std::vector<std::string> paths;
+        for (CL_StringType* p = CL_GetOverflowArguments(clp); *p != nullptr; ++p)
+            paths.push_back(Narrow(*p));
+        return paths;
+    };
+
+    SECTION( "Wildcards in the last part match files, in order, but not hidden ones." )
+    {
+        REQUIRE(expand(S("CommandLine_t.glob/*.bin")) ==
+                std::vector<std::string>({ "CommandLine_t.glob/one.bin" }));
+        REQUIRE(expand(S("CommandLine_t.glob/[a-s]*")) ==
+                std::vector<std::string>({ "CommandLine_t.glob/a", "CommandLine_t.glob/c",
+                                           "CommandLine_t.glob/one.bin" }));
+        REQUIRE(expand(S("CommandLine_t.glob/t?o.[!b]*")) ==
+                std::vector<std::string>({ "CommandLine_t.glob/two.txt" }));
+        REQUIRE(expand(S("CommandLine_t.glob/.*")) ==
+                std::vector<std::string>({ "CommandLine_t.glob/.7.bin" }));
+    }
+
+    SECTION( "Wildcards can be in any part, and \"**\" is any number of directories." )
+    {
+        REQUIRE(expand(S("CommandLine_t.gl*/*/six.bin")) ==
+                std::vector<std::string>({ "CommandLine_t.glob/c/six.bin" }));
+        REQUIRE(expand(S("CommandLine_t.glob/**/*.bin")) ==
+                std::vector<std::string>({ "CommandLine_t.glob/a/b/4.bin",
+                                           "CommandLine_t.glob/a/three.bin",
+                                           "CommandLine_t.glob/c/six.bin",
+                                           "CommandLine_t.glob/one.bin" }));
+        REQUIRE(expand(S("CommandLine_t.glob/**/b/**")) ==
+                std::vector<std::string>({ "CommandLine_t.glob/a/b/4.bin" }));
+    }
+
+    SECTION( "A pattern that matches nothing is left alone, as are arguments without wildcards." )
+    {
+        REQUIRE(expand(S("CommandLine_t.glob/*.none")) ==
+                std::vector<std::string>({ "CommandLine_t.glob/*.none" }));
+        REQUIRE(expand(S("CommandLine_t.glob/nothing")) ==
+                std::vector<std::string>({ "CommandLine_t.glob/nothing" }));
+    }
+
+    SECTION( "A '[' that isn't closed is just a '['." )
+    {
+        REQUIRE(expand(S("CommandLine_t.glob/*[")) ==
+                std::vector<std::string>({ "CommandLine_t.glob/x[" }));
+        REQUIRE(expand(S("CommandLine_t.glob/x[!")) ==
+                std::vector<std::string>({ "CommandLine_t.glob/x[!" }));
+        // nor does it reach past the '/' for a ']'
+        REQUIRE(expand(S("CommandLine_t.glob/[/x]")) ==
+                std::vector<std::string>({ "CommandLine_t.glob/[/x]" }));
+    }
+
+    SECTION( "Matches are streamed if the overflow is." )
+    {
+        std::vector<std::string> streamed;
+        CL_StreamOverflowArguments(clp, [](CL_StringType arg, void* data)
+        {
+            ((std::vector<std::string>*)data)->push_back(Narrow(arg));
+        }, &streamed);
+        ARGS(S("app"), S("first"), S("CommandLine_t.glob/*/*.bin"));
+        REQUIRE(CL_Parse(clp, num_args, args));
+        REQUIRE(streamed == std::vector<std::string>({ "first", "CommandLine_t.glob/a/three.bin",
+                                                       "CommandLine_t.glob/c/six.bin" }));
+    }
+
+    CL_Destroy(clp);
+
+    SECTION( "Patterns aren't expanded unless that's enabled." )
+    {
+        clp = CL_Create();
+        CL_EnableOverflowArguments(clp);
+        ARGS(S("app"), S("CommandLine_t.glob/*.bin"));
+        REQUIRE(CL_Parse(clp, num_args, args));
+        REQUIRE(Narrow(CL_GetOverflowArguments(clp)[0]) == "CommandLine_t.glob/*.bin");
+        CL_Destroy(clp);
+    }
+
+    for (char const* f : k_files)
+        remove(f);
+    for (size_t i = sizeof(k_dirs) / sizeof(k_dirs[0]); i-- > 0; )
+        rmdir(k_dirs[i]);
+    CHECK(!tlt.hasMessages());
+}
+#endif
+
+namespace
+{
+    struct Settings
+    {
+        int verbose;
+        int count;
+        double scale;
+        CL_StringType input;
+    };
+}
+
+TEST_CASE( "Specs" )
+{
+    TestLogTarget tlt;
+    CommandLineProcessor clp = CL_Create();
+    Settings prototype;
+    CL_AddCountingOption(clp, &prototype.verbose, S("v"));
+    CL_AddIntegerOption(clp, &prototype.count, S("count"));
+    CL_AddDoubleOption(clp, &prototype.scale, S("scale"));
+    CL_AddArgument(clp, &prototype.input);
+
+    SECTION( "Parses into each struct, starting from the prototype's values." )
+    {
+        CL_EnableOverflowArguments(clp);
+        prototype.scale = 1.0;
+        CL_Spec spec = CL_CreateSpec(clp, &prototype, sizeof(prototype));
+        REQUIRE(spec != NULL);
+        CL_Destroy(clp);
+        clp = NULL;
+
+        Settings a, b;
+        CL_ParseResult result;
+        ARGS(S("app"), S("-v"), S("in"), S("-count"), S("3"), S("more"), S("-v"));
+        REQUIRE(CL_ParseInto(spec, &a, num_args, args, &result));
+        REQUIRE(a.verbose == 2);
+        REQUIRE(a.count == 3);
+        REQUIRE(a.scale == 1.0);
+        REQUIRE(a.input == args[2]);
+        REQUIRE(result.numOverflow == 1);
+        REQUIRE(result.overflow[0] == args[5]);
+
+        CL_StringType bad[] = { S("app"), S("-scale"), S("x") };
+        REQUIRE(!CL_ParseInto(spec, &b, 3, bad, &result));
+        REQUIRE_THAT(tlt.pop(), Catch::StartsWith("'x' is not a valid parameter"));
+        REQUIRE(result.numErrors == 1);
+        REQUIRE(b.verbose == 0);
+        REQUIRE(b.scale == 1.0);
+        REQUIRE(b.input == bad[2]);
+
+        CL_DestroySpec(spec);
+    }
+
+    SECTION( "Many threads can share a spec." )
+    {
+        CL_Spec spec = CL_CreateSpec(clp, &prototype, sizeof(prototype));
+        REQUIRE(spec != NULL);
+
+        bool ok[4] = {};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t)
+        {
+            threads.emplace_back([spec, t, &ok]
+            {
+                std::basic_string<CL_CharType> count(1, (CL_CharType)('0' + t));
+                bool allRight = true;
+                for (int i = 0; i < 10000; ++i)
+                {
+                    CL_StringType args[] = { S("app"), S("-count"), count.c_str(), S("-v") };
+                    Settings s;
+                    CL_ParseResult result;
+                    allRight = allRight && CL_ParseInto(spec, &s, 4, args, &result) &&
+                               (s.count == t) && (s.verbose == 1) && (s.input == NULL);
+                }
+                ok[t] = allRight;
+            });
+        }
+        for (std::thread& thread : threads)
+            thread.join();
+        REQUIRE(ok[0]);
+        REQUIRE(ok[1]);
+        REQUIRE(ok[2]);
+        REQUIRE(ok[3]);
+
+        CL_DestroySpec(spec);
+    }
+
+    SECTION( "Everything has to be in the struct." )
+    {
+        int elsewhere;
+        CL_AddCountingOption(clp, &elsewhere, S("q"));
+        REQUIRE(CL_CreateSpec(clp, &prototype, sizeof(prototype)) == NULL);
+        REQUIRE_THAT(tlt.pop(), Catch::StartsWith("Option 'q' isn't bound"));
+    }
+
+    SECTION( "Lists can't be in specs." )
+    {
+        int const* values;
+        size_t count;
+        CL_AddIntegerListOption(clp, &values, &count, S("n"));
+        REQUIRE(CL_CreateSpec(clp, &prototype, sizeof(prototype)) == NULL);
+        REQUIRE_THAT(tlt.pop(), Catch::StartsWith("List option 'n' can't be"));
+    }
+
+    SECTION( "Nor can wildcards, which need storage for what they match." )
+    {
+        CL_EnableGlobExpansion(clp);
+        REQUIRE(CL_CreateSpec(clp, &prototype, sizeof(prototype)) == NULL);
+        REQUIRE_THAT(tlt.pop(), Catch::StartsWith("Glob expansion can't be used"));
+    }
+
+    if (clp != NULL)
+        CL_Destroy(clp);
+    CHECK(!tlt.hasMessages());
+}
+
+namespace
+{
+    enum class Color { red, green, blue };
+
+    struct Range
+    {
+        int low, high;
+    };
+
+    /// Parses "low..high" within limits that are set at run time.
+    struct RangeParser
+    {
+        int limit;
+
+        int operator()(CL_StringType text, Range& range) const
+        {
+            int64_t low, high;
+            if ((sscanf(Narrow(text).c_str(), "%" SCNd64 "..%" SCNd64, &low, &high) != 2) ||
+                (low > high))
+            {
+                return 0;
+            }
+            if ((low < -limit) || (high > limit))
+                return -1;
+            range.low = (int)low;
+            range.high = (int)high;
+            return 1;
+        }
+    };
+}
+
+template <>
+struct CommandLineParser<Color>
+{
+    static bool Parse(CL_StringType text, Color& color)
+    {
+        std::string const t = Narrow(text);
+        if ((t != "red") && (t != "green") && (t != "blue"))
+            return false;
+        color = (t == "red") ? Color::red : (t == "green") ? Color::green : Color::blue;
+        return true;
+    }
+};
+
 TEST_CASE( "C++ API" )
 {
     TestLogTarget tlt;
     CommandLine cl;
 
+    SECTION( "Options of any type." )
+    {
+        Color color = Color::green;
+        Range range = { 0, 0 };
+        RangeParser const parser = { 100 };
+        int number;
+        double fraction;
+        cl.AddOption(&color, S("color"));
+        cl.AddOption(&range, S("range"), &parser);
+        cl.AddOption(&number, S("number"));
+        cl.AddOption(&fraction, S("fraction"));
+
+        ARGS(S("app"), S("-color"), S("blue"), S("-range"), S("-5..10"), S("-number"), S("0x20"),
+             S("-fraction"), S("0.5"));
+        REQUIRE(cl.Parse(num_args, args));
+        REQUIRE(color == Color::blue);
+        REQUIRE(range.low == -5);
+        REQUIRE(range.high == 10);
+        REQUIRE(number == 32);
+        REQUIRE(fraction == 0.5);
+
+        CL_StringType bad[] = { S("app"), S("-color"), S("mauve"), S("-range"), S("1..1000") };
+        REQUIRE(!cl.Parse(5, bad));
+        REQUIRE_THAT(tlt.pop(), Catch::Contains("is not a valid parameter to '-color'"));
+        REQUIRE_THAT(tlt.pop(), Catch::Contains("can't be handled"));
+        REQUIRE_THAT(tlt.pop(), Catch::Contains("is out of range for '-range'"));
+        REQUIRE_THAT(tlt.pop(), Catch::Contains("can't be handled"));
+        REQUIRE(color == Color::blue);
+        REQUIRE(range.high == 10);
+    }
+
     SECTION( "Application name gets set." )
     {
         ARGS( S("testapp") );
@@ -438,6 +1610,45 @@ TEST_CASE( "C++ API" )
         }
     }
 
+    SECTION( "Subcommands" )
+    {
+        int force = 0;
+        int added = 0;
+        cl.AddSubcommand(S("push"), [&](CommandLine& c)
+        {
+            ++added;
+            c.AddCountingOption(&force, S("f"));
+        });
+        cl.AddSubcommand(S("pull"), [&](CommandLine&) { ++added; });
+
+        ARGS(S("app"), S("push"), S("-f"));
+        REQUIRE(cl.Parse(num_args, args));
+        REQUIRE(cl.GetSubcommand() == args[1]);
+        REQUIRE(force == 1);
+        REQUIRE(added == 1);
+    }
+
+    SECTION( "List options" )
+    {
+        CommandLineList<CL_StringType> includes;
+        CommandLineList<float> scales;
+        cl.AddStringListOption(&includes, S("I"));
+        cl.AddFloatListOption(&scales, S("scale"));
+
+        ARGS(S("app"), S("-I"), S("a"), S("-scale"), S("2"), S("-I"), S("b"));
+        REQUIRE(cl.Parse(num_args, args));
+        REQUIRE(includes.size() == 2);
+        REQUIRE(includes.front() == args[2]);
+        REQUIRE(includes.back() == args[6]);
+        std::vector<CL_StringType> copy = includes;
+        REQUIRE(copy == std::vector<CL_StringType>({ args[2], args[6] }));
+
+        float total = 0;
+        for (float f : scales)
+            total += f;
+        REQUIRE(total == 2.0f);
+    }
+
     SECTION( "Normal arguments" )
     {
         CL_StringType a, b;
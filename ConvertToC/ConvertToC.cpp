@@ -28,21 +28,73 @@
  * Licensed under the MIT/X license. Do with these files what you will but leave this header intact.
  */
 
-#include "CommandLine/CommandLine.hpp"
-#include "Log/StdStreamLogTarget.hpp"
+#include "CommandLine/CommandLineSpec.hpp"
+#include "Log/FdLogTarget.hpp"
 
 #include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
-#include <map>
 #include <sstream>
 #include <vector>
 
+// Numbers in arrays are made sixteen or thirty-two bytes at a time with SSE2 or AVX2 where the
+// compiler has them; AVX2 is only used if the CPU running the program has it too.
+#if !defined(CONVERT_TO_C_SSE2)
+ #if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || \
+     (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+  #define CONVERT_TO_C_SSE2 1
+ #else
+  #define CONVERT_TO_C_SSE2 0
+ #endif
+#endif
+
+#if !defined(CONVERT_TO_C_AVX2)
+ #if CONVERT_TO_C_SSE2 && (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+  #define CONVERT_TO_C_AVX2 1
+ #else
+  #define CONVERT_TO_C_AVX2 0
+ #endif
+#endif
+
+#if CONVERT_TO_C_SSE2
+ #include <emmintrin.h>
+#endif
+#if CONVERT_TO_C_AVX2
+ #include <immintrin.h>
+ #if defined(_MSC_VER)
+  #include <intrin.h>
+  #define AVX2_FUNCTION
+ #else
+  #define AVX2_FUNCTION __attribute__((target("avx2")))
+ #endif
+#endif
+
 // Visual Studio supports strings up to about 16k IIRC. Other compilers may have different limits.
 static int const MAX_STRING_LENGTH = 15000;
 
-std::map<char, std::string> CHARACTER_TRANSLATIONS;
+/// What a byte becomes. None is longer than eight characters, and the rest of the eight are spaces,
+/// so an array's values can be written a whole eight characters at a time.
+struct Translation
+{
+    char text[8];
+    size_t length;
+};
+
+Translation CHARACTER_TRANSLATIONS[256];
+
+void SetTranslation(int c, std::string const& text)
+{
+    Translation& t = CHARACTER_TRANSLATIONS[(uint8_t)c];
+    memset(t.text, ' ', sizeof(t.text));
+    memcpy(t.text, text.data(), text.size());
+    t.length = text.size();
+}
+
 enum ExportType
 {
     AS_STRING,
@@ -60,21 +112,21 @@ void GenerateTranslations(ExportType style, bool asHex=false)
         {
             std::ostringstream oss;
             oss << "\\x" << std::setw(2) << std::setfill('0') << std::hex << i;
-            CHARACTER_TRANSLATIONS[i] = oss.str();
+            SetTranslation(i, oss.str());
         }
 
         // but translate the letters and numbers and punctuation to themselves
         for (char i = 32; i < 127; ++i)
-            CHARACTER_TRANSLATIONS[i] = std::string(1, i);
+            SetTranslation(i, std::string(1, i));
 
         // and then handle these characters specially.
-        CHARACTER_TRANSLATIONS[' '] = " ";
-        CHARACTER_TRANSLATIONS['"'] = "\\\"";
-        CHARACTER_TRANSLATIONS['\\'] = "\\\\";
-        CHARACTER_TRANSLATIONS['\n'] = "\\n";
-        CHARACTER_TRANSLATIONS['\r'] = "\\r";
-        CHARACTER_TRANSLATIONS['\t'] = "\\t";
-        CHARACTER_TRANSLATIONS['\0'] = "\\0";
+        SetTranslation(' ', " ");
+        SetTranslation('"', "\\\"");
+        SetTranslation('\\', "\\\\");
+        SetTranslation('\n', "\\n");
+        SetTranslation('\r', "\\r");
+        SetTranslation('\t', "\\t");
+        SetTranslation('\0', "\\0");
     }
     else
     {
@@ -85,7 +137,7 @@ void GenerateTranslations(ExportType style, bool asHex=false)
             {
                 std::ostringstream oss;
                 oss << "\\x" << std::setw(2) << std::setfill('0') << std::hex << i << ',';
-                CHARACTER_TRANSLATIONS[i] = oss.str();
+                SetTranslation(i, oss.str());
             }
         }
         else if (asHex)
@@ -94,7 +146,7 @@ void GenerateTranslations(ExportType style, bool asHex=false)
             {
                 std::ostringstream oss;
                 oss << "0x" << std::setw(2) << std::setfill('0') << std::hex << i << ',';
-                CHARACTER_TRANSLATIONS[i] = oss.str();
+                SetTranslation(i, oss.str());
             }
         }
         else if (style == AS_NUMBERS)
@@ -103,7 +155,7 @@ void GenerateTranslations(ExportType style, bool asHex=false)
             {
                 std::ostringstream oss;
                 oss << std::setw(3) << i << ',';
-                CHARACTER_TRANSLATIONS[i] = oss.str();
+                SetTranslation(i, oss.str());
             }
         }
         else // NUMBERS_AND_CHARS !asHex
@@ -112,7 +164,7 @@ void GenerateTranslations(ExportType style, bool asHex=false)
             {
                 std::ostringstream oss;
                 oss << std::setw(4) << i << ',';
-                CHARACTER_TRANSLATIONS[i] = oss.str();
+                SetTranslation(i, oss.str());
             }
         }
 
@@ -123,18 +175,18 @@ void GenerateTranslations(ExportType style, bool asHex=false)
             {
                 std::ostringstream oss;
                 oss << " '" << c << "',";
-                CHARACTER_TRANSLATIONS[c] = oss.str();
+                SetTranslation(c, oss.str());
             }
 
             // and then handle these characters specially.
-            CHARACTER_TRANSLATIONS[' '] = " ' ',";
-            CHARACTER_TRANSLATIONS['"'] = " '\"',";
-            CHARACTER_TRANSLATIONS['\''] = "'\\'',";
-            CHARACTER_TRANSLATIONS['\\'] = "'\\\\',";
-            CHARACTER_TRANSLATIONS['\n'] = "'\\n',";
-            CHARACTER_TRANSLATIONS['\r'] = "'\\r',";
-            CHARACTER_TRANSLATIONS['\t'] = "'\\t',";
-            CHARACTER_TRANSLATIONS['\0'] = "'\\0',";
+            SetTranslation(' ', " ' ',");
+            SetTranslation('"', " '\"',");
+            SetTranslation('\'', "'\\'',");
+            SetTranslation('\\', "'\\\\',");
+            SetTranslation('\n', "'\\n',");
+            SetTranslation('\r', "'\\r',");
+            SetTranslation('\t', "'\\t',");
+            SetTranslation('\0', "'\\0',");
         }
     }
 }
@@ -148,58 +200,71 @@ std::string DefaultDataName(std::string name)
     return "k_" + name;
 }
 
-std::string FormatAsString(std::string const& data, std::string const& dataName)
+/**
+ * Writes data as the contents of a string literal, a chunk at a time, so that nothing more than a
+ * line of output is held in memory however big the data is. Lines are broken after newlines in
+ * text and otherwise kept to a readable length.
+ */
+class StringFormatter
 {
-    std::vector<std::string> output;
-    std::string currentLine;
-    size_t startOfAscii = std::string::npos;
-    for (int8_t c : data)
+public:
+    explicit StringFormatter(std::ostream& out) : out(out), startOfAscii(std::string::npos),
+                                                  wroteLine(false) {}
+
+    void Add(char const* data, size_t size)
     {
-        if ((c != '\n') && (c != '\r'))
+        for (size_t i = 0; i < size; ++i)
         {
-            if ((c == '\t') || ((c >= 32) && (c < 127)))
+            int8_t const c = data[i];
+            if ((c != '\n') && (c != '\r'))
             {
-                if (startOfAscii == std::string::npos)
-                    startOfAscii = currentLine.length();
+                if ((c == '\t') || ((c >= 32) && (c < 127)))
+                {
+                    if (startOfAscii == std::string::npos)
+                        startOfAscii = currentLine.length();
+                }
+                else
+                    startOfAscii = std::string::npos;
             }
-            else
-                startOfAscii = std::string::npos;
-        }
 
-        currentLine.append(CHARACTER_TRANSLATIONS[c]);
-        if (((startOfAscii != 0) && (currentLine.size() > 90)) || (currentLine.size() > 140))
-        {
-            if ((startOfAscii == 0) || (startOfAscii == std::string::npos))
+            Translation const& t = CHARACTER_TRANSLATIONS[(uint8_t)c];
+            currentLine.append(t.text, t.length);
+            if (((startOfAscii != 0) && (currentLine.size() > 90)) || (currentLine.size() > 140))
             {
-                output.push_back(currentLine);
-                currentLine.erase();
-                startOfAscii = std::string::npos;
+                if ((startOfAscii == 0) || (startOfAscii == std::string::npos))
+                {
+                    WriteLine(currentLine);
+                    currentLine.erase();
+                    startOfAscii = std::string::npos;
+                }
+                else
+                {
+                    WriteLine(currentLine.substr(0, startOfAscii));
+                    currentLine.erase(0, startOfAscii);
+                    startOfAscii = 0;
+                }
             }
-            else
+
+            if ((startOfAscii == 0) && (c == '\n'))
             {
-                output.push_back(currentLine.substr(0, startOfAscii));
-                currentLine.erase(0, startOfAscii);
-                startOfAscii = 0;
+                WriteLine(currentLine);
+                currentLine.erase();
             }
         }
-
-        if ((startOfAscii == 0) && (c == '\n'))
-        {
-            output.push_back(currentLine);
-            currentLine.erase();
-        }
     }
-    if (!currentLine.empty())
-        output.push_back(currentLine);
 
-    std::ostringstream oss;
+    void Finish()
+    {
+        if (!currentLine.empty() || !wroteLine)
+            WriteLine(currentLine);
+        out << "\";" << '\n';
+    }
 
-    for (std::string& line : output)
+private:
+    void WriteLine(std::string line)
     {
-        if (oss.str().empty())
-            oss << "\t\"";
-        else
-            oss << "\"\n\t\"";
+        out << (wroteLine ? "\"\n\t\"" : "\t\"");
+        wroteLine = true;
 
         // Substitute pairs of question marks to avoid errant trigraph interpretation by the
         // compiler. See http://en.wikipedia.org/wiki/Digraphs_and_trigraphs
@@ -212,46 +277,377 @@ std::string FormatAsString(std::string const& data, std::string const& dataName)
             match = line.find("??", match+1);
         }
 
-        oss << line;
+        out << line;
+    }
+
+    std::ostream& out;
+    std::string currentLine;
+    size_t startOfAscii;
+    bool wroteLine;
+};
+
+/**
+ * Row encoders write whole lines of an array initializer, a tab and then the values of sixteen
+ * bytes each followed by a space, the last by a newline instead. The lines go one right after
+ * another, and up to eight characters past the end of the last one may be written over.
+ */
+typedef void (*RowEncoder)(uint8_t const* in, size_t numRows, char* out);
+
+/// A value and the space after it, which is the same length for every byte in the array formats.
+size_t CellLength()
+{
+    return CHARACTER_TRANSLATIONS[0].length + 1;
+}
+
+/// Any of the array formats, a value at a time: each is copied from the table spaces and all.
+void EncodeRowsWithTable(uint8_t const* in, size_t numRows, char* out)
+{
+    size_t const cellLength = CellLength();
+    for (size_t row = 0; row < numRows; ++row)
+    {
+        *out++ = '\t';
+        for (int i = 0; i < 16; ++i, out += cellLength)
+            memcpy(out, CHARACTER_TRANSLATIONS[*in++].text, 8);
+        out[-1] = '\n';
+    }
+}
+
+#if CONVERT_TO_C_SSE2
+/**
+ * Writes a line of sixteen values, each made of the characters in one byte of \c c0 to \c c3 and
+ * then the four in \c tail. Each value's eight characters are put together in half a register and
+ * stored at once, over the ones past the end of the value before it.
+ */
+template <size_t CellLength>
+static inline void StoreRow(__m128i c0, __m128i c1, __m128i c2, __m128i c3, __m128i tail,
+                            char* out)
+{
+    __m128i const low01 = _mm_unpacklo_epi8(c0, c1), high01 = _mm_unpackhi_epi8(c0, c1);
+    __m128i const low23 = _mm_unpacklo_epi8(c2, c3), high23 = _mm_unpackhi_epi8(c2, c3);
+    __m128i const heads[4] =
+    {
+        _mm_unpacklo_epi16(low01, low23), _mm_unpackhi_epi16(low01, low23),
+        _mm_unpacklo_epi16(high01, high23), _mm_unpackhi_epi16(high01, high23),
+    };
+
+    *out++ = '\t';
+    for (int i = 0; i < 4; ++i)
+    {
+        __m128i const cells[2] =
+            { _mm_unpacklo_epi32(heads[i], tail), _mm_unpackhi_epi32(heads[i], tail) };
+        for (int j = 0; j < 2; ++j)
+        {
+            _mm_storel_epi64((__m128i*)out, cells[j]);
+            _mm_storeh_pi((__m64*)(out + CellLength), _mm_castsi128_ps(cells[j]));
+            out += 2 * CellLength;
+        }
     }
+    out[-1] = '\n';
+}
 
-    oss << "\";" << std::endl;
-    return oss.str();
+/// Lower case hexadecimal digits for values from 0 to 15.
+static inline __m128i HexDigits(__m128i nibbles)
+{
+    __m128i const letters = _mm_and_si128(_mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9)),
+                                          _mm_set1_epi8('a' - '0' - 10));
+    return _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), letters);
 }
 
-std::string FormatAsData(std::string data, std::string const& dataName)
+/// "0x%02x," for AS_NUMBERS with asHex and "\x%02x," for AS_CHARS.
+template <char First, char Second>
+static void EncodeHexRowsSse2(uint8_t const* in, size_t numRows, char* out)
+{
+    __m128i const nibble = _mm_set1_epi8(0x0f);
+    for (size_t row = 0; row < numRows; ++row, in += 16, out += 1 + 16 * 6)
+    {
+        __m128i const bytes = _mm_loadu_si128((__m128i const*)in);
+        __m128i const high = HexDigits(_mm_and_si128(_mm_srli_epi16(bytes, 4), nibble));
+        __m128i const low = HexDigits(_mm_and_si128(bytes, nibble));
+        StoreRow<6>(_mm_set1_epi8(First), _mm_set1_epi8(Second), high, low,
+                    _mm_set1_epi16((' ' << 8) | ','), out);
+    }
+}
+#endif // CONVERT_TO_C_SSE2
+
+#if CONVERT_TO_C_AVX2
+/**
+ * Where each character of a line of sixteen values comes from, for building the line sixteen
+ * characters at a time: shuffle controls that spread the digits of the sixteen bytes, given a
+ * vector per digit, out to their places, and the characters that are the same on every line. A
+ * value's cell has a digit's number (0 to 2) where that digit goes and the character elsewhere.
+ */
+struct RowLayout
 {
-    std::vector<std::string> output { "{" };
+    RowLayout(char const* cell, size_t cellLength)
+    {
+        memset(select, 0x80, sizeof(select));
+        memset(fixed, 0, sizeof(fixed));
+        for (size_t p = 0; p < 16 * cellLength; ++p)
+        {
+            char const c = cell[p % cellLength];
+            if ((uint8_t)c < 3)
+                select[p / 16][(size_t)c][p % 16] = (uint8_t)(p / cellLength);
+            else
+                fixed[p / 16][p % 16] = c;
+        }
+    }
 
-    // put a NULL at the end in case the string is used as a string; it doesn't
-    // count into the length that we printed before though.
-    data.push_back('\0');
+    alignas(16) uint8_t select[6][3][16];
+    alignas(16) char fixed[6][16];
+};
 
-    size_t dataLen = data.size();
-    size_t current = 0;
-    while (current < dataLen)
+/**
+ * Writes two lines from vectors of the digits of 32 bytes. AVX2 shuffles the two halves of a
+ * register separately, so it's natural for each half to make one line.
+ */
+template <size_t Digits, size_t CellLength>
+AVX2_FUNCTION static inline void StoreRows(RowLayout const& layout, __m256i const* digits,
+                                           char* out)
+{
+    size_t const rowLength = 1 + 16 * CellLength;
+    for (size_t k = 0; k < CellLength; ++k)
     {
-        std::ostringstream oss;
-        if ((current % 1024) == 0)
-            oss << "\t/* byte " << current << " */" << std::endl;
-        oss << "\t";
-        for (int i = 0; (i < 16) && ((current + i) < dataLen); ++i)
+        __m256i block = _mm256_broadcastsi128_si256(
+            _mm_load_si128((__m128i const*)layout.fixed[k]));
+        for (size_t d = 0; d < Digits; ++d)
         {
-            if (i > 0)
-                oss << ' ';
-            oss << CHARACTER_TRANSLATIONS[data[current+i]];
+            __m256i const select = _mm256_broadcastsi128_si256(
+                _mm_load_si128((__m128i const*)layout.select[k][d]));
+            block = _mm256_or_si256(block, _mm256_shuffle_epi8(digits[d], select));
         }
-        output.push_back(oss.str());
-        current += 16;
+        _mm_storeu_si128((__m128i*)(out + 1 + 16 * k), _mm256_castsi256_si128(block));
+        _mm_storeu_si128((__m128i*)(out + rowLength + 1 + 16 * k),
+                         _mm256_extracti128_si256(block, 1));
     }
+    out[0] = out[rowLength] = '\t';
+    out[rowLength - 1] = out[2 * rowLength - 1] = '\n';
+}
+
+/// A mask of the bytes that are \c n or more.
+AVX2_FUNCTION static inline __m256i AtLeast(__m256i bytes, uint8_t n)
+{
+    return _mm256_cmpeq_epi8(_mm256_max_epu8(bytes, _mm256_set1_epi8((char)n)), bytes);
+}
 
-    output.push_back("};");
-    std::ostringstream actual_output;
-    for (auto line : output)
+/**
+ * With shuffles the digits can be worked out a byte at a time, rather than in halves of the
+ * register at sixteen bits: the hundreds by comparison, then the rest as sixteens and ones, with
+ * the sixteens' tens and ones looked up and the carry from adding the ones found by comparison.
+ */
+AVX2_FUNCTION static void EncodeDecimalRowsAvx2(uint8_t const* in, size_t numRows, char* out)
+{
+    static char const cell[] = { 0, 1, 2, ',', ' ' };
+    static RowLayout const layout(cell, sizeof(cell));
+    __m256i const sixteensTens = _mm256_setr_epi8(0, 1, 3, 4, 6, 8, 9, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                                  0, 1, 3, 4, 6, 8, 9, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    __m256i const sixteensOnes = _mm256_setr_epi8(0, 6, 2, 8, 4, 0, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                                  0, 6, 2, 8, 4, 0, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    __m256i const nibble = _mm256_set1_epi8(0x0f), ten = _mm256_set1_epi8(10);
+    __m256i const blank = _mm256_set1_epi8(' '), digit = _mm256_set1_epi8('0' - ' ');
+    for (; numRows >= 2; numRows -= 2, in += 32, out += 2 * (1 + 16 * sizeof(cell)))
     {
-        actual_output << line << std::endl;
+        __m256i const bytes = _mm256_loadu_si256((__m256i const*)in);
+        __m256i const over100 = AtLeast(bytes, 100), over200 = AtLeast(bytes, 200);
+        __m256i const over10 = AtLeast(bytes, 10);
+        __m256i const hundreds = _mm256_sub_epi8(_mm256_setzero_si256(),
+                                                 _mm256_add_epi8(over100, over200));
+        __m256i const hundred = _mm256_set1_epi8(100);
+        __m256i const rest = _mm256_sub_epi8(bytes, _mm256_add_epi8(
+            _mm256_and_si256(over100, hundred), _mm256_and_si256(over200, hundred)));
+
+        __m256i const sixteens = _mm256_and_si256(_mm256_srli_epi16(rest, 4), nibble);
+        __m256i const ones = _mm256_add_epi8(_mm256_shuffle_epi8(sixteensOnes, sixteens),
+                                             _mm256_and_si256(rest, nibble));
+        __m256i const carry1 = _mm256_cmpgt_epi8(ones, _mm256_set1_epi8(9));
+        __m256i const carry2 = _mm256_cmpgt_epi8(ones, _mm256_set1_epi8(19));
+        __m256i const carries = _mm256_add_epi8(carry1, carry2);
+        __m256i const tens = _mm256_sub_epi8(_mm256_shuffle_epi8(sixteensTens, sixteens), carries);
+
+        // a zero that leads is ' ' and any other digit is ' ' + 0x10 + the digit
+        __m256i const digits[3] =
+        {
+            _mm256_add_epi8(_mm256_add_epi8(blank, _mm256_and_si256(over100, digit)), hundreds),
+            _mm256_add_epi8(_mm256_add_epi8(blank, _mm256_and_si256(over10, digit)), tens),
+            _mm256_sub_epi8(_mm256_add_epi8(ones, _mm256_set1_epi8('0')), _mm256_add_epi8(
+                _mm256_and_si256(carry1, ten), _mm256_and_si256(carry2, ten))),
+        };
+        StoreRows<3, sizeof(cell)>(layout, digits, out);
     }
-    return actual_output.str();
+    EncodeRowsWithTable(in, numRows, out);
+}
+
+/// AVX2 has the shuffle that SSE2 lacks, so the digits are looked up rather than worked out.
+template <char First, char Second>
+AVX2_FUNCTION static void EncodeHexRowsAvx2(uint8_t const* in, size_t numRows, char* out)
+{
+    static char const cell[] = { First, Second, 0, 1, ',', ' ' };
+    static RowLayout const layout(cell, sizeof(cell));
+    __m256i const nibble = _mm256_set1_epi8(0x0f);
+    __m256i const hex = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((__m128i const*)"0123456789abcdef"));
+    for (; numRows >= 2; numRows -= 2, in += 32, out += 2 * (1 + 16 * sizeof(cell)))
+    {
+        __m256i const bytes = _mm256_loadu_si256((__m256i const*)in);
+        __m256i const digits[2] =
+        {
+            _mm256_shuffle_epi8(hex, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble)),
+            _mm256_shuffle_epi8(hex, _mm256_and_si256(bytes, nibble)),
+        };
+        StoreRows<2, sizeof(cell)>(layout, digits, out);
+    }
+    EncodeHexRowsSse2<First, Second>(in, numRows, out);
+}
+
+static bool HasAvx2()
+{
+ #if defined(_MSC_VER)
+    // the CPU has to have it and the OS has to save the registers
+    int info[4];
+    __cpuid(info, 1);
+    if (((info[2] & (1 << 27)) == 0) || ((info[2] & (1 << 28)) == 0) || ((_xgetbv(0) & 6) != 6))
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+ #else
+    return __builtin_cpu_supports("avx2") != 0;
+ #endif
+}
+#endif // CONVERT_TO_C_AVX2
+
+/// The fastest encoder this CPU has for the array format that GenerateTranslations() set up.
+RowEncoder ChooseRowEncoder(ExportType style, bool asHex)
+{
+#if CONVERT_TO_C_AVX2
+    if (HasAvx2())
+    {
+        if (style == AS_CHARS)
+            return EncodeHexRowsAvx2<'\\', 'x'>;
+        if (style == AS_NUMBERS)
+            return asHex ? EncodeHexRowsAvx2<'0', 'x'> : EncodeDecimalRowsAvx2;
+    }
+#endif
+#if CONVERT_TO_C_SSE2
+    // working out decimal digits without shuffles is no faster than looking them up
+    if (style == AS_CHARS)
+        return EncodeHexRowsSse2<'\\', 'x'>;
+    if ((style == AS_NUMBERS) && asHex)
+        return EncodeHexRowsSse2<'0', 'x'>;
+#else
+    (void)style;
+    (void)asHex;
+#endif
+    return EncodeRowsWithTable;
+}
+
+/**
+ * Writes data as the contents of an array initializer, sixteen values to a line, a chunk at a
+ * time. Whole lines are made by the row encoder straight into a buffer that's written out as it
+ * fills; only lines split between chunks are done a value at a time.
+ */
+class DataFormatter
+{
+public:
+    DataFormatter(std::ostream& out, RowEncoder encodeRows) : out(out), encodeRows(encodeRows),
+        rowLength(1 + 16 * CellLength()), buffer(BUFFER_SIZE + 8), used(0), current(0)
+    {
+        out << "{" << '\n';
+    }
+
+    void Add(char const* data, size_t size)
+    {
+        uint8_t const* in = (uint8_t const*)data;
+        uint8_t const* const end = in + size;
+        while ((in < end) && ((current % 16) != 0))
+            AddByte(*in++);
+
+        while (end - in >= 16)
+        {
+            if ((current % 1024) == 0)
+                AddComment();
+            Reserve(rowLength);
+
+            // as many lines as there are, up to the next comment or the end of the buffer
+            size_t const rows = std::min({ (size_t)(end - in) / 16,
+                                           (size_t)(1024 - (current % 1024)) / 16,
+                                           (BUFFER_SIZE - used) / rowLength });
+            encodeRows(in, rows, &buffer[used]);
+            in += 16 * rows;
+            used += rowLength * rows;
+            current += 16 * rows;
+        }
+
+        while (in < end)
+            AddByte(*in++);
+    }
+
+    void Finish()
+    {
+        // put a NULL at the end in case the string is used as a string; it doesn't
+        // count into the length that we printed before though.
+        AddByte(0);
+        if ((current % 16) != 0)
+            buffer[used++] = '\n';
+        Flush();
+        out << "};" << '\n';
+    }
+
+private:
+    static size_t const BUFFER_SIZE = 1 << 16;
+
+    void AddByte(uint8_t c)
+    {
+        if ((current % 1024) == 0)
+            AddComment();
+        Reserve(16);
+        buffer[used++] = ((current % 16) == 0) ? '\t' : ' ';
+        memcpy(&buffer[used], CHARACTER_TRANSLATIONS[c].text, 8);
+        used += CHARACTER_TRANSLATIONS[c].length;
+        if ((++current % 16) == 0)
+            buffer[used++] = '\n';
+    }
+
+    void AddComment()
+    {
+        Reserve(64);
+        used += (size_t)snprintf(&buffer[used], 64, "\t/* byte %llu */\n",
+                                 (unsigned long long)current);
+    }
+
+    void Reserve(size_t length)
+    {
+        if (used + length > BUFFER_SIZE)
+            Flush();
+    }
+
+    void Flush()
+    {
+        out.write(buffer.data(), (std::streamsize)used);
+        used = 0;
+    }
+
+    std::ostream& out;
+    RowEncoder const encodeRows;
+    size_t const rowLength;
+    std::vector<char> buffer;   ///< with room past BUFFER_SIZE for what the encoders write over
+    size_t used;
+    uint64_t current;
+};
+
+/**
+ * Read the input a chunk at a time and hand each to the formatter, so that a file of any size is
+ * converted in the same small amount of memory.
+ */
+template <typename Formatter>
+bool Convert(std::istream& in, Formatter&& formatter)
+{
+    std::vector<char> chunk(1 << 20);
+    while (in)
+    {
+        in.read(chunk.data(), chunk.size());
+        formatter.Add(chunk.data(), (size_t)in.gcount());
+    }
+    formatter.Finish();
+    return in.eof();
 }
 
 int Main(std::string const& inputFile, std::string const& outputFile, bool asBinary, bool asHex,
@@ -263,90 +659,100 @@ int Main(std::string const& inputFile, std::string const& outputFile, bool asBin
         Error("Couldn't open file %s.", inputFile.c_str());
         return 3;
     }
-    size_t size = file.tellg();
+    uint64_t const size = (uint64_t)file.tellg();
     file.seekg(0);
-    std::string contents(size, 0);
-    file.read(&contents[0], size);
-
-    std::string output;
 
     asBinary |= asHex;
 
+    std::ofstream outfile(outputFile, std::ios::binary | std::ios::trunc);
+    outfile << "/* This file was generated by a script and probably shouldn't be modified by hand. */" << std::endl
+            << std::endl
+            << "const unsigned " << ((size > UINT_MAX) ? "long long " : "int ") << dataName
+            << "_length = " << size << ";" << std::endl
+            << "const " << (asBinary ? "unsigned char " : "char ") << dataName << "[] =" << std::endl;
+
+    bool ok;
     if (!forceString && asBinary)
     {
         GenerateTranslations(AS_NUMBERS, asHex);
-        output = FormatAsData(contents, dataName);
+        ok = Convert(file, DataFormatter(outfile, ChooseRowEncoder(AS_NUMBERS, asHex)));
     }
 	else if (forceString || (size < MAX_STRING_LENGTH))
     {
         GenerateTranslations(AS_STRING);
-        output = FormatAsString(contents, dataName);
+        ok = Convert(file, StringFormatter(outfile));
     }
     else
     {
         GenerateTranslations(AS_NUMBERS_AND_CHARS);
-        output = FormatAsData(contents, dataName);
+        ok = Convert(file, DataFormatter(outfile, ChooseRowEncoder(AS_NUMBERS_AND_CHARS, false)));
     }
 
-    std::ofstream outfile(outputFile, std::ios::binary | std::ios::trunc);
-    outfile << "/* This file was generated by a script and probably shouldn't be modified by hand. */" << std::endl
-            << std::endl
-            << "const unsigned int " << dataName << "_length = " << size << ";" << std::endl
-            << "const " << (asBinary ? "unsigned char " : "char ") << dataName << "[] =" << std::endl;
-
-    outfile << output;
+    outfile.flush();
+    if (!ok || !outfile.good())
+    {
+        Error("Couldn't convert %s to %s.", inputFile.c_str(), outputFile.c_str());
+        return 4;
+    }
 
-    Info("%s -> %s (%d bytes)", inputFile.c_str(), outputFile.c_str(), size);
+    Info("%s -> %s (%llu bytes)", inputFile.c_str(), outputFile.c_str(), (unsigned long long)size);
     return 0;
 }
 
+namespace
+{
+    struct Options
+    {
+        CL_StringType in, out;
+        int b, h, x;
+        CL_StringType name;
+    };
+
+    constexpr CommandLineSpec::Option<Options> k_options[] =
+    {
+        // any unambiguous prefix will do, so -b and -bin are -binary
+        CommandLineSpec::Counting("binary", &Options::b),
+        CommandLineSpec::Counting("hex", &Options::h),
+        CommandLineSpec::String("name", &Options::name),
+        CommandLineSpec::Counting("x", &Options::x),
+        CommandLineSpec::Argument(&Options::in),
+        CommandLineSpec::Argument(&Options::out),
+    };
+    static_assert(CommandLineSpec::IsSorted(k_options), "Options need to be sorted by name.");
+}
+
 int main(int argc, char const** argv)
 {
-    StdStreamLogTarget lt;
+    FdLogTarget lt(false, FdLogTarget::IsTerminal(2));
 
     std::string infile, outfile, dataName;
     bool asBinary, asHex, forceString;
 
     {
-        char const* in, *out;
-        int b, h, x;
-        char const* no;
-
-        CommandLine cl;
-        cl.AddArgument(&in);
-        cl.AddArgument(&out);
-        cl.AddCountingOption(&b, "b");
-        cl.AddCountingOption(&b, "bin");
-        cl.AddCountingOption(&b, "binary");
-        cl.AddCountingOption(&h, "h");
-        cl.AddCountingOption(&h, "hex");
-        cl.AddStringOption(&no, "n");
-        cl.AddStringOption(&no, "name");
-        cl.AddCountingOption(&x, "x");
-
-        if (!cl.Parse(argc, argv))
+        Options o = {};
+        if (!CommandLineSpec::Parse(k_options, o, argc, argv, false, true))
         {
             // if Parse fails, the log target gets the messages.
             return 1;
         }
 
-        if (in == nullptr)
+        if (o.in == nullptr)
         {
             Error("Need to give a filename.");
             return 2;
         }
 
-        infile = in;
-        if (out != nullptr)
-            outfile = out;
+        infile = o.in;
+        if (o.out != nullptr)
+            outfile = o.out;
         else
             outfile = infile + ".c";
 
-        forceString = x != 0;
-        asBinary = b != 0;
-        asHex = h != 0;
-        if (no != nullptr)
-            dataName = no;
+        forceString = o.x != 0;
+        asBinary = o.b != 0;
+        asHex = o.h != 0;
+        if (o.name != nullptr)
+            dataName = o.name;
         else
             dataName = DefaultDataName(infile);
     }
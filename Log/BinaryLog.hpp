@@ -0,0 +1,425 @@
+/**
+ * The on-disk layout of indexed binary log files, and a memory-mapped reader for them.
+ *
+ * \author Tom Plunket <tom@mightysprite.com>
+ * \copyright (c) 2019 Tom Plunket, all rights reserved
+ *
+ * Licensed under the MIT/X license. Do with these files what you will but leave this header intact.
+ *
+ * A file is a FileHeader followed by any number of segments. Each segment is a SegmentHeader
+ * followed by records; the writer starts a new segment every FileHeader::segmentSize bytes and then
+ * goes back to fill in the header with the segment's time range and a bitmap of the severities it
+ * contains. When the file is closed cleanly the segment headers and the file name table are copied
+ * to the end of the file, followed by a Footer that locates them, so a reader only has to touch the
+ * index and the segments that can actually contain matches.
+ *
+ * File names are stored once each, in string records that precede the first record that uses them.
+ * Every other record refers to its file by index. If the writer didn't get to close the file, the
+ * reader walks the segment headers and string records to rebuild what the footer would have held.
+ *
+ * Everything is stored in the byte order of the writing machine.
+ */
+
+#ifndef BinaryLog_hpp
+#define BinaryLog_hpp
+
+#include "Log.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+ #ifndef WIN32_LEAN_AND_MEAN
+  #define WIN32_LEAN_AND_MEAN
+ #endif
+ #include <windows.h>
+#else
+ #include <fcntl.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+#endif
+
+namespace BinaryLog
+{
+    static uint32_t const k_fileMagic = 0x42474f4c;      // "LOGB"
+    static uint32_t const k_segmentMagic = 0x4d474553;   // "SEGM"
+    static uint32_t const k_footerMagic = 0x45474f4c;    // "LOGE"
+    static uint32_t const k_version = 1;
+
+    static uint32_t const k_defaultSegmentSize = 64 * 1024;
+
+    /// The record type used for entries in the file name table.
+    /// Their length includes the terminating zero so that the reader can hand out the names as-is.
+    static uint8_t const k_stringRecord = 0xff;
+    /// The file index used when the file name table is full.
+    static uint16_t const k_noFile = 0xffff;
+
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t segmentSize;
+        uint32_t reserved;
+    };
+
+    struct SegmentHeader
+    {
+        uint32_t magic;
+        uint32_t bytes;         ///< bytes of records following this header
+        uint32_t records;
+        uint32_t severities;    ///< bit (1 << LogType) set for each type present
+        uint64_t firstTime;     ///< nanoseconds since the Unix epoch
+        uint64_t lastTime;
+    };
+
+    struct RecordHeader
+    {
+        uint64_t time;          ///< nanoseconds since the Unix epoch
+        uint32_t line;
+        uint32_t length;        ///< message bytes, not counting the padding to the next record
+        uint16_t file;          ///< index into the file name table
+        uint8_t type;           ///< LogType, or k_stringRecord
+        uint8_t flags;
+        uint32_t sampleRate;    ///< the message was one of about this many; 0 or 1 if not sampled
+    };
+
+    /// Entries in the trailing index are the segment header plus where to find it.
+    struct IndexEntry
+    {
+        SegmentHeader header;
+        uint64_t offset;
+    };
+
+    struct Footer
+    {
+        uint64_t indexOffset;
+        uint64_t stringsOffset;
+        uint32_t indexCount;
+        uint32_t stringCount;
+        uint32_t magic;
+        uint32_t reserved;
+    };
+
+    /// Records and string table entries are padded to keep the headers aligned.
+    inline size_t Padded(size_t bytes) { return (bytes + 7) & ~size_t(7); }
+
+    /// One record as handed out by the Reader. \c message is not zero terminated.
+    struct Record
+    {
+        uint64_t time;
+        LogType type;
+        char const* file;
+        unsigned int line;
+        char const* message;
+        size_t length;
+        unsigned int sampleRate;
+    };
+}
+
+/**
+ * Maps a binary log file into memory and answers time/severity/file queries against it.
+ */
+class BinaryLogReader
+{
+public:
+    explicit BinaryLogReader(char const* path) { Open(path); }
+    ~BinaryLogReader() { Close(); }
+
+    bool IsOpen() const { return data != nullptr; }
+
+    size_t GetSegmentCount() const { return index.size(); }
+    size_t GetFileNameCount() const { return fileNames.size(); }
+    char const* GetFileName(size_t i) const
+        { return (i < fileNames.size()) ? fileNames[i] : ""; }
+
+    /**
+     * Build a filter for Query() that accepts every file whose name is \c name or ends with
+     * "/name" (or "\name"); passing NULL or an empty string accepts all files.
+     */
+    std::vector<bool> MatchFiles(char const* name) const
+    {
+        std::vector<bool> matches;
+        if ((name == nullptr) || (*name == '\0'))
+            return matches;
+
+        size_t const nameLength = strlen(name);
+        matches.resize(fileNames.size() + 1, false);
+        for (size_t i = 0; i < fileNames.size(); ++i)
+        {
+            char const* f = fileNames[i];
+            size_t const fLength = strlen(f);
+            if (fLength < nameLength)
+                continue;
+            char const* tail = f + fLength - nameLength;
+            if ((strcmp(tail, name) == 0) &&
+                ((tail == f) || (tail[-1] == '/') || (tail[-1] == '\\')))
+            {
+                matches[i] = true;
+            }
+        }
+        return matches;
+    }
+
+    /**
+     * Call \c fn with every record in [from, to] whose severity bit is set in \c severities and
+     * whose file is accepted by \c files (see MatchFiles()). Returns the number of matches.
+     */
+    template <typename Fn>
+    size_t Query(uint64_t from, uint64_t to, uint32_t severities, std::vector<bool> const& files,
+                 Fn fn) const
+    {
+        using namespace BinaryLog;
+
+        // Segments are written in time order, so find the first one that ends at or after 'from'.
+        size_t lo = 0, hi = index.size();
+        while (lo < hi)
+        {
+            size_t mid = lo + (hi - lo) / 2;
+            if (index[mid].header.lastTime < from)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        size_t numMatches = 0;
+        for (size_t s = lo; (s < index.size()) && (index[s].header.firstTime <= to); ++s)
+        {
+            SegmentHeader const& sh = index[s].header;
+            if ((sh.severities & severities) == 0)
+                continue;
+
+            char const* p = data + index[s].offset + sizeof(SegmentHeader);
+            char const* end = p + sh.bytes;
+            while (p + sizeof(RecordHeader) <= end)
+            {
+                RecordHeader const* rh = (RecordHeader const*)p;
+                char const* message = p + sizeof(RecordHeader);
+
+                // a damaged record ends the segment, as it does when the index is rebuilt
+                if (message + rh->length > end)
+                    break;
+                if ((rh->type != k_stringRecord) && (rh->type >= k_numLogTypes))
+                    break;
+                p = message + Padded(rh->length);
+
+                if ((rh->type == k_stringRecord) || (rh->time < from))
+                    continue;
+                // the writer keeps records in time order, so nothing later in the file matches
+                if (rh->time > to)
+                    break;
+                if ((severities & (1u << rh->type)) == 0)
+                    continue;
+                if (!files.empty() && ((rh->file >= files.size()) || !files[rh->file]))
+                    continue;
+
+                Record r = { rh->time, (LogType)rh->type, GetFileName(rh->file), rh->line,
+                             message, rh->length, (rh->sampleRate > 1) ? rh->sampleRate : 1 };
+                fn(r);
+                ++numMatches;
+            }
+        }
+        return numMatches;
+    }
+
+private:
+    BinaryLogReader(BinaryLogReader const&);
+    BinaryLogReader& operator=(BinaryLogReader const&);
+
+    void Open(char const* path)
+    {
+        data = nullptr;
+        size = 0;
+
+#ifdef _WIN32
+        file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        mapping = NULL;
+        if (file == INVALID_HANDLE_VALUE)
+            return;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || (fileSize.QuadPart < (LONGLONG)sizeof(BinaryLog::FileHeader)))
+            return;
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping == NULL)
+            return;
+        data = (char const*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        size = (size_t)fileSize.QuadPart;
+#else
+        int fd = open(path, O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat st;
+        if ((fstat(fd, &st) == 0) && (st.st_size >= (off_t)sizeof(BinaryLog::FileHeader)))
+        {
+            void* m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (m != MAP_FAILED)
+            {
+                data = (char const*)m;
+                size = (size_t)st.st_size;
+            }
+        }
+        close(fd);
+#endif
+
+        if (data == nullptr)
+            return;
+
+        BinaryLog::FileHeader const* fh = (BinaryLog::FileHeader const*)data;
+        if ((fh->magic != BinaryLog::k_fileMagic) || (fh->version != BinaryLog::k_version) ||
+            (!LoadFooter() && !Rebuild()))
+        {
+            Error("%s is not a readable binary log file.", path);
+            Close();
+        }
+    }
+
+    void Close()
+    {
+#ifdef _WIN32
+        if (data != nullptr)
+            UnmapViewOfFile(data);
+        if (mapping != NULL)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        mapping = NULL;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (data != nullptr)
+            munmap((void*)data, size);
+#endif
+        data = nullptr;
+        size = 0;
+        index.clear();
+        fileNames.clear();
+    }
+
+    /// The happy path; the file was closed properly and has its index at the end. Everything the
+    /// footer points at has to be inside the file, or the index is rebuilt from the segments.
+    bool LoadFooter()
+    {
+        using namespace BinaryLog;
+
+        if (size < sizeof(FileHeader) + sizeof(Footer))
+            return false;
+        size_t const footerOffset = size - sizeof(Footer);
+        Footer const* f = (Footer const*)(data + footerOffset);
+        if ((f->magic != k_footerMagic) || (f->indexOffset > footerOffset) ||
+            (f->indexCount > (footerOffset - f->indexOffset) / sizeof(IndexEntry)) ||
+            (f->stringsOffset > footerOffset))
+        {
+            return false;
+        }
+
+        IndexEntry const* entries = (IndexEntry const*)(data + f->indexOffset);
+        for (uint32_t i = 0; i < f->indexCount; ++i)
+        {
+            IndexEntry const& e = entries[i];
+            if ((e.header.magic != k_segmentMagic) || (e.offset < sizeof(FileHeader)) ||
+                (e.offset > footerOffset - sizeof(SegmentHeader)) ||
+                (e.header.bytes > footerOffset - sizeof(SegmentHeader) - e.offset))
+            {
+                return false;
+            }
+        }
+
+        char const* p = data + f->stringsOffset;
+        char const* end = (char const*)f;
+        std::vector<char const*> names;
+        for (uint32_t i = 0; (i < f->stringCount) && (p + sizeof(uint32_t) <= end); ++i)
+        {
+            uint32_t length = *(uint32_t const*)p;
+            char const* name = p + sizeof(uint32_t);
+            if ((length == 0) || (length > (size_t)(end - name)) || (name[length - 1] != '\0'))
+                return false;
+            names.push_back(name);
+            p += Padded(sizeof(uint32_t) + length);
+        }
+        if (names.size() != f->stringCount)
+            return false;
+
+        index.assign(entries, entries + f->indexCount);
+        fileNames.swap(names);
+        return true;
+    }
+
+    /// The writer didn't finish; walk the segments to recover the index and the file names.
+    bool Rebuild()
+    {
+        using namespace BinaryLog;
+
+        size_t offset = sizeof(FileHeader);
+        while (offset + sizeof(SegmentHeader) <= size)
+        {
+            IndexEntry entry;
+            entry.header = *(SegmentHeader const*)(data + offset);
+            entry.offset = offset;
+
+            // An unfinished segment has a blank header, so its extent and summary come from its
+            // records, up to the last one that was written completely.
+            bool const finished = (entry.header.magic == k_segmentMagic);
+            if (!finished)
+                memset(&entry.header, 0, sizeof(entry.header));
+
+            char const* start = data + offset + sizeof(SegmentHeader);
+            char const* end = finished ? start + entry.header.bytes : data + size;
+            if (end > data + size)
+                end = data + size;
+
+            char const* p = start;
+            while (p + sizeof(RecordHeader) <= end)
+            {
+                RecordHeader const* rh = (RecordHeader const*)p;
+                char const* message = p + sizeof(RecordHeader);
+                if (message + rh->length > end)
+                    break;
+                if ((rh->type != k_stringRecord) && (rh->type >= k_numLogTypes))
+                    break;
+
+                if (rh->type == k_stringRecord)
+                {
+                    if (rh->file == fileNames.size())
+                        fileNames.push_back(message);
+                }
+                else if (!finished)
+                {
+                    if (entry.header.records == 0)
+                        entry.header.firstTime = rh->time;
+                    entry.header.lastTime = rh->time;
+                    entry.header.severities |= 1u << rh->type;
+                    ++entry.header.records;
+                }
+                p = message + Padded(rh->length);
+            }
+
+            if (!finished)
+            {
+                entry.header.magic = k_segmentMagic;
+                entry.header.bytes = (uint32_t)(p - start);
+            }
+            if (entry.header.records > 0)
+                index.push_back(entry);
+
+            if (!finished)
+                break;
+            offset += sizeof(SegmentHeader) + entry.header.bytes;
+        }
+        return true;
+    }
+
+    char const* data;
+    size_t size;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+
+    std::vector<BinaryLog::IndexEntry> index;
+    std::vector<char const*> fileNames;
+};
+
+#endif // ndef BinaryLog_hpp
@@ -0,0 +1,247 @@
+/**
+ * A LogTarget that writes an indexed binary log file which can be searched by time, severity and
+ * source file without scanning the whole thing. See BinaryLog.hpp for the format and the reader.
+ *
+ * \author Tom Plunket <tom@mightysprite.com>
+ * \copyright (c) 2019 Tom Plunket, all rights reserved
+ *
+ * Licensed under the MIT/X license. Do with these files what you will but leave this header intact.
+ */
+
+#ifndef BinaryLogTarget_hpp
+#define BinaryLogTarget_hpp
+
+#include "BinaryLog.hpp"
+#include "LogTarget.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct BinaryLogTarget : public LogTarget
+{
+    explicit BinaryLogTarget(char const* path,
+                             uint32_t segmentSize = BinaryLog::k_defaultSegmentSize) :
+        file(fopen(path, "wb")),
+        segmentSize(segmentSize),
+        offset(0),
+        lastTime(0)
+    {
+        if (file == nullptr)
+            return;
+
+        BinaryLog::FileHeader fh = { BinaryLog::k_fileMagic, BinaryLog::k_version, segmentSize, 0 };
+        Write(&fh, sizeof(fh));
+        BeginSegment();
+    }
+
+    ~BinaryLogTarget()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (file == nullptr)
+            return;
+
+        EndSegment();
+        WriteFooter();
+        fclose(file);
+        file = nullptr;
+    }
+
+    bool IsOpen() const { return file != nullptr; }
+
+    /// Push everything written so far to the OS, e.g. so a reader can look at a live file.
+    void Flush()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (file != nullptr)
+            fflush(file);
+    }
+
+    static uint64_t Now()
+    {
+        using namespace std::chrono;
+        return (uint64_t)duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+    }
+
+protected:
+    /// The guts of LogMessage, exposed to subclasses that supply their own timestamps. A time
+    /// earlier than the last record's is raised to it, since the reader relies on the file being
+    /// in time order.
+    void Append(uint64_t time, LogType lt, char const* fileName, unsigned int line,
+                char const* message, size_t length, unsigned int sampleRate=1)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        AppendLocked(time, lt, fileName, line, message, length, sampleRate);
+    }
+
+private:
+    void LogMessage(char const* message, LogType lt, char const* fileName, unsigned int line)
+    {
+        // the time is taken under the lock so that threads can't write theirs out of order
+        std::lock_guard<std::mutex> lock(mutex);
+        AppendLocked(Now(), lt, fileName, line, message, strlen(message), LogSampleRate());
+    }
+
+    void AppendLocked(uint64_t time, LogType lt, char const* fileName, unsigned int line,
+                      char const* message, size_t length, unsigned int sampleRate)
+    {
+        if (file == nullptr)
+            return;
+
+        // the clock can also step backwards
+        time = std::max(time, lastTime);
+        lastTime = time;
+
+        // the trailing newline is implied in this format
+        if ((length > 0) && (message[length-1] == '\n'))
+            --length;
+
+        if (segment.bytes >= segmentSize)
+        {
+            EndSegment();
+            BeginSegment();
+        }
+
+        uint16_t fileIndex = FileIndex(time, fileName);
+
+        BinaryLog::RecordHeader rh = { time, line, (uint32_t)length, fileIndex, (uint8_t)lt, 0,
+                                       sampleRate };
+        WriteRecord(rh, message);
+
+        if (segment.records == 0)
+            segment.firstTime = time;
+        segment.lastTime = time;
+        segment.severities |= 1u << lt;
+        ++segment.records;
+    }
+
+    uint16_t FileIndex(uint64_t time, char const* fileName)
+    {
+        // __FILE__ is almost always the same pointer for a given file, so check that first.
+        auto known = filePointers.find(fileName);
+        if ((known != filePointers.end()) && (fileNames[known->second] == fileName))
+            return known->second;
+
+        uint16_t index;
+        auto named = fileIndices.find(fileName);
+        if (named != fileIndices.end())
+        {
+            index = named->second;
+        }
+        else if (fileNames.size() < BinaryLog::k_noFile)
+        {
+            index = (uint16_t)fileNames.size();
+            fileNames.push_back(fileName);
+            fileIndices[fileName] = index;
+
+            BinaryLog::RecordHeader rh = { time, 0, (uint32_t)(fileNames.back().size() + 1), index,
+                                           BinaryLog::k_stringRecord, 0, 0 };
+            WriteRecord(rh, fileNames.back().c_str());
+        }
+        else
+        {
+            return BinaryLog::k_noFile;
+        }
+
+        filePointers[fileName] = index;
+        return index;
+    }
+
+    void WriteRecord(BinaryLog::RecordHeader const& rh, char const* payload)
+    {
+        static char const k_padding[8] = { 0 };
+        size_t const padding = BinaryLog::Padded(rh.length) - rh.length;
+        Write(&rh, sizeof(rh));
+        Write(payload, rh.length);
+        Write(k_padding, padding);
+        segment.bytes += (uint32_t)(sizeof(rh) + rh.length + padding);
+    }
+
+    void BeginSegment()
+    {
+        segmentOffset = offset;
+        memset(&segment, 0, sizeof(segment));
+        segment.magic = BinaryLog::k_segmentMagic;
+
+        // The real header goes in when the segment is done; until then a reader sees that it's
+        // unfinished and walks the records instead.
+        BinaryLog::SegmentHeader blank;
+        memset(&blank, 0, sizeof(blank));
+        Write(&blank, sizeof(blank));
+    }
+
+    void EndSegment()
+    {
+        Seek(segmentOffset);
+        fwrite(&segment, sizeof(segment), 1, file);
+        Seek(offset);
+
+        if (segment.records > 0)
+        {
+            BinaryLog::IndexEntry entry = { segment, segmentOffset };
+            index.push_back(entry);
+        }
+    }
+
+    void WriteFooter()
+    {
+        BinaryLog::Footer footer;
+        memset(&footer, 0, sizeof(footer));
+
+        footer.indexOffset = offset;
+        footer.indexCount = (uint32_t)index.size();
+        if (!index.empty())
+            Write(&index[0], index.size() * sizeof(index[0]));
+
+        footer.stringsOffset = offset;
+        footer.stringCount = (uint32_t)fileNames.size();
+        for (std::string const& name : fileNames)
+        {
+            static char const k_padding[8] = { 0 };
+            uint32_t length = (uint32_t)(name.size() + 1);
+            Write(&length, sizeof(length));
+            Write(name.c_str(), length);
+            Write(k_padding, BinaryLog::Padded(sizeof(length) + length) - (sizeof(length) + length));
+        }
+
+        footer.magic = BinaryLog::k_footerMagic;
+        Write(&footer, sizeof(footer));
+    }
+
+    void Seek(uint64_t position)
+    {
+#ifdef _WIN32
+        _fseeki64(file, (__int64)position, SEEK_SET);
+#else
+        fseeko(file, (off_t)position, SEEK_SET);
+#endif
+    }
+
+    void Write(void const* p, size_t bytes)
+    {
+        if (bytes > 0)
+            fwrite(p, 1, bytes, file);
+        offset += bytes;
+    }
+
+    FILE* file;
+    uint32_t const segmentSize;
+    uint64_t offset;
+    uint64_t lastTime;
+
+    uint64_t segmentOffset;
+    BinaryLog::SegmentHeader segment;
+    std::vector<BinaryLog::IndexEntry> index;
+
+    std::vector<std::string> fileNames;
+    std::unordered_map<std::string, uint16_t> fileIndices;
+    std::unordered_map<char const*, uint16_t> filePointers;
+
+    std::mutex mutex;
+};
+
+#endif // ndef BinaryLogTarget_hpp
@@ -0,0 +1,250 @@
+/**
+ * Unit tests for the indexed binary log target and reader.
+ *
+ * \author Tom Plunket <tom@mightysprite.com>
+ * \copyright (c) 2019 Tom Plunket, all rights reserved
+ *
+ * Licensed under the MIT/X license. Do with these files what you will but leave this header intact.
+ */
+
+#include "BinaryLogTarget.hpp"
+
+#include "Catch/Catch.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static char const* const k_testFile = "BinaryLog_t.blog";
+
+TEST_CASE( "Binary log round trip" )
+{
+    uint32_t const all = (1u << k_numLogTypes) - 1;
+    std::vector<bool> const anyFile;
+    uint64_t start, middle;
+
+    {
+        // tiny segments so that the index has something to do
+        BinaryLogTarget target(k_testFile, 256);
+        REQUIRE(target.IsOpen());
+
+        start = BinaryLogTarget::Now();
+        for (int i = 0; i < 50; ++i)
+            Info("Message number %d.", i);
+        middle = BinaryLogTarget::Now();
+        Error("Something went wrong.");
+        for (int i = 0; i < 50; ++i)
+            Spew("Spew number %d.", i);
+    }
+
+    BinaryLogReader reader(k_testFile);
+    REQUIRE(reader.IsOpen());
+    REQUIRE(reader.GetSegmentCount() > 10);
+    REQUIRE(reader.GetFileNameCount() == 1);
+    REQUIRE_THAT(reader.GetFileName(0), Catch::Equals(__FILE__));
+
+    SECTION( "Everything comes back in order." )
+    {
+        int count = 0;
+        uint64_t lastTime = 0;
+        size_t found = reader.Query(0, UINT64_MAX, all, anyFile, [&](BinaryLog::Record const& r)
+            {
+                REQUIRE(r.time >= lastTime);
+                lastTime = r.time;
+                if (count == 0)
+                    REQUIRE(std::string(r.message, r.length) == "Message number 0.");
+                ++count;
+            });
+        REQUIRE(found == 101);
+        REQUIRE(count == 101);
+    }
+
+    SECTION( "Severity filter" )
+    {
+        std::string message;
+        unsigned int line = 0;
+        size_t found = reader.Query(0, UINT64_MAX, 1u << k_logError, anyFile,
+                                    [&](BinaryLog::Record const& r)
+            {
+                REQUIRE(r.type == k_logError);
+                message.assign(r.message, r.length);
+                line = r.line;
+            });
+        REQUIRE(found == 1);
+        REQUIRE(message == "Something went wrong.");
+        REQUIRE(line > 0);
+    }
+
+    SECTION( "Time filter" )
+    {
+        size_t found = reader.Query(start, middle, all, anyFile, [](BinaryLog::Record const& r)
+            {
+                REQUIRE(r.type == k_logInfo);
+            });
+        REQUIRE(found == 50);
+    }
+
+    SECTION( "File filter" )
+    {
+        REQUIRE(reader.Query(0, UINT64_MAX, all, reader.MatchFiles("BinaryLog_t.cpp"),
+                             [](BinaryLog::Record const&) {}) == 101);
+        REQUIRE(reader.Query(0, UINT64_MAX, all, reader.MatchFiles("Log_t.cpp"),
+                             [](BinaryLog::Record const&) {}) == 0);
+    }
+
+    remove(k_testFile);
+}
+
+TEST_CASE( "Binary log that wasn't closed" )
+{
+    BinaryLogTarget target(k_testFile, 256);
+    for (int i = 0; i < 20; ++i)
+        Warning("Warning number %d.", i);
+    target.Flush();
+
+    BinaryLogReader reader(k_testFile);
+    REQUIRE(reader.IsOpen());
+    REQUIRE(reader.GetFileNameCount() == 1);
+
+    std::string last;
+    size_t found = reader.Query(0, UINT64_MAX, 1u << k_logWarning, std::vector<bool>(),
+                                [&](BinaryLog::Record const& r) { last.assign(r.message, r.length); });
+    REQUIRE(found == 20);
+    REQUIRE(last == "Warning number 19.");
+}
+
+static std::string ReadFile(char const* name)
+{
+    std::string bytes;
+    FILE* f = fopen(name, "rb");
+    REQUIRE(f != nullptr);
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+        bytes.append(buffer, n);
+    fclose(f);
+    return bytes;
+}
+
+static void WriteFile(char const* name, std::string const& bytes)
+{
+    FILE* f = fopen(name, "wb");
+    REQUIRE(f != nullptr);
+    fwrite(bytes.data(), 1, bytes.size(), f);
+    fclose(f);
+}
+
+TEST_CASE( "Binary log that's been damaged" )
+{
+    using namespace BinaryLog;
+    uint32_t const all = (1u << k_numLogTypes) - 1;
+
+    {
+        BinaryLogTarget target(k_testFile, 256);
+        for (int i = 0; i < 50; ++i)
+            Info("Message number %d.", i);
+    }
+    std::string bytes = ReadFile(k_testFile);
+    Footer footer;
+    memcpy(&footer, &bytes[bytes.size() - sizeof(footer)], sizeof(footer));
+    REQUIRE(footer.magic == k_footerMagic);
+    REQUIRE(footer.indexCount > 2);
+
+    SECTION( "An index entry that runs past the end is ignored, and the index rebuilt." )
+    {
+        IndexEntry entry;
+        size_t const at = (size_t)footer.indexOffset + sizeof(entry);
+        memcpy(&entry, &bytes[at], sizeof(entry));
+        entry.header.bytes = 0xfffffff0;
+        memcpy(&bytes[at], &entry, sizeof(entry));
+        WriteFile(k_testFile, bytes);
+
+        BinaryLogReader reader(k_testFile);
+        REQUIRE(reader.IsOpen());
+        REQUIRE(reader.Query(0, UINT64_MAX, all, std::vector<bool>(),
+                             [](Record const&) {}) == 50);
+    }
+
+    SECTION( "A footer that points outside the file is ignored." )
+    {
+        footer.indexOffset = UINT64_MAX - 8;
+        memcpy(&bytes[bytes.size() - sizeof(footer)], &footer, sizeof(footer));
+        WriteFile(k_testFile, bytes);
+
+        BinaryLogReader reader(k_testFile);
+        REQUIRE(reader.IsOpen());
+        REQUIRE(reader.GetFileNameCount() == 1);
+    }
+
+    SECTION( "Records that run past their segment or have no type end it." )
+    {
+        // the first segment starts with the file name and then the first message
+        size_t const first = sizeof(FileHeader) + sizeof(SegmentHeader) + sizeof(RecordHeader) +
+                             Padded(strlen(__FILE__) + 1);
+        RecordHeader rh;
+        memcpy(&rh, &bytes[first], sizeof(rh));
+        REQUIRE(rh.type == k_logInfo);
+        rh.length = 0x7ffffff0;
+        memcpy(&bytes[first], &rh, sizeof(rh));
+
+        IndexEntry entry;
+        memcpy(&entry, &bytes[(size_t)footer.indexOffset + sizeof(entry)], sizeof(entry));
+        memcpy(&rh, &bytes[(size_t)entry.offset + sizeof(SegmentHeader)], sizeof(rh));
+        rh.type = 200;
+        memcpy(&bytes[(size_t)entry.offset + sizeof(SegmentHeader)], &rh, sizeof(rh));
+        WriteFile(k_testFile, bytes);
+
+        BinaryLogReader reader(k_testFile);
+        REQUIRE(reader.IsOpen());
+        size_t const found = reader.Query(0, UINT64_MAX, all, std::vector<bool>(),
+                                          [](Record const& r) { REQUIRE(r.type == k_logInfo); });
+        REQUIRE(found > 0);
+        REQUIRE(found < 50);
+    }
+
+    remove(k_testFile);
+}
+
+/// Lets the tests hand in their own times.
+struct TimedBinaryLogTarget : public BinaryLogTarget
+{
+    explicit TimedBinaryLogTarget(char const* path) : BinaryLogTarget(path, 256) {}
+
+    void Log(uint64_t time, char const* message)
+    {
+        Append(time, k_logInfo, __FILE__, __LINE__, message, strlen(message));
+    }
+};
+
+TEST_CASE( "Binary log times that go backwards" )
+{
+    {
+        TimedBinaryLogTarget target(k_testFile);
+        target.Log(1000, "First.");
+        target.Log(3000, "Second.");
+        target.Log(2000, "Third, from a clock that stepped back.");
+        for (int i = 0; i < 20; ++i)
+            target.Log(2500, "Filler to fill a few segments.");
+        target.Log(4000, "Last.");
+    }
+
+    BinaryLogReader reader(k_testFile);
+    REQUIRE(reader.IsOpen());
+    REQUIRE(reader.GetSegmentCount() > 2);
+
+    std::vector<uint64_t> times;
+    reader.Query(0, UINT64_MAX, 1u << k_logInfo, std::vector<bool>(),
+                 [&](BinaryLog::Record const& r) { times.push_back(r.time); });
+    REQUIRE(times.size() == 24);
+    REQUIRE(times[1] == 3000);
+    REQUIRE(times[2] == 3000);
+    REQUIRE(times[22] == 3000);
+    REQUIRE(times[23] == 4000);
+
+    // every segment's records fall in its range, so a search by time still finds them all
+    REQUIRE(reader.Query(3000, 3000, 1u << k_logInfo, std::vector<bool>(),
+                         [](BinaryLog::Record const&) {}) == 22);
+
+    remove(k_testFile);
+}
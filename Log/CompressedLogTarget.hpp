@@ -0,0 +1,210 @@
+/**
+ * A LogTarget that writes a compressed log file, doing the compression on a background thread.
+ *
+ * \author Tom Plunket <tom@mightysprite.com>
+ * \copyright (c) 2019 Tom Plunket, all rights reserved
+ *
+ * Licensed under the MIT/X license. Do with these files what you will but leave this header intact.
+ *
+ * Messages are copied into the current block and that's all the logging thread does. When a block
+ * fills up (or has been sitting for flushInterval) it's handed to the background thread, which
+ * compresses it and writes it out while logging carries on into the next block. The file is a
+ * series of self-delimiting blocks (see LogCompression.hpp), so whatever made it to disk can be
+ * read back with LogCompression::DecompressFile() even if the process never shut down cleanly.
+ *
+ * If the background thread falls behind by more than k_maxBlocks blocks, loggers wait for it.
+ */
+
+#ifndef CompressedLogTarget_hpp
+#define CompressedLogTarget_hpp
+
+#include "LogCompression.hpp"
+#include "LogTarget.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct CompressedLogTarget : public LogTarget
+{
+    static size_t const k_defaultBlockSize = 1024 * 1024;
+    static size_t const k_maxBlocks = 4;
+
+    explicit CompressedLogTarget(char const* path, bool annotate=false,
+                                 size_t blockSize=k_defaultBlockSize,
+                                 std::chrono::milliseconds flushInterval=std::chrono::seconds(1)) :
+        file(fopen(path, "wb")),
+        annotate(annotate),
+        blockSize(blockSize),
+        flushInterval(flushInterval),
+        numBlocks(1),
+        compressing(false),
+        quit(false)
+    {
+        current.reserve(blockSize);
+        if (file != nullptr)
+            thread = std::thread(&CompressedLogTarget::Compressor, this);
+    }
+
+    ~CompressedLogTarget()
+    {
+        if (file == nullptr)
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_one();
+        thread.join();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        fclose(file);
+        file = nullptr;
+    }
+
+    bool IsOpen() const { return file != nullptr; }
+
+    /// Hand off whatever's in the current block and wait until it's on its way to the disk.
+    void Flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (file == nullptr)
+            return;
+        if (!current.empty())
+            Submit();
+        drained.wait(lock, [this] { return full.empty() && !compressing; });
+        fflush(file);
+    }
+
+private:
+    void LogMessage(char const* message, LogType, char const* fileName, unsigned int line)
+    {
+        char prefix[256];
+        int prefixLength = 0;
+        if (annotate)
+        {
+            unsigned int const sampleRate = LogSampleRate();
+            if (sampleRate > 1)
+            {
+                prefixLength = snprintf(prefix, sizeof(prefix), "%s(%u): [sampled=%u] ", fileName,
+                                        line, sampleRate);
+            }
+            else
+            {
+                prefixLength = snprintf(prefix, sizeof(prefix), "%s(%u): ", fileName, line);
+            }
+            if (prefixLength >= (int)sizeof(prefix))
+                prefixLength = sizeof(prefix) - 1;
+        }
+        size_t const messageLength = strlen(message);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (file == nullptr)
+            return;
+
+        if (current.size() + prefixLength + messageLength > blockSize)
+            Submit(&lock);
+
+        current.insert(current.end(), prefix, prefix + prefixLength);
+        current.insert(current.end(), message, message + messageLength);
+    }
+
+    /// Queue the current block for compression and start a new one; called with the lock held.
+    void Submit(std::unique_lock<std::mutex>* lock=nullptr)
+    {
+        if (current.empty())
+            return;
+
+        if (!spare.empty())
+        {
+            full.push_back(std::move(current));
+            current = std::move(spare.back());
+            spare.pop_back();
+        }
+        else if ((numBlocks < k_maxBlocks) || (lock == nullptr))
+        {
+            full.push_back(std::move(current));
+            current = std::vector<char>();
+            current.reserve(blockSize);
+            ++numBlocks;
+        }
+        else
+        {
+            // all of the blocks are waiting on the compressor
+            full.push_back(std::move(current));
+            current = std::vector<char>();
+            wake.notify_one();
+            returned.wait(*lock, [this] { return !spare.empty(); });
+            current = std::move(spare.back());
+            spare.pop_back();
+        }
+        wake.notify_one();
+    }
+
+    void Compressor()
+    {
+        std::vector<char> scratch(blockSize);
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;)
+        {
+            if (full.empty())
+            {
+                if (quit)
+                {
+                    if (current.empty())
+                        break;
+                    Submit();
+                }
+                else if (!wake.wait_for(lock, flushInterval,
+                                        [this] { return quit || !full.empty(); }) &&
+                         !current.empty())
+                {
+                    // it's been quiet for a while; write out what there is
+                    Submit();
+                }
+                continue;
+            }
+
+            std::vector<char> block = std::move(full.front());
+            full.pop_front();
+            compressing = true;
+
+            lock.unlock();
+            LogCompression::WriteBlock(file, block.empty() ? "" : &block[0], block.size(), scratch);
+            block.clear();
+            lock.lock();
+
+            compressing = false;
+            spare.push_back(std::move(block));
+            returned.notify_all();
+            if (full.empty())
+                drained.notify_all();
+        }
+        drained.notify_all();
+    }
+
+    FILE* file;
+    bool const annotate;
+    size_t const blockSize;
+    std::chrono::milliseconds const flushInterval;
+
+    std::vector<char> current;
+    std::deque<std::vector<char>> full;
+    std::vector<std::vector<char>> spare;
+    size_t numBlocks;
+    bool compressing;
+    bool quit;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable returned;
+    std::condition_variable drained;
+    std::thread thread;
+};
+
+#endif // ndef CompressedLogTarget_hpp
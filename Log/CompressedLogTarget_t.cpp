@@ -0,0 +1,140 @@
+/**
+ * Unit tests for the compressed log target and its codec.
+ *
+ * \author Tom Plunket <tom@mightysprite.com>
+ * \copyright (c) 2019 Tom Plunket, all rights reserved
+ *
+ * Licensed under the MIT/X license. Do with these files what you will but leave this header intact.
+ */
+
+#include "CompressedLogTarget.hpp"
+
+#include "Catch/Catch.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+static char const* const k_testFile = "CompressedLog_t.lz";
+
+static std::string RoundTrip(std::string const& in, size_t* compressedSize=nullptr)
+{
+    std::vector<char> compressed(in.size() + 16);
+    size_t size = LogCompression::Compress(in.data(), in.size(), &compressed[0], compressed.size());
+    REQUIRE(size > 0);
+    if (compressedSize != nullptr)
+        *compressedSize = size;
+
+    std::string out(in.size(), '\0');
+    long outSize = LogCompression::Decompress(&compressed[0], size, &out[0], out.size() + 1);
+    REQUIRE(outSize == (long)in.size());
+    return out;
+}
+
+static std::string ReadBack()
+{
+    FILE* in = fopen(k_testFile, "rb");
+    REQUIRE(in != nullptr);
+    FILE* out = tmpfile();
+    REQUIRE(LogCompression::DecompressFile(in, out));
+    fclose(in);
+
+    std::string text(ftell(out), '\0');
+    rewind(out);
+    if (!text.empty())
+        REQUIRE(fread(&text[0], 1, text.size(), out) == text.size());
+    fclose(out);
+    return text;
+}
+
+TEST_CASE( "LZ block codec" )
+{
+    SECTION( "Empty" )
+    {
+        REQUIRE(RoundTrip("") == "");
+    }
+
+    SECTION( "Short and unrepetitive" )
+    {
+        REQUIRE(RoundTrip("abc") == "abc");
+    }
+
+    SECTION( "Repetitive text shrinks" )
+    {
+        std::string text;
+        for (int i = 0; i < 1000; ++i)
+            text += "Connection " + std::to_string(i % 7) + " timed out after 30 seconds.\n";
+        size_t compressedSize;
+        REQUIRE(RoundTrip(text, &compressedSize) == text);
+        REQUIRE(compressedSize < text.size() / 4);
+    }
+
+    SECTION( "Long runs" )
+    {
+        std::string text(100000, 'x');
+        text += std::string(300, 'y') + "z";
+        REQUIRE(RoundTrip(text) == text);
+    }
+
+    SECTION( "Random bytes" )
+    {
+        srand(1234);
+        std::string bytes(70000, '\0');
+        for (char& c : bytes)
+            c = (char)(rand() & 0xff);
+        std::vector<char> compressed(bytes.size());
+        size_t size = LogCompression::Compress(bytes.data(), bytes.size(), &compressed[0],
+                                               compressed.size());
+        REQUIRE(size == 0); // doesn't fit, so it'd be stored raw
+    }
+
+    SECTION( "Malformed input is rejected" )
+    {
+        char const bad[] = { 0x0f, 0x00, 0x10 }; // a match before anything has been output
+        char out[64];
+        REQUIRE(LogCompression::Decompress(bad, sizeof(bad), out, sizeof(out)) == -1);
+    }
+}
+
+TEST_CASE( "Compressed log target" )
+{
+    std::string expected;
+
+    SECTION( "Everything gets written at shutdown." )
+    {
+        {
+            CompressedLogTarget target(k_testFile, false, 4096);
+            REQUIRE(target.IsOpen());
+            for (int i = 0; i < 1000; ++i)
+            {
+                Info("Line %d of the test.", i);
+                expected += "Line " + std::to_string(i) + " of the test.\n";
+            }
+        }
+        REQUIRE(ReadBack() == expected);
+    }
+
+    SECTION( "Annotation" )
+    {
+        {
+            CompressedLogTarget target(k_testFile, true);
+            Warning("Annotated.");
+            expected = std::string(__FILE__) + "(" + std::to_string(__LINE__ - 1) + "): Annotated.\n";
+        }
+        REQUIRE(ReadBack() == expected);
+    }
+
+    SECTION( "A file that's still being written is readable." )
+    {
+        CompressedLogTarget target(k_testFile, false, 1024);
+        for (int i = 0; i < 100; ++i)
+        {
+            Error("Error %d.", i);
+            expected += "Error " + std::to_string(i) + ".\n";
+        }
+        target.Flush();
+        REQUIRE(ReadBack() == expected);
+    }
+
+    remove(k_testFile);
+}
@@ -0,0 +1,234 @@
+/**
+ * A drop-in LogTarget that writes each message to stdout or stderr with a single system call.
+ *
+ * \author Tom Plunket <tom@mightysprite.com>
+ * \copyright (c) 2019 Tom Plunket, all rights reserved
+ *
+ * Licensed under the MIT/X license. Do with these files what you will but leave this header intact.
+ *
+ * The annotation, the message and any color codes are put together in a buffer on the stack and
+ * handed to write() in one go, so messages from different threads (or processes sharing a pipe)
+ * don't get mixed up with one another; POSIX guarantees this for pipe writes up to PIPE_BUF bytes.
+ * Messages too big for the buffer go out with one writev() instead.
+ *
+ * Errors and warnings go to stderr, info and spew to stdout.
+ */
+
+#ifndef FdLogTarget_hpp
+#define FdLogTarget_hpp
+
+#include "LogTarget.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+ #include <io.h>
+ #include <cstdlib>
+#else
+ #include <sys/uio.h>
+ #include <unistd.h>
+#endif
+
+struct FdLogTarget : public LogTarget
+{
+    explicit FdLogTarget(bool annotate=false, bool colors=false) :
+        annotate(annotate),
+        colors(colors)
+    {
+        fds[k_logError] = fds[k_logWarning] = 2;
+        fds[k_logInfo] = fds[k_logSpew] = 1;
+    }
+
+    /// Send messages somewhere other than stdout and stderr.
+    FdLogTarget(int outFd, int errFd, bool annotate=false, bool colors=false) :
+        annotate(annotate),
+        colors(colors)
+    {
+        fds[k_logError] = fds[k_logWarning] = errFd;
+        fds[k_logInfo] = fds[k_logSpew] = outFd;
+    }
+
+    /// Color is usually only wanted when a person is watching.
+    static bool IsTerminal(int fd)
+    {
+#ifdef _WIN32
+        return _isatty(fd) != 0;
+#else
+        return isatty(fd) != 0;
+#endif
+    }
+
+private:
+    static size_t const k_bufferSize = 4096;
+
+    struct Color
+    {
+        char const* code;
+        size_t length;
+    };
+
+    static Color const* Colors()
+    {
+        // red, yellow, default, gray
+        static Color const k_colors[k_numLogTypes] =
+        {
+            { "\x1b[31m", 5 }, { "\x1b[33m", 5 }, { "", 0 }, { "\x1b[90m", 5 }
+        };
+        return k_colors;
+    }
+
+    void LogMessage(char const* message, LogType lt, char const* file, unsigned int line)
+    {
+        static char const k_reset[] = "\x1b[0m";
+
+        char buffer[k_bufferSize];
+        size_t length = 0;
+
+        Color const& color = Colors()[lt];
+        bool const colored = colors && (color.length > 0);
+        if (colored)
+        {
+            memcpy(buffer, color.code, color.length);
+            length = color.length;
+        }
+
+        if (annotate)
+            length += Annotation(buffer + length, k_bufferSize - length, file, line);
+
+        // the color gets reset before the newline so that it doesn't bleed into the next line
+        size_t messageLength = strlen(message);
+        bool const newline = (messageLength > 0) && (message[messageLength-1] == '\n');
+        if (newline)
+            --messageLength;
+
+        char suffix[sizeof(k_reset)];
+        size_t suffixLength = 0;
+        if (colored)
+        {
+            memcpy(suffix, k_reset, sizeof(k_reset) - 1);
+            suffixLength = sizeof(k_reset) - 1;
+        }
+        if (newline)
+            suffix[suffixLength++] = '\n';
+
+        int const fd = fds[lt];
+        if (length + messageLength + suffixLength <= k_bufferSize)
+        {
+            memcpy(buffer + length, message, messageLength);
+            length += messageLength;
+            memcpy(buffer + length, suffix, suffixLength);
+            length += suffixLength;
+            Write(fd, buffer, length);
+        }
+        else
+        {
+            WriteLong(fd, buffer, length, message, messageLength, suffix, suffixLength);
+        }
+    }
+
+    /// "file(line): " plus the thread's context tags and the sampling rate, truncated to fit.
+    static size_t Annotation(char* out, size_t room, char const* file, unsigned int line)
+    {
+        int n = snprintf(out, room, "%s(%u): ", file, line);
+        size_t length = Fit(n, room);
+
+        unsigned int numTags;
+        LogContextEntry const* tags = LogContextGet(&numTags);
+        unsigned int const sampleRate = LogSampleRate();
+        for (unsigned int i = 0; i < numTags; ++i)
+        {
+            n = snprintf(out + length, room - length, "%s%s=%s", (i == 0) ? "[" : " ",
+                         tags[i].key, tags[i].value);
+            length += Fit(n, room - length);
+        }
+        if (sampleRate > 1)
+        {
+            n = snprintf(out + length, room - length, "%ssampled=%u", (numTags == 0) ? "[" : " ",
+                         sampleRate);
+            length += Fit(n, room - length);
+        }
+        if ((numTags > 0) || (sampleRate > 1))
+            length += Fit(snprintf(out + length, room - length, "] "), room - length);
+        return length;
+    }
+
+    /// How much of snprintf's output actually made it into the buffer.
+    static size_t Fit(int n, size_t room)
+    {
+        return (n < 0) ? 0 : ((size_t)n < room) ? (size_t)n : room - 1;
+    }
+
+    static void Write(int fd, char const* p, size_t length)
+    {
+        while (length > 0)
+        {
+#ifdef _WIN32
+            int n = _write(fd, p, (unsigned int)length);
+#else
+            ssize_t n = write(fd, p, length);
+#endif
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return;
+            }
+            p += n;
+            length -= (size_t)n;
+        }
+    }
+
+    static void WriteLong(int fd, char const* prefix, size_t prefixLength,
+                          char const* message, size_t messageLength,
+                          char const* suffix, size_t suffixLength)
+    {
+#ifdef _WIN32
+        size_t const total = prefixLength + messageLength + suffixLength;
+        char* buffer = (char*)malloc(total);
+        if (buffer == nullptr)
+            return;
+        memcpy(buffer, prefix, prefixLength);
+        memcpy(buffer + prefixLength, message, messageLength);
+        memcpy(buffer + prefixLength + messageLength, suffix, suffixLength);
+        Write(fd, buffer, total);
+        free(buffer);
+#else
+        struct iovec parts[3] =
+        {
+            { (void*)prefix, prefixLength },
+            { (void*)message, messageLength },
+            { (void*)suffix, suffixLength },
+        };
+        size_t total = prefixLength + messageLength + suffixLength;
+        ssize_t n;
+        do
+        {
+            n = writev(fd, parts, 3);
+        } while ((n < 0) && (errno == EINTR));
+
+        // a short write of something this big isn't atomic anyway, so just finish it off
+        if ((n >= 0) && ((size_t)n < total))
+        {
+            size_t skip = (size_t)n;
+            for (struct iovec const& part : parts)
+            {
+                if (skip >= part.iov_len)
+                {
+                    skip -= part.iov_len;
+                    continue;
+                }
+                Write(fd, (char const*)part.iov_base + skip, part.iov_len - skip);
+                skip = 0;
+            }
+        }
+#endif
+    }
+
+    bool annotate;
+    bool colors;
+    int fds[k_numLogTypes];
+};
+
+#endif // ndef FdLogTarget_hpp
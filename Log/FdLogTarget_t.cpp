@@ -0,0 +1,97 @@
+/**
+ * Unit tests for the file descriptor log target.
+ *
+ * \author Tom Plunket <tom@mightysprite.com>
+ * \copyright (c) 2019 Tom Plunket, all rights reserved
+ *
+ * Licensed under the MIT/X license. Do with these files what you will but leave this header intact.
+ */
+
+#include "FdLogTarget.hpp"
+
+#include "Catch/Catch.hpp"
+
+#include <string>
+
+#ifndef _WIN32
+
+#include <fcntl.h>
+
+/// Read everything that's waiting in a non-blocking pipe.
+static std::string Drain(int fd)
+{
+    std::string text;
+    char buffer[1024];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+        text.append(buffer, n);
+    return text;
+}
+
+TEST_CASE( "FdLogTarget" )
+{
+    int out[2], err[2];
+    REQUIRE(pipe(out) == 0);
+    REQUIRE(pipe(err) == 0);
+    fcntl(out[0], F_SETFL, O_NONBLOCK);
+    fcntl(err[0], F_SETFL, O_NONBLOCK);
+
+    SECTION( "Routes by severity." )
+    {
+        FdLogTarget target(out[1], err[1]);
+        Info("to out");
+        Error("to err");
+        Warning("also to err");
+        Spew("also to out");
+        REQUIRE(Drain(out[0]) == "to out\nalso to out\n");
+        REQUIRE(Drain(err[0]) == "to err\nalso to err\n");
+    }
+
+    SECTION( "Annotation includes the context." )
+    {
+        FdLogTarget target(out[1], err[1], true);
+        LogContextPush("request", "42");
+        LogContextPush("tenant", "acme");
+        Info("annotated");
+        int const line = __LINE__ - 1;
+        LogContextPop();
+        LogContextPop();
+        REQUIRE(Drain(out[0]) == std::string(__FILE__) + "(" + std::to_string(line) +
+                                 "): [request=42 tenant=acme] annotated\n");
+    }
+
+    SECTION( "Annotation includes the sampling rate." )
+    {
+        FdLogTarget target(out[1], err[1], true);
+        LogContextPush("request", "42");
+        LogSetSampleRate(k_logInfo, 2);
+        for (int i = 0; i < 64; ++i)
+            Info("sampled");
+        LogSetSampleRate(k_logInfo, 1);
+        LogContextPop();
+        std::string text = Drain(out[0]);
+        REQUIRE_THAT(text, Catch::EndsWith("): [request=42 sampled=2] sampled\n"));
+    }
+
+    SECTION( "Colors are reset before the newline." )
+    {
+        FdLogTarget target(out[1], err[1], false, true);
+        Error("red");
+        Info("plain");
+        REQUIRE(Drain(err[0]) == "\x1b[31mred\x1b[0m\n");
+        REQUIRE(Drain(out[0]) == "plain\n");
+    }
+
+    SECTION( "Messages bigger than the buffer get through whole." )
+    {
+        FdLogTarget target(out[1], err[1], false, true);
+        std::string big(10000, 'q');
+        Warning("%s", big.c_str());
+        REQUIRE(Drain(err[0]) == "\x1b[33m" + big + "\x1b[0m\n");
+    }
+
+    for (int fd : { out[0], out[1], err[0], err[1] })
+        close(fd);
+}
+
+#endif // ndef _WIN32
@@ -12,18 +12,39 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <limits.h>
 
 #define k_bufferSize 256
 
+#if defined(_MSC_VER)
+#define LOG_THREAD_LOCAL __declspec(thread)
+#elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && !defined(__STDC_NO_THREADS__)
+#define LOG_THREAD_LOCAL _Thread_local
+#else
+#define LOG_THREAD_LOCAL __thread
+#endif
+
 struct LogTargetData
 {
     LogTargetFn function;
     void* data;
+    char const* name;
     struct LogTargetData* next;
 };
 static struct LogTargetData* s_logTargets = NULL;
 
+static LogFilterFn s_filter = NULL;
+static void* s_filterData = NULL;
+
+static LOG_THREAD_LOCAL LogContextEntry s_context[k_logMaxContext];
+static LOG_THREAD_LOCAL unsigned int s_contextDepth = 0;
+
+static unsigned int s_sampleRates[k_numLogTypes] = { 1, 1, 1, 1 };
+static LOG_THREAD_LOCAL unsigned int s_currentSampleRate = 1;
+static LOG_THREAD_LOCAL uint32_t s_random = 0;
+
 /**
  * Add a function to the list of functions called with logging output.
  */
@@ -46,6 +67,7 @@ void LogTargetAdd(LogTargetFn function, void* data)
         struct LogTargetData* ltd = malloc(sizeof(struct LogTargetData));
         ltd->function = function;
         ltd->data = data;
+        ltd->name = NULL;
         ltd->next = NULL;
         *p = ltd;
     }
@@ -71,20 +93,65 @@ void LogTargetRemove(LogTargetFn function, void* data)
     }
 }
 
+/**
+ * Name a log target.
+ */
+void LogTargetSetName(LogTargetFn function, void* data, char const* name)
+{
+    struct LogTargetData* ltd = s_logTargets;
+    while (ltd != NULL)
+    {
+        if ((ltd->function == function) && (ltd->data == data))
+            ltd->name = name;
+
+        ltd = ltd->next;
+    }
+}
+
+/**
+ * Install the filter; like adding targets, this is meant to be done while only one thread is
+ * logging, e.g. at startup.
+ */
+void LogSetFilter(LogFilterFn filter, void* data)
+{
+    s_filter = filter;
+    s_filterData = data;
+}
+
+/**
+ * Decide whether a message sampled at one in \c oneIn gets through. This uses a per-thread
+ * xorshift generator so that it costs a few instructions and no shared state.
+ */
+static int Sampled(unsigned int oneIn)
+{
+    if (oneIn <= 1)
+        return 1;
+
+    uint32_t x = s_random;
+    if (x == 0)
+        x = ((uint32_t)(uintptr_t)&s_random * 2654435761u) | 1;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    s_random = x;
+
+    return (((uint64_t)x * oneIn) >> 32) == 0;
+}
+
 /**
  * The primary worker for this whole deal; gets the information, formats the message, and sends it
  * out to the receivers.
  */
-void LogMessage(LogType type, const char* file, const unsigned int line, const char* message, ...)
+static void LogMessageV(LogType type, const char* file, const unsigned int line,
+                        unsigned int sampleRate, const char* message, va_list args)
 {
-    static char staticBuffer[k_bufferSize];
+    static LOG_THREAD_LOCAL char staticBuffer[k_bufferSize];
     char* tempBuffer = NULL;
     char* buffer;
 
-    va_list args;
-    va_start(args, message);
+    va_list retry;
+    va_copy(retry, args);
     int numChars = vsnprintf(staticBuffer, k_bufferSize, message, args);
-    va_end(args);
 
     if ((numChars + 1) < k_bufferSize) // make sure there's room for the newline added below
     {
@@ -93,24 +160,28 @@ void LogMessage(LogType type, const char* file, const unsigned int line, const c
     else
     {
         tempBuffer = malloc(numChars + 2); // leave space for a possible newline
-        va_start(args, message);
-        vsnprintf(tempBuffer, numChars + 1, message, args);
-        va_end(args);
+        vsnprintf(tempBuffer, numChars + 1, message, retry);
         buffer = tempBuffer;
     }
+    va_end(retry);
 
     //printf("numChars: %d\nmessage: %s\n", numChars, buffer);
 
-    if (buffer[numChars-1] != '\n')
+    if ((numChars == 0) || (buffer[numChars-1] != '\n'))
     {
         buffer[numChars] = '\n';
         buffer[numChars+1] = 0;
     }
 
+    s_currentSampleRate = sampleRate;
+
+    LogFilterFn const filter = s_filter;
     struct LogTargetData* ltd = s_logTargets;
     while (ltd != NULL)
     {
-        if (ltd->function != NULL)
+        if ((ltd->function != NULL) &&
+            ((filter == NULL) || (ltd->name == NULL) ||
+             filter(type, file, ltd->name, s_filterData)))
         {
             ltd->function(buffer, type, file, line, ltd->data);
         }
@@ -118,6 +189,8 @@ void LogMessage(LogType type, const char* file, const unsigned int line, const c
         ltd = ltd->next;
     }
 
+    s_currentSampleRate = 1;
+
     if (tempBuffer != NULL)
     {
         free(tempBuffer);
@@ -125,3 +198,94 @@ void LogMessage(LogType type, const char* file, const unsigned int line, const c
     }
 }
 
+/**
+ * Log a message, subject to the sampling rate set for its type.
+ */
+void LogMessage(LogType type, const char* file, const unsigned int line, const char* message, ...)
+{
+    LogFilterFn const filter = s_filter;
+    if ((filter != NULL) && !filter(type, file, NULL, s_filterData))
+        return;
+
+    unsigned int const sampleRate = s_sampleRates[type];
+    if (!Sampled(sampleRate))
+        return;
+
+    va_list args;
+    va_start(args, message);
+    LogMessageV(type, file, line, (sampleRate > 1) ? sampleRate : 1, message, args);
+    va_end(args);
+}
+
+/**
+ * Log one in \c oneIn of the messages that come through here, on top of the rate for the type.
+ */
+void LogMessageSampled(unsigned int oneIn, LogType type, const char* file, const unsigned int line,
+                       const char* message, ...)
+{
+    LogFilterFn const filter = s_filter;
+    if ((filter != NULL) && !filter(type, file, NULL, s_filterData))
+        return;
+
+    unsigned int sampleRate = (oneIn > 1) ? oneIn : 1;
+    if (s_sampleRates[type] > 1)
+    {
+        sampleRate = (sampleRate <= UINT_MAX / s_sampleRates[type]) ?
+            sampleRate * s_sampleRates[type] : UINT_MAX;
+    }
+    if (!Sampled(sampleRate))
+        return;
+
+    va_list args;
+    va_start(args, message);
+    LogMessageV(type, file, line, sampleRate, message, args);
+    va_end(args);
+}
+
+/**
+ * Set the sampling rate for one type of message.
+ */
+void LogSetSampleRate(LogType type, unsigned int oneIn)
+{
+    if ((unsigned int)type < k_numLogTypes)
+        s_sampleRates[type] = (oneIn > 1) ? oneIn : 1;
+}
+
+/**
+ * Get the sampling rate of the message being logged.
+ */
+unsigned int LogSampleRate(void)
+{
+    return s_currentSampleRate;
+}
+
+/**
+ * Add a tag to the calling thread's context.
+ */
+void LogContextPush(char const* key, char const* value)
+{
+    if (s_contextDepth < k_logMaxContext)
+    {
+        s_context[s_contextDepth].key = key;
+        s_context[s_contextDepth].value = value;
+    }
+    ++s_contextDepth;
+}
+
+/**
+ * Remove the most recently pushed tag from the calling thread's context.
+ */
+void LogContextPop(void)
+{
+    if (s_contextDepth > 0)
+        --s_contextDepth;
+}
+
+/**
+ * Get the calling thread's context tags.
+ */
+LogContextEntry const* LogContextGet(unsigned int* count)
+{
+    *count = (s_contextDepth < k_logMaxContext) ? s_contextDepth : k_logMaxContext;
+    return s_context;
+}
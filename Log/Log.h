@@ -31,6 +31,18 @@ extern "C" {
 #define Info(...)     LogMessage(k_logInfo,    __FILE__, __LINE__, __VA_ARGS__)
 #define Spew(...)     LogMessage(k_logSpew,    __FILE__, __LINE__, __VA_ARGS__)
 
+/**
+ * Sampled variants, for hot paths where every message would be too many but none would be too few.
+ * Each one logs about one in \c oneIn of the times it's reached, chosen at random, and the decision
+ * is made before any formatting happens.
+ *
+ * <code>SpewSampled(100, "Packet %u from %s.", seq, peer);</code>
+ */
+#define ErrorSampled(oneIn, ...)    LogMessageSampled(oneIn, k_logError,   __FILE__, __LINE__, __VA_ARGS__)
+#define WarningSampled(oneIn, ...)  LogMessageSampled(oneIn, k_logWarning, __FILE__, __LINE__, __VA_ARGS__)
+#define InfoSampled(oneIn, ...)     LogMessageSampled(oneIn, k_logInfo,    __FILE__, __LINE__, __VA_ARGS__)
+#define SpewSampled(oneIn, ...)     LogMessageSampled(oneIn, k_logSpew,    __FILE__, __LINE__, __VA_ARGS__)
+
 /**
  * This enumeration is used by the above macros to feed to the LogMessage function to indicate the
  * severity of the message. Different targets may choose to respond differently to the different
@@ -55,8 +67,62 @@ typedef void(*LogTargetFn)(char const* m, LogType lt, char const* file, unsigned
 void LogTargetAdd(LogTargetFn function, void* data);
 void LogTargetRemove(LogTargetFn function, void* data);
 
+/**
+ * Give a Log Target a name, so that filters (e.g. LogConfig.hpp) can treat it differently from the
+ * others. The string isn't copied.
+ */
+void LogTargetSetName(LogTargetFn function, void* data, char const* name);
+
+/**
+ * A filter decides which messages get logged. It's called with \c target NULL before a message is
+ * formatted, and returning zero drops the message entirely; it's then called again for each named
+ * Log Target to decide whether that target gets the message. Only one filter is installed at a
+ * time, and NULL removes it.
+ */
+typedef int(*LogFilterFn)(LogType lt, char const* file, char const* target, void* d);
+void LogSetFilter(LogFilterFn filter, void* data);
+
 /// Log one message; normally this function won't be called directly
 void LogMessage(LogType type, char const* file, const unsigned int line, char const* message, ...);
+void LogMessageSampled(unsigned int oneIn, LogType type, char const* file, const unsigned int line,
+                       char const* message, ...);
+
+/**
+ * Sampling by severity; e.g. LogSetSampleRate(k_logSpew, 1000) keeps about one Spew in a thousand.
+ * This applies to all messages of that type, and multiplies with the rate given to the sampled
+ * macros. A rate of 0 or 1 logs everything, which is the default.
+ */
+void LogSetSampleRate(LogType type, unsigned int oneIn);
+
+/**
+ * For targets; the sampling rate of the message being logged, so that counts can be scaled back up
+ * downstream. 1 when the message wasn't sampled.
+ */
+unsigned int LogSampleRate(void);
+
+/**
+ * Context tags, e.g. a request id or the tenant being served, that apply to every message logged
+ * on a thread without having to pass them to each Error()/Info()/etc. Each thread has a fixed size
+ * stack of key/value pairs which targets can look at from inside their callbacks.
+ *
+ * Pushing and popping just store the pointers; nothing is copied or formatted, so the strings must
+ * stay put until they're popped. Pushes beyond k_logMaxContext are counted (so that pops still
+ * match up) but not stored.
+ */
+#define k_logMaxContext 16
+
+struct LogContextEntry_
+{
+    char const* key;
+    char const* value;
+};
+typedef struct LogContextEntry_ LogContextEntry;
+
+void LogContextPush(char const* key, char const* value);
+void LogContextPop(void);
+
+/// The calling thread's context, outermost first; \c count gets the number of entries.
+LogContextEntry const* LogContextGet(unsigned int* count);
 
 #if __cplusplus
 } // extern "C"
@@ -0,0 +1,301 @@
+/**
+ * A small LZ77 block codec and the self-delimiting block format used for compressed log files.
+ *
+ * \author Tom Plunket <tom@mightysprite.com>
+ * \copyright (c) 2019 Tom Plunket, all rights reserved
+ *
+ * Licensed under the MIT/X license. Do with these files what you will but leave this header intact.
+ *
+ * The codec is in the spirit of LZ4: a greedy matcher with a small hash table, trading compression
+ * ratio for speed. Log text is repetitive enough that it still usually shrinks by 4-8x.
+ *
+ * A compressed stream is a sequence of sequences, each of which is:
+ *
+ *     token: the high nibble is the literal count, the low nibble is the match length minus 4. A
+ *            nibble of 15 means that more bytes follow, each added to the count, until one that
+ *            isn't 255.
+ *     literals: copied to the output verbatim.
+ *     offset: 16 bits, little endian, how far back the match starts.
+ *     (match length continuation bytes, if any.)
+ *
+ * The last sequence has only literals; the decoder knows it's the last because the input ends.
+ *
+ * A compressed file is a series of blocks, each a BlockHeader followed by its data, so a file that
+ * was cut off mid-write is readable up to the last complete block.
+ */
+
+#ifndef LogCompression_hpp
+#define LogCompression_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace LogCompression
+{
+    static uint32_t const k_blockMagic = 0x4b425a4c;   // "LZBK"
+
+    struct BlockHeader
+    {
+        uint32_t magic;
+        uint32_t rawSize;
+        uint32_t storedSize;    ///< equal to rawSize when the block didn't compress and is stored raw
+        uint32_t checksum;      ///< of the raw data
+    };
+
+    /// FNV-1a, to tell a damaged block from a good one.
+    inline uint32_t Checksum(char const* data, size_t size)
+    {
+        uint32_t h = 2166136261u;
+        for (size_t i = 0; i < size; ++i)
+            h = (h ^ (uint8_t)data[i]) * 16777619u;
+        return h;
+    }
+
+    namespace Detail
+    {
+        static int const k_hashBits = 12;
+        static size_t const k_minMatch = 4;
+        static size_t const k_maxOffset = 65535;
+
+        inline uint32_t Read32(uint8_t const* p)
+        {
+            uint32_t v;
+            memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        inline uint32_t Hash(uint32_t v) { return (v * 2654435761u) >> (32 - k_hashBits); }
+
+        /// Write a 4 bit count's continuation bytes.
+        inline bool PutLength(uint8_t*& op, uint8_t const* end, size_t length)
+        {
+            if (length < 15)
+                return true;
+            length -= 15;
+            while (length >= 255)
+            {
+                if (op >= end)
+                    return false;
+                *op++ = 255;
+                length -= 255;
+            }
+            if (op >= end)
+                return false;
+            *op++ = (uint8_t)length;
+            return true;
+        }
+
+        inline bool GetLength(uint8_t const*& ip, uint8_t const* end, size_t& length)
+        {
+            if (length < 15)
+                return true;
+            uint8_t b;
+            do
+            {
+                if (ip >= end)
+                    return false;
+                b = *ip++;
+                length += b;
+            } while (b == 255);
+            return true;
+        }
+
+        inline bool PutSequence(uint8_t*& op, uint8_t const* end, uint8_t const* literals,
+                                size_t numLiterals, size_t offset, size_t matchLength)
+        {
+            if (op >= end)
+                return false;
+            size_t const m = (matchLength > 0) ? matchLength - k_minMatch : 0;
+            *op++ = (uint8_t)(((numLiterals < 15) ? numLiterals : 15) << 4 | ((m < 15) ? m : 15));
+            if (!PutLength(op, end, numLiterals) || ((size_t)(end - op) < numLiterals))
+                return false;
+            memcpy(op, literals, numLiterals);
+            op += numLiterals;
+
+            if (matchLength == 0)
+                return true;
+            if (end - op < 2)
+                return false;
+            *op++ = (uint8_t)(offset & 0xff);
+            *op++ = (uint8_t)(offset >> 8);
+            return PutLength(op, end, m);
+        }
+    }
+
+    /**
+     * Compress \c size bytes into \c out, which has room for \c capacity bytes. Returns the
+     * compressed size, or zero if it doesn't fit (in which case the data is best stored raw).
+     */
+    inline size_t Compress(char const* in, size_t size, char* out, size_t capacity)
+    {
+        using namespace Detail;
+
+        uint32_t table[1 << k_hashBits];
+        memset(table, 0xff, sizeof(table));
+
+        uint8_t const* const base = (uint8_t const*)in;
+        uint8_t* op = (uint8_t*)out;
+        uint8_t const* const opEnd = op + capacity;
+
+        size_t anchor = 0;
+        size_t ip = 0;
+        while (ip + k_minMatch <= size)
+        {
+            uint32_t const v = Read32(base + ip);
+            uint32_t const h = Hash(v);
+            size_t const ref = table[h];
+            table[h] = (uint32_t)ip;
+
+            if ((ref < ip) && (ip - ref <= k_maxOffset) && (Read32(base + ref) == v))
+            {
+                size_t length = k_minMatch;
+                while ((ip + length < size) && (base[ref + length] == base[ip + length]))
+                    ++length;
+
+                if (!PutSequence(op, opEnd, base + anchor, ip - anchor, ip - ref, length))
+                    return 0;
+                ip += length;
+                anchor = ip;
+            }
+            else
+            {
+                ++ip;
+            }
+        }
+
+        if (!PutSequence(op, opEnd, base + anchor, size - anchor, 0, 0))
+            return 0;
+        return op - (uint8_t*)out;
+    }
+
+    /**
+     * Decompress \c size bytes into \c out. Returns the decompressed size, or -1 if the data is
+     * malformed or doesn't fit in \c capacity bytes.
+     */
+    inline long Decompress(char const* in, size_t size, char* out, size_t capacity)
+    {
+        using namespace Detail;
+
+        uint8_t const* ip = (uint8_t const*)in;
+        uint8_t const* const ipEnd = ip + size;
+        uint8_t* op = (uint8_t*)out;
+        uint8_t* const opStart = op;
+        uint8_t const* const opEnd = op + capacity;
+
+        while (ip < ipEnd)
+        {
+            uint8_t const token = *ip++;
+
+            size_t numLiterals = token >> 4;
+            if (!GetLength(ip, ipEnd, numLiterals) ||
+                ((size_t)(ipEnd - ip) < numLiterals) || ((size_t)(opEnd - op) < numLiterals))
+            {
+                return -1;
+            }
+            memcpy(op, ip, numLiterals);
+            ip += numLiterals;
+            op += numLiterals;
+
+            if (ip == ipEnd)
+                break;
+
+            if (ipEnd - ip < 2)
+                return -1;
+            size_t const offset = ip[0] | (ip[1] << 8);
+            ip += 2;
+            size_t length = token & 15;
+            if (!GetLength(ip, ipEnd, length))
+                return -1;
+            length += k_minMatch;
+            if ((offset == 0) || (offset > (size_t)(op - opStart)) ||
+                ((size_t)(opEnd - op) < length))
+            {
+                return -1;
+            }
+
+            // the match may overlap what it's producing, so this has to go a byte at a time
+            uint8_t const* match = op - offset;
+            for (size_t i = 0; i < length; ++i)
+                op[i] = match[i];
+            op += length;
+        }
+
+        return (long)(op - opStart);
+    }
+
+    /**
+     * Compress \c size bytes and write them as one block. \c scratch is reused between calls.
+     */
+    inline bool WriteBlock(FILE* file, char const* data, size_t size, std::vector<char>& scratch)
+    {
+        if (scratch.size() < size)
+            scratch.resize(size);
+
+        BlockHeader header = { k_blockMagic, (uint32_t)size, 0, Checksum(data, size) };
+        size_t compressed = (size > 0) ? Compress(data, size, &scratch[0], size) : 0;
+        char const* stored = data;
+        header.storedSize = (uint32_t)size;
+        if ((compressed > 0) && (compressed < size))
+        {
+            stored = &scratch[0];
+            header.storedSize = (uint32_t)compressed;
+        }
+
+        return (fwrite(&header, sizeof(header), 1, file) == 1) &&
+               (fwrite(stored, 1, header.storedSize, file) == header.storedSize);
+    }
+
+    /**
+     * Compress everything from \c in into blocks of up to \c blockSize bytes.
+     */
+    inline bool CompressFile(FILE* in, FILE* out, size_t blockSize)
+    {
+        std::vector<char> block(blockSize), scratch(blockSize);
+        size_t size;
+        while ((size = fread(&block[0], 1, blockSize, in)) > 0)
+        {
+            if (!WriteBlock(out, &block[0], size, scratch))
+                return false;
+        }
+        return ferror(in) == 0;
+    }
+
+    /**
+     * Decompress a whole file of blocks into \c out, stopping quietly at a block that was only
+     * partly written. Returns false if a complete block is damaged.
+     */
+    inline bool DecompressFile(FILE* in, FILE* out)
+    {
+        std::vector<char> stored, raw;
+        BlockHeader header;
+        while (fread(&header, sizeof(header), 1, in) == 1)
+        {
+            if ((header.magic != k_blockMagic) || (header.storedSize > header.rawSize))
+                return false;
+
+            stored.resize(header.storedSize + 1);
+            raw.resize(header.rawSize + 1);
+            if (fread(&stored[0], 1, header.storedSize, in) != header.storedSize)
+                return true;    // cut off mid-block
+
+            char const* data = &stored[0];
+            if (header.storedSize < header.rawSize)
+            {
+                long size = Decompress(&stored[0], header.storedSize, &raw[0], header.rawSize);
+                if (size != (long)header.rawSize)
+                    return false;
+                data = &raw[0];
+            }
+
+            if (Checksum(data, header.rawSize) != header.checksum)
+                return false;
+            fwrite(data, 1, header.rawSize, out);
+        }
+        return true;
+    }
+}
+
+#endif // ndef LogCompression_hpp
@@ -0,0 +1,438 @@
+/**
+ * Runtime configuration of which messages get logged, read from a file that's watched for changes.
+ *
+ * \author Tom Plunket <tom@mightysprite.com>
+ * \copyright (c) 2019 Tom Plunket, all rights reserved
+ *
+ * Licensed under the MIT/X license. Do with these files what you will but leave this header intact.
+ *
+ * <code>LogConfig config("logging.conf");</code>
+ *
+ * ...installs a filter (see LogSetFilter()) driven by the file, and reloads the file whenever it
+ * changes. The file looks like this:
+ *
+ *     # The most verbose severity to log: error, warning, info, spew, or none.
+ *     level = info
+ *
+ *     # Per-target levels, for targets named with LogTargetSetName() or LogTarget::SetName().
+ *     # These can only make a target quieter: a message the level above (or a file's level)
+ *     # drops is dropped before it's formatted, so no target sees it.
+ *     level.console = warning
+ *
+ *     # Levels for messages from matching source files; the first match wins. '*' matches anything,
+ *     # including slashes, and '?' matches any one character.
+ *     file.*net/Socket.cpp = spew
+ *
+ *     # At most this many messages per second get logged; 0 or leaving it out means no limit.
+ *     ratelimit = 1000
+ *
+ * Each load builds a new immutable snapshot of the settings and publishes it with one atomic store,
+ * so logging threads never take a lock; they just load the current pointer. Old snapshots are kept
+ * until the LogConfig is destroyed because there's no telling whether some thread is still looking
+ * at one, but that's a few hundred bytes per reload. If the file can't be read or has mistakes in
+ * it, the previous settings stay in effect. Until the file is first loaded everything is logged.
+ *
+ * On Linux the file is watched with inotify; elsewhere its modification time is checked once a
+ * second. As with log targets, destroy the LogConfig only once other threads are done logging.
+ */
+
+#ifndef LogConfig_hpp
+#define LogConfig_hpp
+
+#include "Log.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+#ifdef __linux__
+ #include <poll.h>
+ #include <sys/inotify.h>
+ #include <unistd.h>
+#endif
+
+class LogConfig
+{
+public:
+    explicit LogConfig(char const* path, bool watch=true) :
+        path(path),
+        rateWindow(0),
+        rateCount(0)
+    {
+        Publish(new Snapshot());
+        Reload();
+        LogSetFilter(&Filter, this);
+
+        if (watch)
+            StartWatching();
+    }
+
+    ~LogConfig()
+    {
+        StopWatching();
+        LogSetFilter(nullptr, nullptr);
+    }
+
+    /// Read the file again. Returns false, leaving the old settings in place, if that fails.
+    bool Reload()
+    {
+        std::lock_guard<std::mutex> lock(loadMutex);
+
+        FILE* f = fopen(path.c_str(), "r");
+        if (f == nullptr)
+            return false;
+
+        std::unique_ptr<Snapshot> s(new Snapshot());
+        bool ok = true;
+        char buffer[1024];
+        for (int lineNumber = 1; fgets(buffer, sizeof(buffer), f) != nullptr; ++lineNumber)
+            ok &= ParseLine(s.get(), buffer, lineNumber);
+        fclose(f);
+
+        if (!ok)
+            return false;
+        Publish(s.release());
+        return true;
+    }
+
+private:
+    LogConfig(LogConfig const&);
+    LogConfig& operator=(LogConfig const&);
+
+    static int const k_none = -1;
+
+    typedef std::vector<std::pair<std::string, int>> Rules;
+
+    struct Snapshot
+    {
+        Snapshot() : level(k_logSpew), rateLimit(0), generation(NextGeneration()) {}
+
+        int level;                  ///< the most verbose LogType that gets through, or k_none
+        Rules files;
+        Rules targets;
+        unsigned int rateLimit;
+        unsigned int generation;    ///< distinguishes snapshots for the per-thread cache
+    };
+
+    static unsigned int NextGeneration()
+    {
+        static std::atomic<unsigned int> s_generation(0);
+        return ++s_generation;
+    }
+
+    void Publish(Snapshot* s)
+    {
+        snapshots.emplace_back(s);
+        current.store(s, std::memory_order_release);
+    }
+
+    /// The LogFilterFn; this is the hot path, so no locks and usually no string work.
+    static int Filter(LogType lt, char const* file, char const* target, void* d)
+    {
+        LogConfig* config = (LogConfig*)d;
+        Snapshot const* s = config->current.load(std::memory_order_acquire);
+
+        if (target != nullptr)
+        {
+            for (auto const& rule : s->targets)
+            {
+                if (rule.first == target)
+                    return (int)lt <= rule.second;
+            }
+            return 1;
+        }
+
+        if ((int)lt > FileLevel(s, file))
+            return 0;
+        return (s->rateLimit == 0) || config->UnderRateLimit(s->rateLimit);
+    }
+
+    static int FileLevel(Snapshot const* s, char const* file)
+    {
+        if (s->files.empty())
+            return s->level;
+
+        // Matching globs for every message would add up, but each call site passes the same
+        // __FILE__ pointer every time, so remember the answer per thread.
+        struct CacheEntry
+        {
+            unsigned int generation;
+            char const* file;
+            int level;
+        };
+        static thread_local CacheEntry t_cache[64];
+
+        CacheEntry& entry = t_cache[((uintptr_t)file >> 3) & 63];
+        if ((entry.generation == s->generation) && (entry.file == file))
+            return entry.level;
+
+        int level = s->level;
+        for (auto const& rule : s->files)
+        {
+            if (GlobMatch(rule.first.c_str(), file))
+            {
+                level = rule.second;
+                break;
+            }
+        }
+
+        entry.generation = s->generation;
+        entry.file = file;
+        entry.level = level;
+        return level;
+    }
+
+    bool UnderRateLimit(unsigned int limit)
+    {
+        using namespace std::chrono;
+        int64_t const now = duration_cast<seconds>(steady_clock::now().time_since_epoch()).count();
+        int64_t window = rateWindow.load(std::memory_order_relaxed);
+        if ((now != window) && rateWindow.compare_exchange_strong(window, now))
+            rateCount.store(0, std::memory_order_relaxed);
+        return rateCount.fetch_add(1, std::memory_order_relaxed) < limit;
+    }
+
+    static bool GlobMatch(char const* pattern, char const* text)
+    {
+        char const* star = nullptr;
+        char const* resume = nullptr;
+        while (*text != '\0')
+        {
+            if ((*pattern == '?') || ((*pattern != '*') && (*pattern == *text)))
+            {
+                ++pattern;
+                ++text;
+            }
+            else if (*pattern == '*')
+            {
+                star = pattern++;
+                resume = text;
+            }
+            else if (star != nullptr)
+            {
+                pattern = star + 1;
+                text = ++resume;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        while (*pattern == '*')
+            ++pattern;
+        return *pattern == '\0';
+    }
+
+    static std::string Trim(std::string const& s)
+    {
+        size_t start = s.find_first_not_of(" \t\r\n");
+        if (start == std::string::npos)
+            return std::string();
+        return s.substr(start, s.find_last_not_of(" \t\r\n") - start + 1);
+    }
+
+    static bool ParseLevel(std::string const& name, int* level)
+    {
+        static char const* const k_names[k_numLogTypes] = { "error", "warning", "info", "spew" };
+        for (unsigned int i = 0; i < k_numLogTypes; ++i)
+        {
+            if (name == k_names[i])
+            {
+                *level = (int)i;
+                return true;
+            }
+        }
+        if (name == "none")
+        {
+            *level = k_none;
+            return true;
+        }
+        return false;
+    }
+
+    bool ParseLine(Snapshot* s, char const* text, int lineNumber)
+    {
+        std::string line = text;
+        line = Trim(line.substr(0, line.find('#')));
+        if (line.empty())
+            return true;
+
+        size_t equals = line.find('=');
+        if (equals == std::string::npos)
+        {
+            Warning("%s(%d): expected 'setting = value'.", path.c_str(), lineNumber);
+            return false;
+        }
+        std::string const key = Trim(line.substr(0, equals));
+        std::string const value = Trim(line.substr(equals + 1));
+
+        if (key == "ratelimit")
+        {
+            char* end;
+            unsigned long limit = strtoul(value.c_str(), &end, 10);
+            if (value.empty() || (*end != '\0'))
+            {
+                Warning("%s(%d): '%s' isn't a number of messages per second.", path.c_str(),
+                        lineNumber, value.c_str());
+                return false;
+            }
+            s->rateLimit = (unsigned int)limit;
+            return true;
+        }
+
+        int level;
+        if (!ParseLevel(value, &level))
+        {
+            Warning("%s(%d): '%s' isn't a log level.", path.c_str(), lineNumber, value.c_str());
+            return false;
+        }
+
+        if (key == "level")
+            s->level = level;
+        else if (key.compare(0, 6, "level.") == 0)
+            s->targets.push_back(std::make_pair(key.substr(6), level));
+        else if (key.compare(0, 5, "file.") == 0)
+            s->files.push_back(std::make_pair(key.substr(5), level));
+        else
+        {
+            Warning("%s(%d): unknown setting '%s'.", path.c_str(), lineNumber, key.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    /// Something that changes when the file does; the size too since mtime is only to the second.
+    std::pair<int64_t, int64_t> Stamp() const
+    {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0)
+            return std::make_pair(0, 0);
+        return std::make_pair((int64_t)st.st_mtime, (int64_t)st.st_size);
+    }
+
+#ifdef __linux__
+    void StartWatching()
+    {
+        size_t slash = path.find_last_of('/');
+        std::string const directory = (slash == std::string::npos) ? "." : path.substr(0, slash + 1);
+        std::string const name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+
+        inotifyFd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+        if ((inotifyFd < 0) ||
+            (inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) ||
+            (pipe(wakeFds) != 0))
+        {
+            Warning("Couldn't watch %s for changes.", path.c_str());
+            if (inotifyFd >= 0)
+                close(inotifyFd);
+            inotifyFd = -1;
+            return;
+        }
+
+        watcher = std::thread([this, name]
+        {
+            for (;;)
+            {
+                struct pollfd fds[2] = { { inotifyFd, POLLIN, 0 }, { wakeFds[0], POLLIN, 0 } };
+                if ((poll(fds, 2, -1) < 0) || (fds[1].revents != 0))
+                    break;
+
+                // editors tend to write a new file and rename it over the old one, so look for
+                // either a write or a rename landing on the name
+                bool changed = false;
+                alignas(struct inotify_event) char events[4096];
+                ssize_t n;
+                while ((n = read(inotifyFd, events, sizeof(events))) > 0)
+                {
+                    for (char const* p = events; p < events + n; )
+                    {
+                        struct inotify_event const* e = (struct inotify_event const*)p;
+                        if ((e->len > 0) && (name == e->name))
+                            changed = true;
+                        p += sizeof(struct inotify_event) + e->len;
+                    }
+                }
+                if (changed)
+                    Reload();
+            }
+        });
+    }
+
+    void StopWatching()
+    {
+        if (inotifyFd < 0)
+            return;
+        char const wake = 0;
+        if (write(wakeFds[1], &wake, 1) == 1)
+            watcher.join();
+        else
+            watcher.detach();
+        close(inotifyFd);
+        close(wakeFds[0]);
+        close(wakeFds[1]);
+        inotifyFd = -1;
+    }
+
+    int inotifyFd = -1;
+    int wakeFds[2];
+#else
+    void StartWatching()
+    {
+        watcher = std::thread([this]
+        {
+            std::pair<int64_t, int64_t> last = Stamp();
+            std::unique_lock<std::mutex> lock(quitMutex);
+            while (!quitSignal.wait_for(lock, std::chrono::seconds(1), [this] { return quit; }))
+            {
+                std::pair<int64_t, int64_t> stamp = Stamp();
+                if (stamp != last)
+                {
+                    last = stamp;
+                    lock.unlock();
+                    Reload();
+                    lock.lock();
+                }
+            }
+        });
+    }
+
+    void StopWatching()
+    {
+        if (!watcher.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(quitMutex);
+            quit = true;
+        }
+        quitSignal.notify_all();
+        watcher.join();
+    }
+
+    std::mutex quitMutex;
+    std::condition_variable quitSignal;
+    bool quit = false;
+#endif
+
+    std::string const path;
+
+    std::atomic<Snapshot const*> current;
+    std::vector<std::unique_ptr<Snapshot const>> snapshots;
+    std::mutex loadMutex;
+
+    std::atomic<int64_t> rateWindow;
+    std::atomic<unsigned int> rateCount;
+
+    std::thread watcher;
+};
+
+#endif // ndef LogConfig_hpp
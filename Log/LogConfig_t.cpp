@@ -0,0 +1,146 @@
+/**
+ * Unit tests for runtime log configuration.
+ *
+ * \author Tom Plunket <tom@mightysprite.com>
+ * \copyright (c) 2019 Tom Plunket, all rights reserved
+ *
+ * Licensed under the MIT/X license. Do with these files what you will but leave this header intact.
+ */
+
+#include "LogConfig.hpp"
+#include "LogTarget.hpp"
+
+#include "Catch/Catch.hpp"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+static char const* const k_configFile = "LogConfig_t.conf";
+
+static void WriteConfig(char const* text)
+{
+    FILE* f = fopen(k_configFile, "w");
+    REQUIRE(f != nullptr);
+    fputs(text, f);
+    fclose(f);
+}
+
+namespace
+{
+    struct CollectingTarget : public LogTarget
+    {
+        std::vector<std::string> messages;
+
+        void LogMessage(char const* m, LogType, char const*, unsigned int) override
+        {
+            messages.push_back(m);
+        }
+    };
+}
+
+TEST_CASE( "LogConfig" )
+{
+    CollectingTarget target;
+
+    SECTION( "Everything gets through until there's a file." )
+    {
+        remove(k_configFile);
+        LogConfig config(k_configFile, false);
+        Spew("spew");
+        REQUIRE(target.messages.size() == 1);
+    }
+
+    SECTION( "The global level." )
+    {
+        WriteConfig("# only the important stuff\nlevel = warning\n");
+        LogConfig config(k_configFile, false);
+        Error("error");
+        Warning("warning");
+        Info("info");
+        Spew("spew");
+        REQUIRE(target.messages == std::vector<std::string>({ "error\n", "warning\n" }));
+    }
+
+    SECTION( "File globs, first match wins." )
+    {
+        WriteConfig("level = none\nfile.*LogConfig_?.cpp = info\nfile.* = spew\n");
+        LogConfig config(k_configFile, false);
+        Info("info");
+        Spew("spew");
+        LogMessage(k_logSpew, "elsewhere.c", 1, "elsewhere");
+        REQUIRE(target.messages == std::vector<std::string>({ "info\n", "elsewhere\n" }));
+    }
+
+    SECTION( "Named targets get their own level." )
+    {
+        CollectingTarget quiet;
+        quiet.SetName("quiet");
+        WriteConfig("level = spew\nlevel.quiet = error\n");
+        LogConfig config(k_configFile, false);
+        Info("info");
+        Error("error");
+        REQUIRE(target.messages.size() == 2);
+        REQUIRE(quiet.messages == std::vector<std::string>({ "error\n" }));
+    }
+
+    SECTION( "A target's level can't get it more than the global level lets through." )
+    {
+        CollectingTarget chatty;
+        chatty.SetName("chatty");
+        WriteConfig("level = warning\nlevel.chatty = spew\n");
+        LogConfig config(k_configFile, false);
+        Info("info");
+        Warning("warning");
+        REQUIRE(target.messages == std::vector<std::string>({ "warning\n" }));
+        REQUIRE(chatty.messages == std::vector<std::string>({ "warning\n" }));
+    }
+
+    SECTION( "Rate limiting." )
+    {
+        WriteConfig("ratelimit = 10\n");
+        LogConfig config(k_configFile, false);
+        for (int i = 0; i < 100; ++i)
+            Info("flood");
+        // the second could tick over partway through
+        REQUIRE(target.messages.size() >= 10);
+        REQUIRE(target.messages.size() <= 20);
+    }
+
+    SECTION( "Reloading, and a bad file keeps the old settings." )
+    {
+        WriteConfig("level = error\n");
+        LogConfig config(k_configFile, false);
+        Info("dropped");
+
+        WriteConfig("level = info\n");
+        REQUIRE(config.Reload());
+        Info("kept");
+
+        WriteConfig("level = loud\n");
+        REQUIRE(!config.Reload());
+        Info("still kept");
+        Spew("still dropped");
+
+        REQUIRE(target.messages == std::vector<std::string>({
+            "kept\n", "LogConfig_t.conf(1): 'loud' isn't a log level.\n", "still kept\n" }));
+    }
+
+    SECTION( "Changes are picked up on their own." )
+    {
+        WriteConfig("level = error\n");
+        LogConfig config(k_configFile);
+        WriteConfig("level = info\n");
+
+        // the watcher reloads on its own thread, so give it a moment
+        for (int i = 0; (i < 300) && target.messages.empty(); ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            Info("hello");
+        }
+        REQUIRE(!target.messages.empty());
+    }
+
+    remove(k_configFile);
+}
@@ -0,0 +1,32 @@
+/**
+ * A C++ helper that keeps a Log context tag in place for the duration of a scope.
+ *
+ * \author Tom Plunket <tom@mightysprite.com>
+ * \copyright (c) 2019 Tom Plunket, all rights reserved
+ *
+ * Licensed under the MIT/X license. Do with these files what you will but leave this header intact.
+ */
+
+#ifndef LogContext_hpp
+#define LogContext_hpp
+
+#include "Log.h"
+
+/**
+ * <code>LogContext requestContext("request", request.id);</code>
+ *
+ * ...and every message logged on this thread until requestContext goes out of scope carries the
+ * request id. As with LogContextPush() the strings aren't copied so they have to outlive the object.
+ */
+class LogContext
+{
+public:
+    LogContext(char const* key, char const* value) { LogContextPush(key, value); }
+    ~LogContext() { LogContextPop(); }
+
+private:
+    LogContext(LogContext const&);
+    LogContext& operator=(LogContext const&);
+};
+
+#endif // ndef LogContext_hpp
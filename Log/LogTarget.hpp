@@ -18,6 +18,20 @@ public:
     LogTarget() { LogTargetAdd(&Trampoline, this); }
     ~LogTarget() { LogTargetRemove(&Trampoline, this); }
 
+    /// Name the target so that filters such as LogConfig can pick it out.
+    void SetName(char const* name) { LogTargetSetName(&Trampoline, this, name); }
+
+    /**
+     * Stop getting messages straight from Log, for when something else (e.g. NumaLogQueue) will be
+     * passing them along by calling the returned function with \c *data.
+     */
+    LogTargetFn Detach(void** data)
+    {
+        LogTargetRemove(&Trampoline, this);
+        *data = this;
+        return &Trampoline;
+    }
+
 private:
     virtual void LogMessage(char const* message, LogType lt,
                             char const* file, unsigned int line) = 0;
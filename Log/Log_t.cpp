@@ -12,6 +12,8 @@
 #define CATCH_CONFIG_MAIN
 #include "Catch/Catch.hpp"
 
+#include <thread>
+
 #ifdef _MSC_VER
 #define strncpy strncpy_s
 #endif
@@ -160,3 +162,138 @@ TEST_CASE( "Test the actual log messages returned" )
 
     LogTargetRemove(targetFunction, &data);
 }
+
+TEST_CASE( "Thread context" )
+{
+    unsigned int count = 99;
+    LogContextEntry const* context = LogContextGet(&count);
+    REQUIRE(count == 0);
+
+    SECTION( "Push and pop" )
+    {
+        LogContextPush("request", "1234");
+        LogContextPush("tenant", "acme");
+        context = LogContextGet(&count);
+        REQUIRE(count == 2);
+        REQUIRE_THAT(context[0].key, Catch::Equals("request"));
+        REQUIRE_THAT(context[0].value, Catch::Equals("1234"));
+        REQUIRE_THAT(context[1].key, Catch::Equals("tenant"));
+        REQUIRE_THAT(context[1].value, Catch::Equals("acme"));
+
+        LogContextPop();
+        LogContextGet(&count);
+        REQUIRE(count == 1);
+        LogContextPop();
+        LogContextGet(&count);
+        REQUIRE(count == 0);
+    }
+
+    SECTION( "Targets can see the context" )
+    {
+        auto targetFunction = [](char const*, LogType, char const*, unsigned int, void* data)
+        {
+            unsigned int count;
+            LogContextEntry const* context = LogContextGet(&count);
+            *(char const**)data = (count > 0) ? context[count-1].value : nullptr;
+        };
+
+        char const* seen = nullptr;
+        LogTargetAdd(targetFunction, &seen);
+        LogContextPush("shard", "7");
+        Info("Which shard?");
+        LogContextPop();
+        LogTargetRemove(targetFunction, &seen);
+        REQUIRE_THAT(seen, Catch::Equals("7"));
+    }
+
+    SECTION( "Overflow is counted but not stored" )
+    {
+        for (int i = 0; i < k_logMaxContext + 3; ++i)
+            LogContextPush("k", "v");
+        LogContextGet(&count);
+        REQUIRE(count == k_logMaxContext);
+        for (int i = 0; i < k_logMaxContext + 3; ++i)
+            LogContextPop();
+        LogContextGet(&count);
+        REQUIRE(count == 0);
+    }
+
+    SECTION( "Each thread has its own context" )
+    {
+        LogContextPush("thread", "main");
+        unsigned int otherCount = 99;
+        std::thread other([&otherCount] { LogContextGet(&otherCount); });
+        other.join();
+        REQUIRE(otherCount == 0);
+        LogContextPop();
+    }
+}
+
+TEST_CASE( "Sampling" )
+{
+    struct SampleCount
+    {
+        int messages;
+        unsigned int lastRate;
+    };
+    SampleCount count = { 0, 0 };
+
+    auto targetFunction = [](char const*, LogType, char const*, unsigned int, void* data)
+    {
+        SampleCount* c = (SampleCount*)data;
+        ++c->messages;
+        c->lastRate = LogSampleRate();
+    };
+    LogTargetAdd(targetFunction, &count);
+
+    SECTION( "Unsampled messages all get through at rate 1" )
+    {
+        for (int i = 0; i < 100; ++i)
+            Spew("Spew %d", i);
+        REQUIRE(count.messages == 100);
+        REQUIRE(count.lastRate == 1);
+    }
+
+    SECTION( "Sampled macros keep roughly one in N" )
+    {
+        for (int i = 0; i < 100000; ++i)
+            SpewSampled(100, "Spew %d", i);
+        REQUIRE(count.messages > 700);
+        REQUIRE(count.messages < 1300);
+        REQUIRE(count.lastRate == 100);
+    }
+
+    SECTION( "Per-severity rates apply to the plain macros and multiply with the sampled ones" )
+    {
+        LogSetSampleRate(k_logInfo, 10);
+        for (int i = 0; i < 100000; ++i)
+            Info("Info %d", i);
+        REQUIRE(count.messages > 9000);
+        REQUIRE(count.messages < 11000);
+        REQUIRE(count.lastRate == 10);
+
+        count.messages = 0;
+        for (int i = 0; i < 100000; ++i)
+            InfoSampled(10, "Info %d", i);
+        REQUIRE(count.messages > 700);
+        REQUIRE(count.messages < 1300);
+        REQUIRE(count.lastRate == 100);
+
+        // other severities aren't affected
+        Error("Still here.");
+        REQUIRE(count.lastRate == 1);
+        LogSetSampleRate(k_logInfo, 1);
+    }
+
+    SECTION( "Sampled macros in if clauses" )
+    {
+        if (true)
+            InfoSampled(1, "Everything gets through at 1.");
+        else
+            ErrorSampled(1, "Did we get a compile error?");
+        REQUIRE(count.messages == 1);
+    }
+
+    LogTargetRemove(targetFunction, &count);
+    REQUIRE(LogSampleRate() == 1);
+}
@@ -0,0 +1,472 @@
+/**
+ * A queued front end for log targets that keeps each NUMA node's messages in memory on that node.
+ *
+ * \author Tom Plunket <tom@mightysprite.com>
+ * \copyright (c) 2019 Tom Plunket, all rights reserved
+ *
+ * Licensed under the MIT/X license. Do with these files what you will but leave this header intact.
+ *
+ * Normally Log calls every target on the thread that's logging. A NumaLogQueue instead takes over
+ * some targets and has the logging thread just copy the formatted message into a buffer belonging
+ * to the NUMA node it's running on. Each node has a drain thread pinned to it which takes messages
+ * out of that node's buffer and passes them to the targets, so on a multi-socket machine the
+ * message text never crosses between sockets until it gets to a target.
+ *
+ * Every message gets a sequence number when it's queued and the drain threads take turns, so the
+ * targets see the messages in the order they were logged, one at a time, just as they would
+ * without the queue. That turn-taking (and the sequence number itself) are the only state shared
+ * between nodes.
+ *
+ *     FdLogTarget console;
+ *     RotatingFileLogTarget file("service.log");
+ *     NumaLogQueue queue;
+ *     queue.Add(console);
+ *     queue.Add(file);
+ *
+ * Nodes are found with libnuma if LOG_HAVE_LIBNUMA is defined (and the program is linked with
+ * -lnuma), and from /sys/devices/system/node otherwise. Without libnuma each buffer is allocated by
+ * its own drain thread after it's been pinned, so the kernel's first-touch policy puts it on the
+ * right node. Elsewhere than Linux there's just the one node and the queue is simply a queue.
+ *
+ * Targets called by the drain threads run there, so LogContextGet() and LogSampleRate() don't tell
+ * them about the thread that logged the message. Add targets before logging starts and destroy the
+ * queue before them. A message longer than a quarter of a buffer is truncated. A target that logs
+ * something itself does so on a drain thread, which is the one thing that could make room in its
+ * buffer, so that message is dropped if there's no room rather than waiting for it.
+ */
+
+#ifndef NumaLogQueue_hpp
+#define NumaLogQueue_hpp
+
+#include "LogTarget.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+ #include <pthread.h>
+ #include <sched.h>
+#endif
+#ifdef LOG_HAVE_LIBNUMA
+ #include <numa.h>
+#endif
+
+namespace NumaTopology
+{
+    struct Node
+    {
+        int id;                 ///< the kernel's number for the node, which may not be its index
+        std::vector<int> cpus;
+    };
+
+    struct Nodes
+    {
+        std::vector<Node> nodes;
+        std::vector<int> nodeOfCpu;     ///< index into \c nodes for each cpu
+    };
+
+    /// Parse the kernel's list format, e.g. "0-3,8-11".
+    inline std::vector<int> ParseCpuList(char const* text)
+    {
+        std::vector<int> list;
+        while (*text != '\0')
+        {
+            char* end;
+            long first = strtol(text, &end, 10);
+            if (end == text)
+                break;
+            long last = first;
+            if (*end == '-')
+            {
+                text = end + 1;
+                last = strtol(text, &end, 10);
+                if (end == text)
+                    break;
+            }
+            for (long i = first; i <= last; ++i)
+                list.push_back((int)i);
+            if (*end != ',')
+                break;
+            text = end + 1;
+        }
+        return list;
+    }
+
+    namespace Detail
+    {
+        inline bool ReadFile(char const* path, char* buffer, size_t size)
+        {
+            FILE* f = fopen(path, "r");
+            if (f == nullptr)
+                return false;
+            bool ok = fgets(buffer, (int)size, f) != nullptr;
+            fclose(f);
+            return ok;
+        }
+
+        inline Nodes Discover()
+        {
+            Nodes n;
+#if defined(LOG_HAVE_LIBNUMA)
+            if (numa_available() >= 0)
+            {
+                std::vector<int> indexOfId(numa_max_node() + 1, -1);
+                int const numCpus = numa_num_configured_cpus();
+                for (int cpu = 0; cpu < numCpus; ++cpu)
+                {
+                    int id = numa_node_of_cpu(cpu);
+                    if ((id < 0) || (id >= (int)indexOfId.size()))
+                        id = 0;
+                    if (indexOfId[id] < 0)
+                    {
+                        indexOfId[id] = (int)n.nodes.size();
+                        n.nodes.push_back(Node{ id, std::vector<int>() });
+                    }
+                    n.nodes[indexOfId[id]].cpus.push_back(cpu);
+                    n.nodeOfCpu.push_back(indexOfId[id]);
+                }
+            }
+#elif defined(__linux__)
+            char buffer[4096];
+            if (ReadFile("/sys/devices/system/node/online", buffer, sizeof(buffer)))
+            {
+                for (int id : ParseCpuList(buffer))
+                {
+                    char path[64];
+                    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", id);
+                    if (!ReadFile(path, buffer, sizeof(buffer)))
+                        continue;
+                    Node node = { id, ParseCpuList(buffer) };
+                    if (node.cpus.empty())
+                        continue;   // memory-only nodes have nothing to pin a thread to
+                    for (int cpu : node.cpus)
+                    {
+                        if (cpu >= (int)n.nodeOfCpu.size())
+                            n.nodeOfCpu.resize(cpu + 1, 0);
+                        n.nodeOfCpu[cpu] = (int)n.nodes.size();
+                    }
+                    n.nodes.push_back(node);
+                }
+            }
+#endif
+            if (n.nodes.empty())
+                n.nodes.push_back(Node{ 0, std::vector<int>() });
+            return n;
+        }
+    }
+
+    /// The machine's nodes, found the first time they're asked for.
+    inline Nodes const& Get()
+    {
+        static Nodes const s_nodes = Detail::Discover();
+        return s_nodes;
+    }
+
+    /// The index of the node the calling thread is running on right now.
+    inline int CurrentNode()
+    {
+#ifdef __linux__
+        Nodes const& n = Get();
+        int const cpu = sched_getcpu();
+        return ((cpu >= 0) && (cpu < (int)n.nodeOfCpu.size())) ? n.nodeOfCpu[cpu] : 0;
+#else
+        return 0;
+#endif
+    }
+
+    /// Keep the calling thread on the cpus of one node.
+    inline bool RunOnNode(int index)
+    {
+        Node const& node = Get().nodes[index];
+#if defined(LOG_HAVE_LIBNUMA)
+        return (numa_available() < 0) || (numa_run_on_node(node.id) == 0);
+#elif defined(__linux__)
+        if (node.cpus.empty())
+            return true;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : node.cpus)
+            CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+        (void)node;
+        return true;
+#endif
+    }
+
+    /// Memory on one node; without libnuma, call this from a thread running on that node.
+    inline void* Allocate(size_t size, int index)
+    {
+#ifdef LOG_HAVE_LIBNUMA
+        if (numa_available() >= 0)
+            return numa_alloc_onnode(size, Get().nodes[index].id);
+#endif
+        (void)index;
+        void* p = malloc(size);
+        if (p != nullptr)
+            memset(p, 0, size);     // touch it so that it's placed now, by this thread
+        return p;
+    }
+
+    inline void Free(void* p, size_t size)
+    {
+#ifdef LOG_HAVE_LIBNUMA
+        if (numa_available() >= 0)
+        {
+            numa_free(p, size);
+            return;
+        }
+#endif
+        (void)size;
+        free(p);
+    }
+}
+
+class NumaLogQueue
+{
+public:
+    static size_t const k_defaultBufferSize = 1024 * 1024;
+
+    explicit NumaLogQueue(size_t bufferSize=k_defaultBufferSize) :
+        bufferSize(Padded(std::max(bufferSize, (size_t)4096))),
+        issued(0),
+        delivered(0),
+        quit(false)
+    {
+        size_t const numNodes = NumaTopology::Get().nodes.size();
+        for (size_t i = 0; i < numNodes; ++i)
+            nodes.emplace_back(new Node());
+        for (size_t i = 0; i < numNodes; ++i)
+            nodes[i]->thread = std::thread(&NumaLogQueue::Drain, this, (int)i);
+
+        // the buffers are allocated by the drain threads, so wait for them to be ready
+        for (auto& node : nodes)
+        {
+            std::unique_lock<std::mutex> lock(node->mutex);
+            node->space.wait(lock, [&node] { return node->started; });
+        }
+
+        LogTargetAdd(&Trampoline, this);
+    }
+
+    ~NumaLogQueue()
+    {
+        LogTargetRemove(&Trampoline, this);
+
+        quit = true;
+        for (auto& node : nodes)
+        {
+            {
+                std::lock_guard<std::mutex> lock(node->mutex);
+            }
+            node->ready.notify_one();
+            node->thread.join();
+            if (node->buffer != nullptr)
+                NumaTopology::Free(node->buffer, bufferSize);
+        }
+    }
+
+    /// Take a target over from Log so that its messages come through the queue.
+    void Add(LogTarget& target)
+    {
+        void* data;
+        LogTargetFn function = target.Detach(&data);
+        Add(function, data);
+    }
+
+    /// A C target, which shouldn't also be added with LogTargetAdd().
+    void Add(LogTargetFn function, void* data)
+    {
+        std::lock_guard<std::mutex> lock(orderMutex);
+        targets.push_back(std::make_pair(function, data));
+    }
+
+    size_t NumNodes() const { return nodes.size(); }
+
+    /// Wait until everything logged so far has been passed to the targets.
+    void Flush()
+    {
+        uint64_t const last = issued.load();
+        std::unique_lock<std::mutex> lock(orderMutex);
+        turn.wait(lock, [this, last] { return delivered >= last; });
+    }
+
+private:
+    NumaLogQueue(NumaLogQueue const&);
+    NumaLogQueue& operator=(NumaLogQueue const&);
+
+    struct RecordHeader
+    {
+        uint64_t sequence;
+        char const* file;
+        uint32_t line;
+        uint32_t type;      ///< a LogType, or k_wrap for the unused space at the end of the buffer
+        uint32_t length;    ///< of the message, not counting its terminator
+        uint32_t size;      ///< of the whole record, padded
+    };
+
+    static uint32_t const k_wrap = 0xffffffff;
+
+    // Every record is a multiple of the header's size, so there's always room for a wrap marker.
+    static size_t Padded(size_t n)
+    {
+        return (n + sizeof(RecordHeader) - 1) / sizeof(RecordHeader) * sizeof(RecordHeader);
+    }
+
+    struct Node
+    {
+        Node() : buffer(nullptr), head(0), tail(0), started(false) {}
+
+        char* buffer;
+        size_t head;        ///< these only ever increase; the position is modulo the buffer size
+        size_t tail;
+        bool started;
+
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::condition_variable space;
+        std::thread thread;
+    };
+
+    static void Trampoline(char const* m, LogType lt, char const* file, unsigned int line, void* d)
+    {
+        ((NumaLogQueue*)d)->Enqueue(m, lt, file, line);
+    }
+
+    /// Whether the calling thread is a drain thread, which mustn't wait for room in a buffer.
+    static bool& Draining()
+    {
+        static thread_local bool t_draining = false;
+        return t_draining;
+    }
+
+    /// Runs on the logging thread.
+    void Enqueue(char const* message, LogType lt, char const* file, unsigned int line)
+    {
+        Node& node = *nodes[NumaTopology::CurrentNode() % nodes.size()];
+
+        size_t const maxLength = bufferSize / 4 - sizeof(RecordHeader) - 1;
+        size_t const length = std::min(strlen(message), maxLength);
+        size_t const size = Padded(sizeof(RecordHeader) + length + 1);
+
+        std::unique_lock<std::mutex> lock(node.mutex);
+        if (node.buffer == nullptr)
+            return;
+
+        // a record that doesn't fit before the end of the buffer goes at the start instead
+        size_t offset, skip;
+        for (;;)
+        {
+            offset = node.tail % bufferSize;
+            skip = (bufferSize - offset < size) ? bufferSize - offset : 0;
+            if (bufferSize - (node.tail - node.head) >= skip + size)
+                break;
+            if (Draining())
+                return;
+            node.space.wait(lock);
+        }
+
+        if (skip > 0)
+        {
+            RecordHeader* wrap = (RecordHeader*)(node.buffer + offset);
+            wrap->type = k_wrap;
+            wrap->size = (uint32_t)skip;
+        }
+
+        // The sequence number is taken with the node's lock held so that each buffer is in order.
+        RecordHeader* h = (RecordHeader*)(node.buffer + (node.tail + skip) % bufferSize);
+        h->sequence = issued.fetch_add(1);
+        h->file = file;
+        h->line = line;
+        h->type = lt;
+        h->length = (uint32_t)length;
+        h->size = (uint32_t)size;
+        char* text = (char*)(h + 1);
+        memcpy(text, message, length);
+        text[length] = '\0';
+        if ((length == maxLength) && (length > 0))
+            text[length - 1] = '\n';
+
+        node.tail += skip + size;
+        lock.unlock();
+        node.ready.notify_one();
+    }
+
+    void Drain(int index)
+    {
+        Node& node = *nodes[index];
+        Draining() = true;
+        NumaTopology::RunOnNode(index);
+        {
+            std::lock_guard<std::mutex> lock(node.mutex);
+            node.buffer = (char*)NumaTopology::Allocate(bufferSize, index);
+            node.started = true;
+        }
+        node.space.notify_all();
+        if (node.buffer == nullptr)
+            return;     // messages logged on this node get dropped
+
+        std::unique_lock<std::mutex> lock(node.mutex);
+        for (;;)
+        {
+            node.ready.wait(lock, [this, &node] { return (node.head != node.tail) || quit; });
+            if (node.head == node.tail)
+                break;
+
+            // Producers only add to the tail, so everything up to here can be read without the lock.
+            size_t head = node.head;
+            size_t const tail = node.tail;
+            lock.unlock();
+
+            while (head != tail)
+            {
+                RecordHeader const* h = (RecordHeader const*)(node.buffer + head % bufferSize);
+                if (h->type != k_wrap)
+                    Deliver(*h);
+                head += h->size;
+            }
+
+            lock.lock();
+            node.head = head;
+            node.space.notify_all();
+        }
+    }
+
+    /// Wait for this record's turn, then give it to the targets.
+    void Deliver(RecordHeader const& h)
+    {
+        std::unique_lock<std::mutex> lock(orderMutex);
+        turn.wait(lock, [this, &h] { return delivered == h.sequence; });
+
+        char const* text = (char const*)(&h + 1);
+        for (auto const& target : targets)
+            target.first(text, (LogType)h.type, h.file, h.line, target.second);
+
+        ++delivered;
+        lock.unlock();
+        turn.notify_all();
+    }
+
+    size_t const bufferSize;
+    std::vector<std::unique_ptr<Node>> nodes;
+
+    std::atomic<uint64_t> issued;
+    uint64_t delivered;
+    std::atomic<bool> quit;
+
+    std::vector<std::pair<LogTargetFn, void*>> targets;
+    std::mutex orderMutex;
+    std::condition_variable turn;
+};
+
+#endif // ndef NumaLogQueue_hpp
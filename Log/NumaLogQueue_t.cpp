@@ -0,0 +1,138 @@
+/**
+ * Unit tests for the NUMA-aware log queue.
+ *
+ * \author Tom Plunket <tom@mightysprite.com>
+ * \copyright (c) 2019 Tom Plunket, all rights reserved
+ *
+ * Licensed under the MIT/X license. Do with these files what you will but leave this header intact.
+ */
+
+#include "NumaLogQueue.hpp"
+
+#include "Catch/Catch.hpp"
+
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE( "NUMA topology" )
+{
+    SECTION( "CPU lists." )
+    {
+        REQUIRE(NumaTopology::ParseCpuList("0-3,8-9\n") == std::vector<int>({ 0, 1, 2, 3, 8, 9 }));
+        REQUIRE(NumaTopology::ParseCpuList("5") == std::vector<int>({ 5 }));
+        REQUIRE(NumaTopology::ParseCpuList("\n").empty());
+    }
+
+    SECTION( "There's always at least one node and we're on one of them." )
+    {
+        NumaTopology::Nodes const& n = NumaTopology::Get();
+        REQUIRE(!n.nodes.empty());
+        int const node = NumaTopology::CurrentNode();
+        REQUIRE(node >= 0);
+        REQUIRE(node < (int)n.nodes.size());
+    }
+}
+
+/// Log from a target, whose own LogMessage would hide Log's.
+static void Reply(int count)
+{
+    for (int i = 0; i < count; ++i)
+        Info("reply %d %s", i, std::string(200, 'x').c_str());
+}
+
+TEST_CASE( "NumaLogQueue" )
+{
+    struct Collector : public LogTarget
+    {
+        std::vector<std::string> messages;
+        std::thread::id thread;
+
+        void LogMessage(char const* m, LogType, char const*, unsigned int) override
+        {
+            messages.push_back(m);
+            thread = std::this_thread::get_id();
+        }
+    };
+
+    SECTION( "Targets get the messages on another thread." )
+    {
+        Collector collector;
+        NumaLogQueue queue;
+        queue.Add(collector);
+        Info("one");
+        Warning("two");
+        queue.Flush();
+        REQUIRE(collector.messages == std::vector<std::string>({ "one\n", "two\n" }));
+        REQUIRE(collector.thread != std::this_thread::get_id());
+    }
+
+    SECTION( "Messages from many threads arrive in the order they were queued." )
+    {
+        // each thread's own messages have to stay in order whatever node it was on at the time
+        Collector collector;
+        NumaLogQueue queue(4096);
+        queue.Add(collector);
+
+        int const k_threads = 4, k_messages = 2000;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < k_threads; ++t)
+        {
+            threads.emplace_back([t]
+            {
+                for (int i = 0; i < k_messages; ++i)
+                    Info("%d %d", t, i);
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+        queue.Flush();
+
+        REQUIRE(collector.messages.size() == k_threads * k_messages);
+        std::vector<int> next(k_threads, 0);
+        bool inOrder = true;
+        for (auto const& m : collector.messages)
+        {
+            int t = 0, i = -1;
+            sscanf(m.c_str(), "%d %d", &t, &i);
+            inOrder = inOrder && (i == next[t]++);
+        }
+        REQUIRE(inOrder);
+    }
+
+    SECTION( "A target that logs drops what doesn't fit rather than waiting on itself." )
+    {
+        struct Echo : public Collector
+        {
+            void LogMessage(char const* m, LogType lt, char const* f, unsigned int l) override
+            {
+                Collector::LogMessage(m, lt, f, l);
+                if (strncmp(m, "echo", 4) == 0)
+                    Reply(50);
+            }
+        } echo;
+
+        {
+            NumaLogQueue queue(4096);
+            queue.Add(echo);
+            Info("echo");
+            queue.Flush();
+        }
+        REQUIRE(echo.messages.size() > 2);
+        REQUIRE(echo.messages.size() < 51);
+        REQUIRE(echo.messages[1].compare(0, 8, "reply 0 ") == 0);
+    }
+
+    SECTION( "Long messages are truncated." )
+    {
+        Collector collector;
+        NumaLogQueue queue(4096);
+        queue.Add(collector);
+        Info("%s", std::string(5000, 'x').c_str());
+        queue.Flush();
+        REQUIRE(collector.messages.size() == 1);
+        REQUIRE(collector.messages[0].size() < 1024);
+        REQUIRE(collector.messages[0].back() == '\n');
+    }
+}
@@ -19,9 +19,12 @@ struct PrintfLogTarget : public LogTarget
     explicit PrintfLogTarget(bool annotate=false) : annotate(annotate) {}
 
 private:
-    void LogMessage(char const* message, LogType lt, char const* file, unsigned int line)
+    void LogMessage(char const* message, LogType, char const* file, unsigned int line)
     {
-        if (annotate)
+        unsigned int const sampleRate = LogSampleRate();
+        if (annotate && (sampleRate > 1))
+            printf("%s(%d): [sampled=%u] %s", file, line, sampleRate, message);
+        else if (annotate)
             printf("%s(%d): %s", file, line, message);
         else
             printf("%s", message);
@@ -0,0 +1,320 @@
+/**
+ * A LogTarget that writes to a file and rotates it by size and/or age, without making the logging
+ * thread wait on the file system to do so.
+ *
+ * \author Tom Plunket <tom@mightysprite.com>
+ * \copyright (c) 2019 Tom Plunket, all rights reserved
+ *
+ * Licensed under the MIT/X license. Do with these files what you will but leave this header intact.
+ *
+ * The live log is always at \c path and the older ones are at path.1 (the most recent) through
+ * path.N, or path.1.lz and so on if they're compressed (see LogCompression.hpp).
+ *
+ * A helper thread keeps the next file open ahead of time as path.next. When the live file gets too
+ * big or too old, the logging thread just switches over to that file and carries on; the helper
+ * then syncs and closes the old file, shuffles the old names along, renames path.next to path,
+ * compresses the newly retired file if asked to, and opens the next path.next. If the helper falls
+ * behind, logging continues in the current file until the next one is ready. If the process stops
+ * between switching over and the helper's renaming, the next target on that path finishes the
+ * job before it opens anything, so the live log isn't lost to the new path.next.
+ */
+
+#ifndef RotatingFileLogTarget_hpp
+#define RotatingFileLogTarget_hpp
+
+#include "LogCompression.hpp"
+#include "LogTarget.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+ #ifndef WIN32_LEAN_AND_MEAN
+  #define WIN32_LEAN_AND_MEAN
+ #endif
+ #include <windows.h>
+ #include <fcntl.h>
+ #include <io.h>
+#else
+ #include <unistd.h>
+#endif
+
+struct RotatingFileLogTarget : public LogTarget
+{
+    struct Settings
+    {
+        Settings() :
+            maxBytes(64 * 1024 * 1024),
+            maxAge(0),
+            maxFiles(5),
+            compress(false),
+            annotate(false)
+        {}
+
+        size_t maxBytes;                ///< zero for no size limit
+        std::chrono::seconds maxAge;    ///< zero for no age limit
+        unsigned int maxFiles;          ///< the number of old files to keep
+        bool compress;
+        bool annotate;
+    };
+
+    explicit RotatingFileLogTarget(char const* path, Settings const& settings=Settings()) :
+        path(path),
+        settings(settings),
+        current(nullptr),
+        next(nullptr),
+        currentBytes(0),
+        waiting(false),
+        quit(false)
+    {
+        RecoverNext();
+        current = Open(path, "ab");
+        if (current == nullptr)
+            return;
+
+        fseek(current, 0, SEEK_END);
+        currentBytes = (size_t)ftell(current);
+        opened = std::chrono::steady_clock::now();
+        helper = std::thread(&RotatingFileLogTarget::Helper, this);
+    }
+
+    ~RotatingFileLogTarget()
+    {
+        if (current == nullptr)
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_one();
+        helper.join();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        fclose(current);
+        current = nullptr;
+    }
+
+    bool IsOpen() const { return current != nullptr; }
+
+    /// Wait for the helper to finish any rotation in progress and push the live file to the OS.
+    void Flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (current == nullptr)
+            return;
+        idle.wait(lock, [this] { return retired.empty() && waiting; });
+        fflush(current);
+    }
+
+private:
+    void LogMessage(char const* message, LogType, char const* fileName, unsigned int line)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (current == nullptr)
+            return;
+
+        if ((next != nullptr) && (currentBytes > 0) && TimeToRotate(strlen(message)))
+        {
+            retired.push_back(current);
+            current = next;
+            next = nullptr;
+            currentBytes = 0;
+            opened = std::chrono::steady_clock::now();
+            wake.notify_one();
+        }
+
+        if (settings.annotate)
+        {
+            unsigned int const sampleRate = LogSampleRate();
+            int written = (sampleRate > 1) ?
+                fprintf(current, "%s(%u): [sampled=%u] %s", fileName, line, sampleRate, message) :
+                fprintf(current, "%s(%u): %s", fileName, line, message);
+            currentBytes += (written > 0) ? written : 0;
+        }
+        else
+        {
+            fputs(message, current);
+            currentBytes += strlen(message);
+        }
+    }
+
+    bool TimeToRotate(size_t messageLength) const
+    {
+        if ((settings.maxBytes > 0) && (currentBytes + messageLength > settings.maxBytes))
+            return true;
+        return (settings.maxAge.count() > 0) &&
+               (std::chrono::steady_clock::now() - opened >= settings.maxAge);
+    }
+
+    void Helper()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;)
+        {
+            if (!retired.empty())
+            {
+                FILE* old = retired.front();
+                retired.pop_front();
+                lock.unlock();
+                Retire(old);
+                lock.lock();
+            }
+            else if (quit)
+            {
+                break;
+            }
+            else if (next == nullptr)
+            {
+                lock.unlock();
+                FILE* f = Open((path + ".next").c_str(), "wb");
+                if (f == nullptr)
+                {
+                    ::LogMessage(k_logWarning, __FILE__, __LINE__,
+                                 "Couldn't open %s.next; not rotating logs for now.", path.c_str());
+                }
+                lock.lock();
+
+                next = f;
+                if (f == nullptr)
+                    Idle(lock, std::chrono::seconds(1));
+            }
+            else
+            {
+                Idle(lock, std::chrono::hours(1));
+            }
+        }
+
+        if (next != nullptr)
+        {
+            fclose(next);
+            next = nullptr;
+            remove((path + ".next").c_str());
+        }
+    }
+
+    template <typename Duration>
+    void Idle(std::unique_lock<std::mutex>& lock, Duration timeout)
+    {
+        waiting = true;
+        idle.notify_all();
+        wake.wait_for(lock, timeout);
+        waiting = false;
+    }
+
+    /// Runs on the helper thread; \c old was the live file and path.next has taken over from it.
+    void Retire(FILE* old)
+    {
+        fflush(old);
+#ifdef _WIN32
+        _commit(_fileno(old));
+#else
+        fsync(fileno(old));
+#endif
+        fclose(old);
+        Promote();
+    }
+
+    /// Runs before anything is open. A path.next with something in it was the live file when the
+    /// last process stopped, before its helper could rename it, so it's promoted now; an empty one
+    /// is just the file that was ready next.
+    void RecoverNext()
+    {
+        std::string const nextPath = path + ".next";
+        FILE* f = fopen(nextPath.c_str(), "rb");
+        if (f == nullptr)
+            return;
+        bool const empty = (fgetc(f) == EOF);
+        fclose(f);
+
+        if (empty)
+            remove(nextPath.c_str());
+        else
+            Promote();
+    }
+
+    /// Move the live file to path.1, and the older ones along, and path.next to the live file.
+    void Promote()
+    {
+        // the live file may have gone already, if a rotation was cut short after moving it
+        FILE* f = fopen(path.c_str(), "rb");
+        bool const live = (f != nullptr);
+        if (live)
+            fclose(f);
+
+        char const* suffix = settings.compress ? ".lz" : "";
+        if (live && (settings.maxFiles == 0))
+        {
+            remove(path.c_str());
+        }
+        else if (live)
+        {
+            remove(OldName(settings.maxFiles, suffix).c_str());
+            for (unsigned int i = settings.maxFiles - 1; i > 0; --i)
+                rename(OldName(i, suffix).c_str(), OldName(i + 1, suffix).c_str());
+            rename(path.c_str(), OldName(1, "").c_str());
+        }
+        rename((path + ".next").c_str(), path.c_str());
+
+        if (live && settings.compress && (settings.maxFiles > 0))
+        {
+            std::string raw = OldName(1, "");
+            FILE* in = fopen(raw.c_str(), "rb");
+            FILE* out = fopen(OldName(1, suffix).c_str(), "wb");
+            bool compressed = (in != nullptr) && (out != nullptr) &&
+                LogCompression::CompressFile(in, out, 1024 * 1024);
+            if (in != nullptr)
+                fclose(in);
+            if (out != nullptr)
+                fclose(out);
+            if (compressed)
+                remove(raw.c_str());
+        }
+    }
+
+    std::string OldName(unsigned int i, char const* suffix) const
+    {
+        return path + "." + std::to_string(i) + suffix;
+    }
+
+    /// Open a file that can be renamed while it's open, which on Windows takes some convincing.
+    static FILE* Open(char const* name, char const* mode)
+    {
+#ifdef _WIN32
+        bool append = (mode[0] == 'a');
+        HANDLE h = CreateFileA(name, append ? FILE_APPEND_DATA : GENERIC_WRITE,
+                               FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                               append ? OPEN_ALWAYS : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (h == INVALID_HANDLE_VALUE)
+            return nullptr;
+        int fd = _open_osfhandle((intptr_t)h, append ? (_O_APPEND | _O_BINARY) : _O_BINARY);
+        return (fd >= 0) ? _fdopen(fd, mode) : nullptr;
+#else
+        return fopen(name, mode);
+#endif
+    }
+
+    std::string const path;
+    Settings const settings;
+
+    FILE* current;
+    FILE* next;
+    size_t currentBytes;
+    std::chrono::steady_clock::time_point opened;
+
+    std::deque<FILE*> retired;
+    bool waiting;
+    bool quit;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::thread helper;
+};
+
+#endif // ndef RotatingFileLogTarget_hpp
@@ -0,0 +1,195 @@
+/**
+ * Unit tests for the rotating file log target.
+ *
+ * \author Tom Plunket <tom@mightysprite.com>
+ * \copyright (c) 2019 Tom Plunket, all rights reserved
+ *
+ * Licensed under the MIT/X license. Do with these files what you will but leave this header intact.
+ */
+
+#include "RotatingFileLogTarget.hpp"
+
+#include "Catch/Catch.hpp"
+
+#include <cstdio>
+#include <string>
+
+static char const* const k_testFile = "RotatingLog_t.log";
+
+static bool Exists(std::string const& name)
+{
+    FILE* f = fopen(name.c_str(), "rb");
+    if (f != nullptr)
+        fclose(f);
+    return f != nullptr;
+}
+
+static std::string Contents(std::string const& name, bool compressed=false)
+{
+    std::string text;
+    FILE* f = fopen(name.c_str(), "rb");
+    if (f == nullptr)
+        return text;
+
+    if (compressed)
+    {
+        FILE* out = tmpfile();
+        REQUIRE(LogCompression::DecompressFile(f, out));
+        fclose(f);
+        f = out;
+        rewind(f);
+    }
+
+    char buffer[256];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+        text.append(buffer, n);
+    fclose(f);
+    return text;
+}
+
+static void CleanUp()
+{
+    std::string base = k_testFile;
+    remove(k_testFile);
+    remove((base + ".next").c_str());
+    for (int i = 1; i <= 4; ++i)
+    {
+        remove((base + "." + std::to_string(i)).c_str());
+        remove((base + "." + std::to_string(i) + ".lz").c_str());
+    }
+}
+
+TEST_CASE( "Rotating file log target" )
+{
+    CleanUp();
+    std::string const base = k_testFile;
+
+    RotatingFileLogTarget::Settings settings;
+    settings.maxBytes = 20;
+    settings.maxFiles = 2;
+
+    SECTION( "Rotates by size and keeps the right number of old files." )
+    {
+        {
+            RotatingFileLogTarget target(k_testFile, settings);
+            REQUIRE(target.IsOpen());
+            for (int i = 0; i < 4; ++i)
+            {
+                target.Flush(); // let the helper get the next file ready
+                Info("Message %d is long.", i);
+            }
+            target.Flush();
+        }
+
+        REQUIRE(Contents(base) == "Message 3 is long.\n");
+        REQUIRE(Contents(base + ".1") == "Message 2 is long.\n");
+        REQUIRE(Contents(base + ".2") == "Message 1 is long.\n");
+        REQUIRE(!Exists(base + ".3"));
+        REQUIRE(!Exists(base + ".next"));
+    }
+
+    SECTION( "Messages go in the same file until it's full." )
+    {
+        settings.maxBytes = 1000;
+        {
+            RotatingFileLogTarget target(k_testFile, settings);
+            target.Flush();
+            Info("one");
+            Info("two");
+        }
+        REQUIRE(Contents(base) == "one\ntwo\n");
+        REQUIRE(!Exists(base + ".1"));
+    }
+
+    SECTION( "Annotation includes the sampling rate." )
+    {
+        settings.maxBytes = 0;
+        settings.annotate = true;
+        {
+            RotatingFileLogTarget target(k_testFile, settings);
+            LogSetSampleRate(k_logInfo, 2);
+            for (int i = 0; i < 64; ++i)
+                Info("sampled");
+            LogSetSampleRate(k_logInfo, 1);
+            Info("all");
+        }
+        std::string const text = Contents(base);
+        REQUIRE(text.find("): [sampled=2] sampled\n") != std::string::npos);
+        REQUIRE_THAT(text, Catch::EndsWith("): all\n"));
+    }
+
+    SECTION( "Old files can be compressed." )
+    {
+        settings.compress = true;
+        {
+            RotatingFileLogTarget target(k_testFile, settings);
+            for (int i = 0; i < 3; ++i)
+            {
+                target.Flush();
+                Warning("Compress message %d.", i);
+            }
+            target.Flush();
+        }
+
+        REQUIRE(Contents(base) == "Compress message 2.\n");
+        REQUIRE(Contents(base + ".1.lz", true) == "Compress message 1.\n");
+        REQUIRE(Contents(base + ".2.lz", true) == "Compress message 0.\n");
+        REQUIRE(!Exists(base + ".1"));
+    }
+
+    SECTION( "A path.next left by a process that stopped mid rotation is kept." )
+    {
+        settings.maxBytes = 1000;
+        FILE* f = fopen(k_testFile, "wb");
+        fputs("older\n", f);
+        fclose(f);
+        f = fopen((base + ".next").c_str(), "wb");
+        fputs("live\n", f);
+        fclose(f);
+
+        {
+            RotatingFileLogTarget target(k_testFile, settings);
+            target.Flush();
+            Info("after the restart");
+        }
+        REQUIRE(Contents(base) == "live\nafter the restart\n");
+        REQUIRE(Contents(base + ".1") == "older\n");
+        REQUIRE(!Exists(base + ".next"));
+    }
+
+    SECTION( "An empty path.next is just dropped." )
+    {
+        settings.maxBytes = 1000;
+        FILE* f = fopen(k_testFile, "wb");
+        fputs("live\n", f);
+        fclose(f);
+        fclose(fopen((base + ".next").c_str(), "wb"));
+
+        {
+            RotatingFileLogTarget target(k_testFile, settings);
+            target.Flush();
+            Info("more");
+        }
+        REQUIRE(Contents(base) == "live\nmore\n");
+        REQUIRE(!Exists(base + ".1"));
+    }
+
+    SECTION( "Rotates by age." )
+    {
+        settings.maxBytes = 0;
+        settings.maxAge = std::chrono::seconds(1);
+        {
+            RotatingFileLogTarget target(k_testFile, settings);
+            target.Flush();
+            Info("before");
+            std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+            Info("after");
+            target.Flush();
+        }
+        REQUIRE(Contents(base) == "after\n");
+        REQUIRE(Contents(base + ".1") == "before\n");
+    }
+
+    CleanUp();
+}
@@ -23,7 +23,11 @@ private:
     {
         std::ostream& s = (lt < k_logError) ? std::cout : std::cerr;
         if (annotate)
+        {
             s << file << '(' << line << "): ";
+            if (LogSampleRate() > 1)
+                s << "[sampled=" << LogSampleRate() << "] ";
+        }
         s << message;
     }
 
@@ -0,0 +1,151 @@
+/**
+ * Search an indexed binary log file (as written by BinaryLogTarget) by time, severity and file.
+ *
+ * \author Tom Plunket <tom@mightysprite.com>
+ * \copyright (c) 2019 Tom Plunket, all rights reserved
+ *
+ *     LogQuery service.blog -from 1571000000 -to 1571003600 -severity error -file Network.cpp
+ *
+ * The above prints every Error logged from Network.cpp during that hour. Only the part of the file
+ * index covering the hour is searched and only the segments that contain errors are read.
+ *
+ * Command line options are:
+ *     -from <seconds>: Skip messages logged before this time, in seconds since the Unix epoch.
+ *     -to <seconds>: Skip messages logged after this time.
+ *     -s[everity] <list>: Comma separated severities to show, e.g. "error,warning". Defaults to
+ *                         all of them.
+ *     -f[ile] <name>: Only show messages from source files with this name. Leading directories
+ *                     can be left off.
+ *     -c[ount]: Only print the number of matching messages.
+ *
+ * Licensed under the MIT/X license. Do with these files what you will but leave this header intact.
+ */
+
+#include "CommandLine/CommandLine.hpp"
+#include "Log/BinaryLog.hpp"
+#include "Log/FdLogTarget.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+
+static char const* const k_severityNames[k_numLogTypes] = { "error", "warning", "info", "spew" };
+
+bool ParseTime(char const* text, uint64_t* time)
+{
+    char* end;
+    double seconds = strtod(text, &end);
+    if ((*end != '\0') || (seconds < 0.0))
+    {
+        Error("'%s' isn't a time in seconds since the epoch.", text);
+        return false;
+    }
+    *time = (seconds < 18e9) ? (uint64_t)(seconds * 1e9) : UINT64_MAX;
+    return true;
+}
+
+bool ParseSeverities(std::string const& text, uint32_t* severities)
+{
+    *severities = 0;
+    size_t start = 0;
+    while (start <= text.size())
+    {
+        size_t end = text.find(',', start);
+        if (end == std::string::npos)
+            end = text.size();
+        std::string name = text.substr(start, end - start);
+
+        unsigned int lt = 0;
+        while ((lt < k_numLogTypes) && (name != k_severityNames[lt]))
+            ++lt;
+        if (lt == k_numLogTypes)
+        {
+            Error("Unknown severity '%s'.", name.c_str());
+            return false;
+        }
+        *severities |= 1u << lt;
+        start = end + 1;
+    }
+    return true;
+}
+
+void PrintRecord(BinaryLog::Record const& r)
+{
+    time_t seconds = (time_t)(r.time / 1000000000);
+    char date[32];
+    strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", gmtime(&seconds));
+
+    char sampling[32] = "";
+    if (r.sampleRate > 1)
+        snprintf(sampling, sizeof(sampling), " (1 in %u)", r.sampleRate);
+
+    printf("%s.%09u %s%s %s(%u): %.*s\n", date, (unsigned int)(r.time % 1000000000),
+           k_severityNames[r.type], sampling, r.file, r.line, (int)r.length, r.message);
+}
+
+int main(int argc, char const** argv)
+{
+    FdLogTarget lt(false, FdLogTarget::IsTerminal(2));
+
+    char const* logFile, *from, *to, *severity, *sourceFile;
+    int countOnly;
+
+    CommandLine cl;
+    cl.AddArgument(&logFile);
+    cl.AddStringOption(&from, "from");
+    cl.AddStringOption(&to, "to");
+    cl.AddStringOption(&severity, "s");
+    cl.AddStringOption(&severity, "severity");
+    cl.AddStringOption(&sourceFile, "f");
+    cl.AddStringOption(&sourceFile, "file");
+    cl.AddCountingOption(&countOnly, "c");
+    cl.AddCountingOption(&countOnly, "count");
+
+    if (!cl.Parse(argc, argv))
+        return 1;
+
+    if (logFile == nullptr)
+    {
+        Error("Need to give a log file.");
+        return 2;
+    }
+
+    uint64_t begin = 0, end = UINT64_MAX;
+    uint32_t severities = (1u << k_numLogTypes) - 1;
+    if (((from != nullptr) && !ParseTime(from, &begin)) ||
+        ((to != nullptr) && !ParseTime(to, &end)) ||
+        ((severity != nullptr) && !ParseSeverities(severity, &severities)))
+    {
+        return 1;
+    }
+
+    BinaryLogReader reader(logFile);
+    if (!reader.IsOpen())
+    {
+        Error("Couldn't open log %s.", logFile);
+        return 3;
+    }
+
+    std::vector<bool> files = reader.MatchFiles(sourceFile);
+    if ((sourceFile != nullptr) && (std::find(files.begin(), files.end(), true) == files.end()))
+    {
+        // nothing was logged from that file, so there's no point looking
+        if (countOnly)
+            printf("0\n");
+        return 0;
+    }
+
+    if (countOnly)
+    {
+        size_t found = reader.Query(begin, end, severities, files, [](BinaryLog::Record const&) {});
+        printf("%zu\n", found);
+    }
+    else
+    {
+        reader.Query(begin, end, severities, files, PrintRecord);
+    }
+
+    return 0;
+}
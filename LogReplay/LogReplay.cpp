@@ -0,0 +1,202 @@
+/**
+ * Replay a recorded log into a configurable set of log targets and measure how they cope.
+ *
+ * \author Tom Plunket <tom@mightysprite.com>
+ * \copyright (c) 2019 Tom Plunket, all rights reserved
+ *
+ * Recordings are the binary log files written by BinaryLogTarget, which keep the time, severity,
+ * file, line and text of every message. Attach one to a live process to capture its real message
+ * mix, then tune targets offline:
+ *
+ *     LogReplay production.blog -fast -compressed out.lz
+ *
+ * Each message goes back through LogMessage() with its original file and line, and the time spent
+ * in that call is what's reported as latency.
+ *
+ * Command line options are:
+ *     -fast: Replay as fast as possible rather than at the recorded pace.
+ *     -r[epeat] <n>: Replay the recording n times.
+ *     -a[nnotate]: Ask the text targets to prefix messages with file and line.
+ *     -printf: Log to a PrintfLogTarget.
+ *     -stdstream: Log to a StdStreamLogTarget.
+ *     -fd: Log to an FdLogTarget.
+ *     -binary <file>: Log to a BinaryLogTarget.
+ *     -compressed <file>: Log to a CompressedLogTarget.
+ *     -rotating <file>: Log to a RotatingFileLogTarget.
+ *     -null: Log to a target that does nothing, to measure the cost of Log itself.
+ *
+ * Licensed under the MIT/X license. Do with these files what you will but leave this header intact.
+ */
+
+#include "CommandLine/CommandLine.hpp"
+#include "Log/BinaryLogTarget.hpp"
+#include "Log/CompressedLogTarget.hpp"
+#include "Log/FdLogTarget.hpp"
+#include "Log/PrintfLogTarget.hpp"
+#include "Log/RotatingFileLogTarget.hpp"
+#include "Log/StdStreamLogTarget.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+struct NullLogTarget : public LogTarget
+{
+private:
+    void LogMessage(char const*, LogType, char const*, unsigned int) {}
+};
+
+/// Errors about the command line and the recording go to stderr, before any targets are set up.
+static void ReportError(char const* m, LogType, char const*, unsigned int, void*)
+{
+    fputs(m, stderr);
+}
+
+struct Results
+{
+    size_t messages = 0;
+    size_t bytes = 0;
+    double seconds = 0.0;
+    std::vector<uint64_t> latencies;    ///< nanoseconds in LogMessage, per message
+};
+
+Results Replay(std::vector<BinaryLog::Record> const& records, int repeat, bool fast)
+{
+    using namespace std::chrono;
+    typedef steady_clock Clock;
+
+    Results results;
+    results.latencies.reserve(records.size() * repeat);
+
+    Clock::time_point const start = Clock::now();
+    Clock::time_point passStart = start;
+    for (int pass = 0; pass < repeat; ++pass)
+    {
+        uint64_t const firstTime = records.front().time;
+        for (BinaryLog::Record const& r : records)
+        {
+            if (!fast)
+                std::this_thread::sleep_until(passStart + nanoseconds(r.time - firstTime));
+
+            Clock::time_point before = Clock::now();
+            LogMessage(r.type, r.file, r.line, "%.*s", (int)r.length, r.message);
+            Clock::time_point after = Clock::now();
+
+            results.latencies.push_back((uint64_t)duration_cast<nanoseconds>(after - before).count());
+            results.bytes += r.length + 1;
+        }
+        passStart = Clock::now();
+    }
+
+    results.messages = results.latencies.size();
+    results.seconds = duration<double>(Clock::now() - start).count();
+    return results;
+}
+
+void Report(Results& results)
+{
+    std::vector<uint64_t>& l = results.latencies;
+    std::sort(l.begin(), l.end());
+    auto percentile = [&l](double p) { return l[std::min(l.size() - 1, (size_t)(p * l.size()))]; };
+
+    fprintf(stderr, "%zu messages, %zu bytes in %.3f s\n", results.messages, results.bytes,
+            results.seconds);
+    fprintf(stderr, "throughput: %.0f messages/s, %.2f MB/s\n", results.messages / results.seconds,
+            results.bytes / results.seconds / (1024.0 * 1024.0));
+    fprintf(stderr, "latency (ns): p50 %llu, p90 %llu, p99 %llu, p99.9 %llu, max %llu\n",
+            (unsigned long long)percentile(0.5), (unsigned long long)percentile(0.9),
+            (unsigned long long)percentile(0.99), (unsigned long long)percentile(0.999),
+            (unsigned long long)l.back());
+}
+
+int main(int argc, char const** argv)
+{
+    LogTargetAdd(ReportError, nullptr);
+
+    char const* recording, *binaryFile, *compressedFile, *rotatingFile;
+    int fast, repeat, annotate, usePrintf, useStdStream, useFd, useNull;
+
+    {
+        CommandLine cl;
+        cl.AddArgument(&recording);
+        cl.AddCountingOption(&fast, "fast");
+        cl.AddIntegerOption(&repeat, "r");
+        cl.AddIntegerOption(&repeat, "repeat");
+        cl.AddCountingOption(&annotate, "a");
+        cl.AddCountingOption(&annotate, "annotate");
+        cl.AddCountingOption(&usePrintf, "printf");
+        cl.AddCountingOption(&useStdStream, "stdstream");
+        cl.AddCountingOption(&useFd, "fd");
+        cl.AddCountingOption(&useNull, "null");
+        cl.AddStringOption(&binaryFile, "binary");
+        cl.AddStringOption(&compressedFile, "compressed");
+        cl.AddStringOption(&rotatingFile, "rotating");
+
+        if (!cl.Parse(argc, argv))
+            return 1;
+    }
+
+    if (recording == nullptr)
+    {
+        Error("Need to give a recording to replay.");
+        return 2;
+    }
+    if (repeat < 1)
+        repeat = 1;
+
+    BinaryLogReader reader(recording);
+    if (!reader.IsOpen())
+    {
+        Error("Couldn't open recording %s.", recording);
+        return 3;
+    }
+
+    std::vector<BinaryLog::Record> records;
+    reader.Query(0, UINT64_MAX, (1u << k_numLogTypes) - 1, std::vector<bool>(),
+                 [&records](BinaryLog::Record const& r) { records.push_back(r); });
+    if (records.empty())
+    {
+        Error("%s has nothing in it to replay.", recording);
+        return 4;
+    }
+
+    LogTargetRemove(ReportError, nullptr);
+
+    Results results;
+    {
+        std::vector<std::unique_ptr<LogTarget>> targets;
+        if (usePrintf)
+            targets.emplace_back(new PrintfLogTarget(annotate != 0));
+        if (useStdStream)
+            targets.emplace_back(new StdStreamLogTarget(annotate != 0));
+        if (useFd)
+            targets.emplace_back(new FdLogTarget(annotate != 0));
+        if (useNull)
+            targets.emplace_back(new NullLogTarget);
+        if (binaryFile != nullptr)
+            targets.emplace_back(new BinaryLogTarget(binaryFile));
+        if (compressedFile != nullptr)
+            targets.emplace_back(new CompressedLogTarget(compressedFile, annotate != 0));
+        if (rotatingFile != nullptr)
+        {
+            RotatingFileLogTarget::Settings settings;
+            settings.annotate = (annotate != 0);
+            targets.emplace_back(new RotatingFileLogTarget(rotatingFile, settings));
+        }
+
+        results = Replay(records, repeat, fast != 0);
+
+        // Shutting the targets down (e.g. waiting for their background threads to finish) is
+        // part of the cost of using them.
+        auto shutdownStart = std::chrono::steady_clock::now();
+        targets.clear();
+        results.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                                         shutdownStart).count();
+    }
+
+    Report(results);
+    return 0;
+}